@@ -14,6 +14,7 @@
 #include "music/dynamic_range.hpp"
 #include "music/timbre.hpp"
 #include "music/preprocessor.hpp"
+#include "music/feature_vector_store.hpp"
 #include "music/classificationprocessor.hpp"
 #include "music/classificationcategory.hpp"
 
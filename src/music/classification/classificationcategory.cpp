@@ -2,6 +2,35 @@
 
 namespace music
 {
+    /**
+     * @brief Draws samples from a set of models, in random order.
+     * 
+     * Every sample is drawn from a randomly chosen model, so all models
+     * contribute the same number of samples on average.
+     */
+    class ComponentSampleGenerator : public DataVectorGenerator<kiss_fft_scalar>
+    {
+    private:
+        const std::vector<GaussianMixtureModel<kiss_fft_scalar>*>& components;
+    public:
+        ComponentSampleGenerator(const std::vector<GaussianMixtureModel<kiss_fft_scalar>*>& components) :
+            components(components)
+        {
+            
+        }
+        
+        void generateDataVectors(DataSet<kiss_fft_scalar>& data, unsigned int count)
+        {
+            for (unsigned int j=0; j<count; j++)
+            {
+                Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> sample = components[std::rand() % components.size()]->rand();
+                if (j == 0)
+                    data.resize(sample.size(), count);
+                data.col(j) = sample;
+            }
+        }
+    };
+    
     bool ClassificationCategory::calculateModel(GaussianMixtureModel<kiss_fft_scalar>*& model, std::vector<GaussianMixtureModel<kiss_fft_scalar>*> components, unsigned int gaussianCount, unsigned int samplesPerGMM, ProgressCallbackCaller* callback, double initVariance, double minVariance)
     {
         if (callback)
@@ -12,14 +41,34 @@ namespace music
             return false;
         }
         
-        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > samples;
+        //no samples needed: merge the gaussians of the examples.
+        if (modelReduction)
+        {
+            if (callback)
+                callback->progress(0.5, "merging gaussians...");
+            model->trainGMMFromModels(components, gaussianCount);
+            if (callback)
+                callback->progress(1.0, "finished!");
+            return true;
+        }
+        
+        //too many samples for memory: draw them while training.
+        bool online = (double(components.size()) * samplesPerGMM > maxSampleCount);
+        ComponentSampleGenerator generator(components);
+        
+        //all samples in one block of memory, one per column.
+        DataSet<kiss_fft_scalar> samples;
         int i=0;
+        int sampleCount=0;
         
-        for (std::vector<GaussianMixtureModel<kiss_fft_scalar>*>::iterator it = components.begin(); it != components.end(); it++)
+        for (std::vector<GaussianMixtureModel<kiss_fft_scalar>*>::iterator it = components.begin(); (it != components.end()) && !online; it++)
         {
             for (unsigned int j=0; j<samplesPerGMM; j++)
             {
-                samples.push_back((*it)->rand());
+                Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> sample = (*it)->rand();
+                if (sampleCount == 0)
+                    samples.resize(sample.size(), components.size() * samplesPerGMM);
+                samples.col(sampleCount++) = sample;
             }
             
             if (callback)
@@ -31,18 +80,23 @@ namespace music
             callback->progress(0.5, "training models...");
         
         //then train the model (best-of-three).
-        if (callback)
-            callback->progress(0.5,  "calculating model 1");
-        model->trainGMM(samples, gaussianCount, initVariance, minVariance);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel1 = model->clone();
-        if (callback)
-            callback->progress(0.65, "calculating model 2");
-        model->trainGMM(samples, gaussianCount, initVariance, minVariance);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel2 = model->clone();
-        if (callback)
-            callback->progress(0.8,  "calculating model 3");
-        model->trainGMM(samples, gaussianCount, initVariance, minVariance);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel3 = model->clone();
+        model->setThreadCount(threadCount);
+        model->setInitMethod(GMM_INIT_KMEANS);
+        const char* progressMessages[] = {"calculating model 1", "calculating model 2", "calculating model 3"};
+        std::vector<GaussianMixtureModel<kiss_fft_scalar>*> tmpModels;
+        for (int m=0; m<3; m++)
+        {
+            if (callback)
+                callback->progress(0.5 + 0.15*m, progressMessages[m]);
+            if (online)
+                model->trainGMMOnline(generator, gaussianCount, maxSampleCount, onlineBatchSize, initVariance, minVariance);
+            else
+                model->trainGMM(samples, gaussianCount, initVariance, minVariance);
+            tmpModels.push_back(model->clone());
+        }
+        GaussianMixtureModel<kiss_fft_scalar>* tmpModel1 = tmpModels[0];
+        GaussianMixtureModel<kiss_fft_scalar>* tmpModel2 = tmpModels[1];
+        GaussianMixtureModel<kiss_fft_scalar>* tmpModel3 = tmpModels[2];
         
         delete model;
         model = NULL;
@@ -123,7 +177,11 @@ namespace music
         posClassifier(new GaussianOneClassClassifier()),
         negClassifier(new GaussianOneClassClassifier()),
         emptyPosClassifierModel(true),
-        emptyNegClassifierModel(true)
+        emptyNegClassifierModel(true),
+        threadCount(1),
+        maxSampleCount(1000000),
+        onlineBatchSize(10000),
+        modelReduction(false)
     {
         
     }
@@ -145,29 +203,23 @@ namespace music
     
     Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> ClassificationCategory::createVectorForFeatures(databaseentities::RecordingFeatures* features, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel)
     {
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> vec(4);
-        
-        GaussianMixtureModel<kiss_fft_scalar>* timbreModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(features->getTimbreModel());
-        GaussianMixtureModel<kiss_fft_scalar>* chromaModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(features->getChromaModel());
+        GMMSampleSet<kiss_fft_scalar> timbreSamples;
+        GMMSampleSet<kiss_fft_scalar> chromaSamples;
+        drawComparisonSamples(*features, timbreSamples, chromaSamples);
         
-        vec = createVectorForFeatures(timbreModel, chromaModel, features->getDynamicRange(), features->getLength(), categoryTimbreModel, categoryChromaModel);
-        
-        delete timbreModel;
-        delete chromaModel;
-        
-        return vec;
+        return createVectorForFeatures(timbreSamples, chromaSamples, features->getDynamicRange(), features->getLength(), categoryTimbreModel, categoryChromaModel);
     }
     
-    Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> ClassificationCategory::createVectorForFeatures(GaussianMixtureModel<kiss_fft_scalar>* timbreModel, GaussianMixtureModel<kiss_fft_scalar>* chromaModel, double dynamicRange, double length, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel)
+    Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> ClassificationCategory::createVectorForFeatures(const GMMSampleSet<kiss_fft_scalar>& timbreSamples, const GMMSampleSet<kiss_fft_scalar>& chromaSamples, double dynamicRange, double length, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel)
     {
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> vec(4);
         if (categoryTimbreModel)
-            vec[0] = timbreModel->compareTo(*categoryTimbreModel);
+            vec[0] = timbreSamples.compareTo(*categoryTimbreModel);
         else
             vec[0] = 0.0;
         
         if (categoryChromaModel)
-            vec[1] = chromaModel->compareTo(*categoryChromaModel);
+            vec[1] = chromaSamples.compareTo(*categoryChromaModel);
         else
             vec[1] = 0.0;
         vec[2] = dynamicRange;
@@ -176,6 +228,19 @@ namespace music
         return vec;
     }
     
+    void ClassificationCategory::drawComparisonSamples(const databaseentities::RecordingFeatures& features, GMMSampleSet<kiss_fft_scalar>& timbreSamples, GMMSampleSet<kiss_fft_scalar>& chromaSamples)
+    {
+        GaussianMixtureModel<kiss_fft_scalar>* timbreModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(features.getTimbreModel());
+        GaussianMixtureModel<kiss_fft_scalar>* chromaModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(features.getChromaModel());
+        
+        //as many samples as GaussianMixtureModel::compareTo() uses, but with less variance.
+        timbreSamples.drawSamples(*timbreModel, 200, GMM_SAMPLING_STRATIFIED);
+        chromaSamples.drawSamples(*chromaModel, 200, GMM_SAMPLING_STRATIFIED);
+        
+        delete timbreModel;
+        delete chromaModel;
+    }
+    
     
     bool ClassificationCategory::calculateClassificatorModel(const std::vector<databaseentities::Recording*>& posExamples, const std::vector<databaseentities::Recording*>& negExamples, unsigned int categoryTimbreModelSize, unsigned int categoryTimbrePerSongSampleCount, unsigned int categoryChromaModelSize, unsigned int categoryChromaPerSongSampleCount, ProgressCallbackCaller* callback)
     {
@@ -340,14 +405,20 @@ namespace music
         if (recording.getRecordingFeatures() == NULL)
             return 0.0;
         
-        GaussianMixtureModel<kiss_fft_scalar>* timbreModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(recording.getRecordingFeatures()->getTimbreModel());
-        GaussianMixtureModel<kiss_fft_scalar>* chromaModel = GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(recording.getRecordingFeatures()->getChromaModel());
+        GMMSampleSet<kiss_fft_scalar> timbreSamples;
+        GMMSampleSet<kiss_fft_scalar> chromaSamples;
+        drawComparisonSamples(*recording.getRecordingFeatures(), timbreSamples, chromaSamples);
         
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> posVec = createVectorForFeatures(timbreModel, chromaModel, recording.getRecordingFeatures()->getDynamicRange(), recording.getRecordingFeatures()->getLength(), emptyPositiveTimbreModel ? NULL : positiveTimbreModel, emptyPositiveChromaModel ? NULL : positiveChromaModel);
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> negVec = createVectorForFeatures(timbreModel, chromaModel, recording.getRecordingFeatures()->getDynamicRange(), recording.getRecordingFeatures()->getLength(), emptyNegativeTimbreModel ? NULL : negativeTimbreModel, emptyNegativeChromaModel ? NULL : negativeChromaModel);
+        return classifyRecording(recording, timbreSamples, chromaSamples);
+    }
+    
+    double ClassificationCategory::classifyRecording(const databaseentities::Recording& recording, const GMMSampleSet<kiss_fft_scalar>& timbreSamples, const GMMSampleSet<kiss_fft_scalar>& chromaSamples)
+    {
+        if (recording.getRecordingFeatures() == NULL)
+            return 0.0;
         
-        delete timbreModel;
-        delete chromaModel;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> posVec = createVectorForFeatures(timbreSamples, chromaSamples, recording.getRecordingFeatures()->getDynamicRange(), recording.getRecordingFeatures()->getLength(), emptyPositiveTimbreModel ? NULL : positiveTimbreModel, emptyPositiveChromaModel ? NULL : positiveChromaModel);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> negVec = createVectorForFeatures(timbreSamples, chromaSamples, recording.getRecordingFeatures()->getDynamicRange(), recording.getRecordingFeatures()->getLength(), emptyNegativeTimbreModel ? NULL : negativeTimbreModel, emptyNegativeChromaModel ? NULL : negativeChromaModel);
         
         return (emptyPosClassifierModel ? 0.0 : 1.0/(1.0+posClassifier->classifyVector(posVec)))
             - (emptyNegClassifierModel ? 0.0 : 1.0/(1.0+negClassifier->classifyVector(negVec)));
@@ -42,10 +42,17 @@ namespace music
         bool emptyPosClassifierModel;
         bool emptyNegClassifierModel;
         
+        unsigned int threadCount;
+        //more samples than this are not kept in memory, the models are trained online then.
+        unsigned int maxSampleCount;
+        unsigned int onlineBatchSize;
+        //build the models by merging the gaussians of the examples instead of drawing samples.
+        bool modelReduction;
+        
         bool calculateModel(GaussianMixtureModel<kiss_fft_scalar>*& model, std::vector<GaussianMixtureModel<kiss_fft_scalar>*> components, unsigned int gaussianCount, unsigned int samplesPerGMM, ProgressCallbackCaller* callback = NULL, double initVariance = 100.0, double minVariance = 0.1);
         
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> createVectorForFeatures(databaseentities::RecordingFeatures* features, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel);
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> createVectorForFeatures(GaussianMixtureModel<kiss_fft_scalar>* timbreModel, GaussianMixtureModel<kiss_fft_scalar>* chromaModel, double dynamicRange, double length, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> createVectorForFeatures(const GMMSampleSet<kiss_fft_scalar>& timbreSamples, const GMMSampleSet<kiss_fft_scalar>& chromaSamples, double dynamicRange, double length, GaussianMixtureModel<kiss_fft_scalar>* categoryTimbreModel, GaussianMixtureModel<kiss_fft_scalar>* categoryChromaModel);
         
         /**
          * @brief Calculates a positive timbre model for the given set of
@@ -127,6 +134,64 @@ namespace music
         
         
         
+        /**
+         * @brief Sets the number of threads the training of the models is split across.
+         * 
+         * @see GaussianMixtureModel::setThreadCount()
+         * @param threadCount The number of threads. The default is <code>1</code>.
+         */
+        void setThreadCount(unsigned int threadCount)   {this->threadCount = threadCount;}
+        /**
+         * @brief Returns the number of threads the training of the models is split across.
+         * @return the number of threads the training of the models is split across.
+         */
+        unsigned int getThreadCount() const             {return threadCount;}
+        
+        /**
+         * @brief Sets the maximum number of samples the models are trained with at once.
+         * 
+         * The models of a category are trained with samples drawn from the models of its
+         * examples, <code>samplesPerGMM</code> per example. If that would be more than
+         * <code>maxSampleCount</code> samples, they are not drawn in advance. Instead,
+         * the models are trained with the online EM algorithm on <code>maxSampleCount</code>
+         * samples, which are drawn in batches of <code>onlineBatchSize</code> samples from randomly
+         * chosen examples. Then, memory and time do not grow with the number of examples.
+         * 
+         * @see GaussianMixtureModel::trainGMMOnline()
+         * @param maxSampleCount The maximum number of samples. The default is <code>1000000</code>.
+         * @param onlineBatchSize The number of samples per batch of the online EM algorithm.
+         *      Needs to be larger than the number of gaussians. The default is <code>10000</code>.
+         */
+        void setMaxSampleCount(unsigned int maxSampleCount, unsigned int onlineBatchSize = 10000)
+        {
+            this->maxSampleCount = maxSampleCount;
+            this->onlineBatchSize = onlineBatchSize;
+        }
+        /**
+         * @brief Returns the maximum number of samples the models are trained with at once.
+         * @return the maximum number of samples the models are trained with at once.
+         */
+        unsigned int getMaxSampleCount() const          {return maxSampleCount;}
+        
+        /**
+         * @brief Sets if the models of a category are built by merging the gaussians of its examples.
+         * 
+         * If set, no samples are drawn from the models of the examples.
+         * Their gaussians are pooled and merged until the models have the
+         * requested number of gaussians, which is faster than the EM algorithm on
+         * the samples. <code>samplesPerGMM</code> and the maximum sample count are ignored then.
+         * 
+         * @see GaussianMixtureModel::trainGMMFromModels()
+         * @param modelReduction If the models should be built by merging gaussians.
+         *      The default is <code>false</code>.
+         */
+        void setModelReduction(bool modelReduction)     {this->modelReduction = modelReduction;}
+        /**
+         * @brief Returns if the models of a category are built by merging the gaussians of its examples.
+         * @return if the models of a category are built by merging the gaussians of its examples.
+         */
+        bool getModelReduction() const                  {return modelReduction;}
+        
         GaussianMixtureModel<kiss_fft_scalar>* getPositiveTimbreModel()
         {
             return emptyPositiveTimbreModel ? NULL : positiveTimbreModel;
@@ -206,6 +271,31 @@ namespace music
          * @return The score of the recording, or 0.0 if no features were found.
          */
         double classifyRecording(const databaseentities::Recording& recording);
+        /**
+         * @brief Classifies a recording, with samples that have already been
+         *      drawn from its models.
+         * 
+         * If a recording is classified for a lot of categories, draw the
+         * samples once with drawComparisonSamples() and use them for every category.
+         * 
+         * @param recording A recording that should be classified. The recording
+         *      should have its RecordingFeatures loaded.
+         * @param timbreSamples The samples of the timbre model of the recording.
+         * @param chromaSamples The samples of the chroma model of the recording.
+         * 
+         * @return The score of the recording, or 0.0 if no features were found.
+         */
+        double classifyRecording(const databaseentities::Recording& recording, const GMMSampleSet<kiss_fft_scalar>& timbreSamples, const GMMSampleSet<kiss_fft_scalar>& chromaSamples);
+        
+        /**
+         * @brief Draws the samples of the models of a recording that are
+         *      used to compare them with the models of the categories.
+         * 
+         * @param features The features of the recording.
+         * @param[out] timbreSamples The samples of the timbre model.
+         * @param[out] chromaSamples The samples of the chroma model.
+         */
+        static void drawComparisonSamples(const databaseentities::RecordingFeatures& features, GMMSampleSet<kiss_fft_scalar>& timbreSamples, GMMSampleSet<kiss_fft_scalar>& chromaSamples);
         
         /**
          * @brief Calculates the model for the classificator when given a list of
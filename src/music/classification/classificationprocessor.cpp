@@ -6,12 +6,13 @@
 
 namespace music
 {
-    ClassificationProcessor::ClassificationProcessor(DatabaseConnection* conn, unsigned int categoryTimbreModelSize, unsigned int categoryTimbrePerSongSampleCount, unsigned int categoryChromaModelSize, unsigned int categoryChromaPerSongSampleCount) :
+    ClassificationProcessor::ClassificationProcessor(DatabaseConnection* conn, unsigned int categoryTimbreModelSize, unsigned int categoryTimbrePerSongSampleCount, unsigned int categoryChromaModelSize, unsigned int categoryChromaPerSongSampleCount, unsigned int threadCount) :
         conn(conn),
         categoryTimbreModelSize(categoryTimbreModelSize),
         categoryTimbrePerSongSampleCount(categoryTimbrePerSongSampleCount),
         categoryChromaModelSize(categoryChromaModelSize),
-        categoryChromaPerSongSampleCount(categoryChromaPerSongSampleCount)
+        categoryChromaPerSongSampleCount(categoryChromaPerSongSampleCount),
+        threadCount(threadCount)
     {
         
     }
@@ -47,6 +48,7 @@ namespace music
         
         //TODO: HERE: USE CLASSIFCATIONCATEGORY
         ClassificationCategory cat;
+        cat.setThreadCount(threadCount);
         cat.calculateClassificatorModel(positiveExamples, negativeExamples, categoryTimbreModelSize, categoryTimbrePerSongSampleCount, categoryChromaModelSize, categoryChromaPerSongSampleCount, callback);
         
         //TODO: save models to database
@@ -210,6 +212,12 @@ namespace music
     {
         ClassificationCategory cat;
         
+        //the same samples of the models of the recording for all categories.
+        GMMSampleSet<kiss_fft_scalar> timbreSamples;
+        GMMSampleSet<kiss_fft_scalar> chromaSamples;
+        if (recording.getRecordingFeatures() != NULL)
+            ClassificationCategory::drawComparisonSamples(*recording.getRecordingFeatures(), timbreSamples, chromaSamples);
+        
         std::vector<databaseentities::id_datatype> categoryIDs;
         conn->getCategoryIDsByName(categoryIDs, "%");   //read all category IDs
         
@@ -229,7 +237,7 @@ namespace music
                 category.getCategoryDescription()->getNegativeClassifierDescription()
                 );
             
-            if (!conn->updateRecordingToCategoryScore(recording.getID(), category.getID(), cat.classifyRecording(recording)))
+            if (!conn->updateRecordingToCategoryScore(recording.getID(), category.getID(), cat.classifyRecording(recording, timbreSamples, chromaSamples)))
             {
                 conn->rollbackTransaction();
                 return false;
@@ -63,9 +63,21 @@ namespace music
         unsigned int categoryTimbrePerSongSampleCount;
         unsigned int categoryChromaModelSize;
         unsigned int categoryChromaPerSongSampleCount;
+        unsigned int threadCount;
         
     public:
-        ClassificationProcessor(DatabaseConnection* conn, unsigned int categoryTimbreModelSize = 60, unsigned int categoryTimbrePerSongSampleCount = 20000, unsigned int categoryChromaModelSize = 8, unsigned int categoryChromaPerSongSampleCount = 2000);
+        /**
+         * @brief Creates a new classification processor.
+         * 
+         * @param conn The database the categories and recordings are read from and written to.
+         * @param categoryTimbreModelSize The number of gaussians of the timbre models of a category.
+         * @param categoryTimbrePerSongSampleCount The number of samples drawn from the timbre model of every example.
+         * @param categoryChromaModelSize The number of gaussians of the chroma models of a category.
+         * @param categoryChromaPerSongSampleCount The number of samples drawn from the chroma model of every example.
+         * @param threadCount The number of threads the training of the category models is split across.
+         *      The models do not depend on the number of threads.
+         */
+        ClassificationProcessor(DatabaseConnection* conn, unsigned int categoryTimbreModelSize = 60, unsigned int categoryTimbrePerSongSampleCount = 20000, unsigned int categoryChromaModelSize = 8, unsigned int categoryChromaPerSongSampleCount = 2000, unsigned int threadCount = 1);
         
         
         /**
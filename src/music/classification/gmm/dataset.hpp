@@ -0,0 +1,139 @@
+#ifndef DATASET_HPP
+#define DATASET_HPP
+
+#include <Eigen/Dense>
+#include <vector>
+#include <assert.h>
+
+namespace music
+{
+    /**
+     * @brief A set of data vectors of the same dimension, stored in one
+     *      contiguous block of memory.
+     * 
+     * Column <code>i</code> of the matrix is data vector <code>i</code>. The
+     * matrix is column-major, so every data vector lies contiguous in memory,
+     * and the data vectors follow each other. Compared to a
+     * <code>std::vector</code> of single vectors, there is only one heap
+     * allocation for the whole set, and algorithms running over all
+     * data vectors read the memory linearly.
+     * 
+     * Since this class is an Eigen matrix, you can use all of Eigen's views on it,
+     * e.g. <code>data.col(i)</code> for a single data vector, or
+     * <code>data.middleCols(i, n)</code> for a block of data vectors, without
+     * copying anything.
+     * 
+     * @code
+     * std::vector<Eigen::Matrix<float, Eigen::Dynamic, 1> > vectors;
+     * //fill vectors here
+     * DataSet<float> data(vectors);
+     * 
+     * GaussianMixtureModelDiagCov<float> gmm;
+     * gmm.trainGMM(data, 10);
+     * @endcode
+     * 
+     * @tparam ScalarType The type of the scalars of the data vectors.
+     * @ingroup classification
+     */
+    template <typename ScalarType>
+    class DataSet : public Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>
+    {
+    public:
+        typedef Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> Base;
+        
+        /**
+         * @brief Creates an empty data set.
+         */
+        DataSet() : Base()
+        {
+            
+        }
+        
+        /**
+         * @brief Creates a data set with uninitialized data vectors.
+         * 
+         * @param dimension The dimension of the data vectors.
+         * @param size The number of data vectors.
+         */
+        DataSet(int dimension, int size) : Base(dimension, size)
+        {
+            
+        }
+        
+        /**
+         * @brief Creates a data set from a matrix, or an Eigen expression.
+         * Every column is one data vector.
+         */
+        template <typename OtherDerived>
+        DataSet(const Eigen::MatrixBase<OtherDerived>& other) : Base(other)
+        {
+            
+        }
+        
+        /**
+         * @brief Copies the data vectors into a new data set.
+         * 
+         * @param vectors The data vectors. All of them need to have the same dimension.
+         */
+        explicit DataSet(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& vectors) : Base()
+        {
+            assign(vectors);
+        }
+        
+        template <typename OtherDerived>
+        DataSet<ScalarType>& operator=(const Eigen::MatrixBase<OtherDerived>& other)
+        {
+            this->Base::operator=(other);
+            return *this;
+        }
+        
+        /**
+         * @brief Returns the dimension of the data vectors.
+         * @return the dimension of the data vectors.
+         */
+        int getDimension() const                {return this->rows();}
+        /**
+         * @brief Returns the number of data vectors.
+         * @return the number of data vectors.
+         */
+        int getSize() const                     {return this->cols();}
+        
+        /**
+         * @brief Replaces the contents of this data set with copies of the data vectors.
+         * 
+         * @param vectors The data vectors. All of them need to have the same dimension.
+         */
+        void assign(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& vectors)
+        {
+            if (vectors.empty())
+            {
+                this->resize(0, 0);
+                return;
+            }
+            
+            this->resize(vectors[0].size(), vectors.size());
+            for (unsigned int i=0; i<vectors.size(); i++)
+            {
+                assert(vectors[i].size() == this->rows());
+                this->col(i) = vectors[i];
+            }
+        }
+        
+        /**
+         * @brief Appends copies of all data vectors to a <code>std::vector</code>.
+         * 
+         * Use this function if you need to call a function which only
+         * accepts single vectors.
+         * 
+         * @param[in,out] vectors The vector the data vectors will be appended to.
+         */
+        void toVectors(std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& vectors) const
+        {
+            vectors.reserve(vectors.size() + this->cols());
+            for (int i=0; i<this->cols(); i++)
+                vectors.push_back(this->col(i));
+        }
+    };
+}
+
+#endif  //DATASET_HPP
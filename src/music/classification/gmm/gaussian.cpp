@@ -7,7 +7,7 @@ namespace music
 {
     template <typename ScalarType>
     Gaussian<ScalarType>::Gaussian(unsigned int dimension, NormalRNG<ScalarType>* rng) :
-        weight(1.0), mean(dimension), preFactor(), rng(rng), externalRNG(rng!=NULL), pseudoInverse(NULL)
+        weight(1.0), mean(dimension), preFactor(), logPreFactor(), rng(rng), externalRNG(rng!=NULL)
     {
         mean.setZero();
         
@@ -17,7 +17,7 @@ namespace music
     
     template <typename ScalarType>
     Gaussian<ScalarType>::Gaussian(double weight, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& mean, NormalRNG<ScalarType>* rng) :
-        weight(weight), mean(mean), preFactor(), rng(rng), externalRNG(rng!=NULL), pseudoInverse(NULL)
+        weight(weight), mean(mean), preFactor(), logPreFactor(), rng(rng), externalRNG(rng!=NULL)
     {
         assert(weight >= 0.0);
         assert(weight <= 1.0);
@@ -28,7 +28,7 @@ namespace music
     
     template <typename ScalarType>
     Gaussian<ScalarType>::Gaussian(const Gaussian<ScalarType>& other) :
-        weight(other.weight), mean(other.mean), preFactor(), rng(NULL), externalRNG(other.externalRNG), pseudoInverse(NULL)
+        weight(other.weight), mean(other.mean), preFactor(), logPreFactor(), rng(NULL), externalRNG(other.externalRNG)
     {
         if (externalRNG)
             this->rng = other.rng;
@@ -36,33 +36,6 @@ namespace music
             this->rng = new NormalRNG<ScalarType>();
     }
     
-    template <typename ScalarType>
-    double Gaussian<ScalarType>::calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2)
-    {
-        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> tmp = vector1 - vector2;
-        if (pseudoInverse)
-        {
-            /*DEBUG_OUT("pseudo", 10);
-            DEBUG_VAR_OUT(*pseudoInverse, 0);
-            DEBUG_VAR_OUT(tmp, 0);
-            DEBUG_VAR_OUT(getCovarianceMatrix(), 0);
-            DEBUG_VAR_OUT(getCovarianceMatrix().determinant(), 0);
-            DEBUG_VAR_OUT((*pseudoInverse) * tmp, 0);
-            DEBUG_VAR_OUT(tmp.transpose() * (*pseudoInverse), 0);
-            DEBUG_VAR_OUT(tmp.transpose() * (*pseudoInverse) * tmp, 0);*/
-            return std::sqrt(tmp.transpose() * (*pseudoInverse) * tmp);
-        }
-        else
-        {
-            /*DEBUG_OUT("nonpseudo", 10);
-            DEBUG_VAR_OUT(tmp, 0);
-            DEBUG_VAR_OUT(getCovarianceMatrix(), 0);
-            DEBUG_VAR_OUT(getCovarianceMatrix().determinant(), 0);
-            DEBUG_VAR_OUT(tmp.transpose() * llt.solve(tmp), 0);*/
-            return std::sqrt(tmp.transpose() * llt.solve(tmp));
-        }
-    }
-    
     template <typename ScalarType>
     double Gaussian<ScalarType>::calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1)
     {
@@ -74,8 +47,6 @@ namespace music
     {
         if (!externalRNG)
             delete rng;
-        if (pseudoInverse)
-            delete pseudoInverse;
     }
     
     template <typename ScalarType>
@@ -220,23 +191,32 @@ namespace music
     double GaussianDiagCov<ScalarType>::calculateValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector)
     {
         assert(dataVector.size() == mean.size());
-        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist = dataVector - mean;
-        //Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist2 = dist;
-        return preFactor * std::exp(-0.5 * (dist.transpose() * ldlt.solve(dist))(0));
+        return preFactor * std::exp(-0.5 * (dataVector - mean).cwiseAbs2().dot(inverseDiagCov));
     }
     template <typename ScalarType>
     double GaussianDiagCov<ScalarType>::calculateValueWithoutWeights(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector)
     {
         assert(dataVector.size() == mean.size());
-        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist = dataVector - mean;
-        //Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist2 = dist;
-        return preFactorWithoutWeights * std::exp(-0.5 * (dist.transpose() * ldlt.solve(dist))(0));
+        return preFactorWithoutWeights * std::exp(-0.5 * (dataVector - mean).cwiseAbs2().dot(inverseDiagCov));
     }
     template <typename ScalarType>
     double GaussianDiagCov<ScalarType>::calculateNoMeanValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector)
     {
         assert(dataVector.size() == mean.size());
-        return preFactor * std::exp(-0.5 * (dataVector.transpose() * ldlt.solve(dataVector))(0));
+        return preFactor * std::exp(-0.5 * dataVector.cwiseAbs2().dot(inverseDiagCov));
+    }
+    template <typename ScalarType>
+    double GaussianDiagCov<ScalarType>::logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector) const
+    {
+        assert(dataVector.size() == mean.size());
+        return logPreFactor - 0.5 * (dataVector - mean).cwiseAbs2().dot(inverseDiagCov);
+    }
+    template <typename ScalarType>
+    void GaussianDiagCov<ScalarType>::logDensityBatch(const Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const
+    {
+        assert(data.rows() == mean.size());
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> dist = data.colwise() - mean;
+        logDensities = (logPreFactor - 0.5 * (inverseDiagCov.transpose() * dist.cwiseAbs2()).array().template cast<double>()).transpose();
     }
     template <typename ScalarType>
     Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> GaussianDiagCov<ScalarType>::rand() const
@@ -245,15 +225,27 @@ namespace music
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> y(mean.size());
         for (int i=0; i<mean.size(); i++)
             y[i] = rng->rand();
-        return llt.matrixL() * y + mean;
+        return standardDeviations.cwiseProduct(y) + mean;
+    }
+    template <typename ScalarType>
+    double GaussianDiagCov<ScalarType>::calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2)
+    {
+        return std::sqrt((vector1 - vector2).cwiseAbs2().dot(pseudoInverseDiagCov));
     }
     template <typename ScalarType>
     void GaussianDiagCov<ScalarType>::calculatePrefactor()
     {
-        double determinant = diagCov.cwiseSqrt().prod();
+        standardDeviations = diagCov.cwiseSqrt();
+        double determinant = standardDeviations.prod();
         assert(determinant != 0.0);
         preFactor = weight * 1.0/(pow(2*M_PI, diagCov.size()/2.0) * determinant);
         assert(preFactor != 0.0);
+        logPreFactor = log(weight) - 0.5 * (diagCov.size() * log(2*M_PI) + diagCov.template cast<double>().array().log().sum());
+        
+        //the densities divide by every variance a LDLT solve would divide by.
+        inverseDiagCov.resize(diagCov.size());
+        for (int i=0; i<diagCov.size(); i++)
+            inverseDiagCov[i] = (diagCov[i] > std::numeric_limits<ScalarType>::min()) ? ScalarType(1.0)/diagCov[i] : ScalarType(0.0);
         
         if (determinant < std::numeric_limits<ScalarType>::epsilon()) //not invertible
         {   //calculate moore-penrose pseudoinverse if covariance matrix is not invertible
@@ -272,12 +264,11 @@ namespace music
                 }
             }
             
-            if (pseudoInverse)
-                delete pseudoInverse;
-            pseudoInverse = new Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>(invEigenvalues.asDiagonal());
+            pseudoInverseDiagCov = invEigenvalues;
         }
         else
         {
+            pseudoInverseDiagCov = inverseDiagCov;
             preFactorWithoutWeights = 1.0/(pow(2*M_PI, diagCov.size()/2.0) * determinant);
             assert(preFactorWithoutWeights != 0.0);
         }
@@ -287,20 +278,11 @@ namespace music
     {
         assert(fullCov.rows() == mean.size());
         this->diagCov = fullCov.diagonal();
-        ldlt.compute(diagCov.asDiagonal());
-        llt.compute(diagCov.asDiagonal());
-        
-        if (pseudoInverse)
-        {
-            delete pseudoInverse;
-            pseudoInverse = NULL;
-        }
-        
         calculatePrefactor();
     }
     template <typename ScalarType>
     GaussianDiagCov<ScalarType>::GaussianDiagCov(unsigned int dimension, NormalRNG<ScalarType>* rng) :
-        Gaussian<ScalarType>(dimension, rng)
+        Gaussian<ScalarType>(dimension, rng), diagCov(dimension)
     {
         assert(this->rng != NULL);
         diagCov.setOnes();
@@ -320,8 +302,6 @@ namespace music
     {
         assert(this->rng != NULL);
         calculatePrefactor();
-        ldlt.compute(diagCov.asDiagonal());
-        llt.compute(diagCov.asDiagonal());
     }
     
     template <typename ScalarType>
@@ -329,6 +309,9 @@ namespace music
     {
         double determinant = fullCov.determinant();
         preFactor = weight * 1.0/(pow(2*M_PI, fullCov.rows()/2.0) * sqrt(determinant));
+        //the determinant may underflow, its logarithm does not.
+        Eigen::LDLT<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > logDetLDLT(fullCov.template cast<double>());
+        logPreFactor = log(weight) - 0.5 * (fullCov.rows() * log(2*M_PI) + logDetLDLT.vectorD().array().log().sum());
         
         if (determinant < std::numeric_limits<ScalarType>::epsilon())
         {   //calculate moore-penrose pseudoinverse if covariance matrix is not invertible
@@ -408,6 +391,21 @@ namespace music
         return preFactor * std::exp(-0.5 * (dataVector.transpose() * ldlt.solve(dataVector))(0));
     }
     template <typename ScalarType>
+    double GaussianFullCov<ScalarType>::logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector) const
+    {
+        assert(dataVector.size() == mean.size());
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist = dataVector - mean;
+        return logPreFactor - 0.5 * dist.dot(ldlt.solve(dist));
+    }
+    template <typename ScalarType>
+    void GaussianFullCov<ScalarType>::logDensityBatch(const Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const
+    {
+        assert(data.rows() == mean.size());
+        //(x-m)^T S^-1 (x-m) for all columns at once. uses the same factorization as logDensity().
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> dist = data.colwise() - mean;
+        logDensities = (logPreFactor - 0.5 * dist.cwiseProduct(ldlt.solve(dist)).colwise().sum().array().template cast<double>()).transpose();
+    }
+    template <typename ScalarType>
     Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> GaussianFullCov<ScalarType>::rand() const
     {
         assert(mean.size() > 0);
@@ -418,7 +416,7 @@ namespace music
     }
     template <typename ScalarType>
     GaussianFullCov<ScalarType>::GaussianFullCov(unsigned int dimension, NormalRNG<ScalarType>* rng) :
-        Gaussian<ScalarType>(dimension, rng), fullCov(dimension, dimension), ldlt()
+        Gaussian<ScalarType>(dimension, rng), fullCov(dimension, dimension), ldlt(), pseudoInverse(NULL)
     {
         assert(this->rng != NULL);
         fullCov = Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>::Ones(dimension).asDiagonal();
@@ -426,7 +424,7 @@ namespace music
     }
     template <typename ScalarType>
     GaussianFullCov<ScalarType>::GaussianFullCov(double weight, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& mean, NormalRNG<ScalarType>* rng) :
-        Gaussian<ScalarType>(weight, mean, rng), fullCov(mean.size(), mean.size())
+        Gaussian<ScalarType>(weight, mean, rng), fullCov(mean.size(), mean.size()), pseudoInverse(NULL)
     {
         assert(this->rng != NULL);
         fullCov = Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>::Ones(mean.size()).asDiagonal();
@@ -434,13 +432,45 @@ namespace music
     }
     template <typename ScalarType>
     GaussianFullCov<ScalarType>::GaussianFullCov(const GaussianFullCov<ScalarType>& other) :
-        Gaussian<ScalarType>(other), fullCov(other.fullCov)
+        Gaussian<ScalarType>(other), fullCov(other.fullCov), pseudoInverse(NULL)
     {
         assert(this->rng != NULL);
         calculatePrefactor();
         ldlt.compute(fullCov);
         llt.compute(fullCov);
     }
+    template <typename ScalarType>
+    GaussianFullCov<ScalarType>::~GaussianFullCov()
+    {
+        if (pseudoInverse)
+            delete pseudoInverse;
+    }
+    template <typename ScalarType>
+    double GaussianFullCov<ScalarType>::calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2)
+    {
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> tmp = vector1 - vector2;
+        if (pseudoInverse)
+        {
+            /*DEBUG_OUT("pseudo", 10);
+            DEBUG_VAR_OUT(*pseudoInverse, 0);
+            DEBUG_VAR_OUT(tmp, 0);
+            DEBUG_VAR_OUT(getCovarianceMatrix(), 0);
+            DEBUG_VAR_OUT(getCovarianceMatrix().determinant(), 0);
+            DEBUG_VAR_OUT((*pseudoInverse) * tmp, 0);
+            DEBUG_VAR_OUT(tmp.transpose() * (*pseudoInverse), 0);
+            DEBUG_VAR_OUT(tmp.transpose() * (*pseudoInverse) * tmp, 0);*/
+            return std::sqrt(tmp.transpose() * (*pseudoInverse) * tmp);
+        }
+        else
+        {
+            /*DEBUG_OUT("nonpseudo", 10);
+            DEBUG_VAR_OUT(tmp, 0);
+            DEBUG_VAR_OUT(getCovarianceMatrix(), 0);
+            DEBUG_VAR_OUT(getCovarianceMatrix().determinant(), 0);
+            DEBUG_VAR_OUT(tmp.transpose() * llt.solve(tmp), 0);*/
+            return std::sqrt(tmp.transpose() * llt.solve(tmp));
+        }
+    }
     
     
     template <typename ScalarType>
@@ -52,11 +52,10 @@ namespace music
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> mean;
         double preFactor;
         double preFactorWithoutWeights;
+        //logarithm of preFactor, also for gaussians whose prefactor does not fit into a double.
+        double logPreFactor;
         NormalRNG<ScalarType>* rng;
         bool externalRNG;
-        Eigen::LLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > llt;
-        
-        Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>* pseudoInverse;
         
         /**
          * @brief Calculates the prefactor of the gaussian, which is used in
@@ -113,6 +112,38 @@ namespace music
          */
         virtual double calculateNoMeanValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector)=0;
         
+        /**
+         * @brief Calculate the logarithm of the value of the gaussian distribution at the given position.
+         * 
+         * Same as <code>log(calculateValue(dataVector))</code>, but does not underflow
+         * for positions far away from the mean.
+         * 
+         * @return The logarithm of the value of the pdf at the given position, with the weight applied.
+         */
+        virtual double logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector) const=0;
+        /**
+         * @brief Calculate the logarithms of the values of the gaussian distribution at a lot of positions.
+         * 
+         * Works on all positions at once, which is faster than calling logDensity() for every position.
+         * 
+         * @param data The positions, one per column.
+         * @param[out] logDensities The logarithm of the value of the pdf, with the weight applied,
+         *      for every column of <code>data</code>.
+         */
+        void logDensityBatch(const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const
+            {logDensityBatch(Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >(data.data(), data.rows(), data.cols()), logDensities);}
+        /**
+         * @brief Calculate the logarithms of the values of the gaussian distribution at a lot of positions.
+         * 
+         * Same as above, for positions that are part of a larger matrix, e.g.
+         * some consecutive columns. They will not be copied.
+         * 
+         * @param data The positions, one per column.
+         * @param[out] logDensities The logarithm of the value of the pdf, with the weight applied,
+         *      for every column of <code>data</code>.
+         */
+        virtual void logDensityBatch(const Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const=0;
+        
         /**
          * @brief Get the weight factor of this gaussian.
          * @return The weight factor of this gaussian distribution.
@@ -179,7 +210,7 @@ namespace music
          * 
          * @return the Mahalanobis distance of the given vectors
          */
-        double calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2);
+        virtual double calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2)=0;
         double calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1);
         
         /**
@@ -254,13 +285,15 @@ namespace music
         using Gaussian<ScalarType>::mean;
         using Gaussian<ScalarType>::preFactor;
         using Gaussian<ScalarType>::preFactorWithoutWeights;
+        using Gaussian<ScalarType>::logPreFactor;
         using Gaussian<ScalarType>::rng;
         using Gaussian<ScalarType>::weight;
-        using Gaussian<ScalarType>::llt;
-        using Gaussian<ScalarType>::pseudoInverse;
         
         Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> fullCov;
         Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > ldlt;
+        Eigen::LLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > llt;
+        
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>* pseudoInverse;
         
         void calculatePrefactor();
     public:
@@ -286,15 +319,22 @@ namespace music
          */
         GaussianFullCov(double weight, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& mean, NormalRNG<ScalarType>* rng = NULL);
         GaussianFullCov(const GaussianFullCov<ScalarType>& other);
+        ~GaussianFullCov();
         double calculateValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
         double calculateValueWithoutWeights(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
         double calculateNoMeanValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
+        double logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector) const;
+        using Gaussian<ScalarType>::logDensityBatch;
+        void logDensityBatch(const Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const;
         void setCovarianceMatrix(const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>& matrix);
         Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> getCovarianceMatrix() const   {return fullCov;}
         
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> rand() const;
         Gaussian<ScalarType>* clone();
         
+        using Gaussian<ScalarType>::calculateDistance;
+        double calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2);
+        
         bool isFullCov() {return true;}
     };
     
@@ -316,13 +356,18 @@ namespace music
         using Gaussian<ScalarType>::mean;
         using Gaussian<ScalarType>::preFactor;
         using Gaussian<ScalarType>::preFactorWithoutWeights;
+        using Gaussian<ScalarType>::logPreFactor;
         using Gaussian<ScalarType>::rng;
         using Gaussian<ScalarType>::weight;
-        using Gaussian<ScalarType>::llt;
-        using Gaussian<ScalarType>::pseudoInverse;
         
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> diagCov;
-        Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > ldlt;
+        //everything is elementwise for diagonal covariance matricies, no factorization needed.
+        //zero only for variances a LDLT solve would treat as zero.
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> inverseDiagCov;
+        //used for distances. if the matrix is not invertible, this is the pseudoinverse,
+        //which is zero for the dimensions without variance.
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> pseudoInverseDiagCov;
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> standardDeviations;
         
         void calculatePrefactor();
     public:
@@ -351,12 +396,18 @@ namespace music
         double calculateValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
         double calculateValueWithoutWeights(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
         double calculateNoMeanValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector);
+        double logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& dataVector) const;
+        using Gaussian<ScalarType>::logDensityBatch;
+        void logDensityBatch(const Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const;
         Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> getCovarianceMatrix() const  {return diagCov.asDiagonal();}
         void setCovarianceMatrix(const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>& matrix);
         
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> rand() const;
         Gaussian<ScalarType>* clone();
         
+        using Gaussian<ScalarType>::calculateDistance;
+        double calculateDistance(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector1, const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& vector2);
+        
         bool isFullCov() {return false;}
     };
 }
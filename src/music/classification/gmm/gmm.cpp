@@ -5,25 +5,983 @@
 #include "debug.hpp"
 #include <set>
 #include <limits>
+#include <algorithm>
+#include "pthread.hpp"
+#include "kmeans.hpp"
 
 namespace music
 {
+
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::trainGMM(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, int gaussianCount, double initVariance, double minVariance)
+    {
+        trainGMM(DataSet<ScalarType>(data), gaussianCount, initVariance, minVariance);
+    }
     
     /**
-     * @todo precompute good starting vectors
      * @todo check result for being a local minimum
      */
     template <typename ScalarType>
-    void GaussianMixtureModel<ScalarType>::trainGMM(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, int gaussianCount, double initVariance, double minVariance)
+    void GaussianMixtureModel<ScalarType>::trainGMM(const DataSet<ScalarType>& data, int gaussianCount, double initVariance, double minVariance)
     {
-        //TODO: precompute good starting vectors.
         for (unsigned int i=0; i<gaussians.size(); i++)
             delete gaussians[i];
         gaussians.clear();
-        gaussians = this->emAlg(std::vector<Gaussian<ScalarType>*>(), data, gaussianCount, 10, initVariance, minVariance);
+        std::vector<Gaussian<ScalarType>*> init;
+        calculateInitGaussians(data, gaussianCount, initVariance, minVariance, init);
+        gaussians = this->emAlg(init, data, gaussianCount, maxIterations, initVariance, minVariance);
+        for (unsigned int i=0; i<init.size(); i++)
+            delete init[i];
         //TODO: check result for being a local minimum
     }
     
+    /**
+     * @brief The best log-likelihood of the restarts of GaussianMixtureModel::trainGMMBestOf()
+     *      that finished so far.
+     */
+    class GMMRestartState
+    {
+    private:
+        PThreadMutex mutex;
+        double bestLogLikelihood;
+    public:
+        GMMRestartState() :
+            mutex(), bestLogLikelihood(-std::numeric_limits<double>::infinity())
+        {
+            
+        }
+        
+        double getBestLogLikelihood()
+        {
+            PThreadMutexLocker locker(&mutex);
+            return bestLogLikelihood;
+        }
+        
+        void addLogLikelihood(double loglike)
+        {
+            PThreadMutexLocker locker(&mutex);
+            if (loglike > bestLogLikelihood)
+                bestLogLikelihood = loglike;
+        }
+    };
+    
+    /**
+     * @brief Trains every <code>step</code>-th model, beginning with model <code>first</code>.
+     */
+    template <typename ScalarType>
+    class GMMRestartThread : public PThread
+    {
+    private:
+        std::vector<GaussianMixtureModel<ScalarType>*>* models;
+        unsigned int first;
+        unsigned int step;
+        const DataSet<ScalarType>* data;
+        int gaussianCount;
+        double initVariance;
+        double minVariance;
+        GMMRestartState* restartState;
+    public:
+        GMMRestartThread(std::vector<GaussianMixtureModel<ScalarType>*>* models, unsigned int first, unsigned int step, const DataSet<ScalarType>* data, int gaussianCount, double initVariance, double minVariance, GMMRestartState* restartState) :
+            models(models), first(first), step(step), data(data), gaussianCount(gaussianCount),
+            initVariance(initVariance), minVariance(minVariance), restartState(restartState)
+        {
+            
+        }
+        
+        void run()
+        {
+            for (unsigned int i=first; i<models->size(); i+=step)
+            {
+                (*models)[i]->trainGMM(*data, gaussianCount, initVariance, minVariance);
+                restartState->addLogLikelihood((*models)[i]->getModelLogLikelihood());
+            }
+        }
+    };
+    
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::trainGMMBestOf(const DataSet<ScalarType>& data, int gaussianCount, unsigned int restartCount, unsigned int threadCount, double initVariance, double minVariance)
+    {
+        assert(restartCount > 0);
+        if (threadCount == 0)
+            threadCount = 1;
+        //threads which are not needed for the restarts split the EM algorithm of every restart.
+        unsigned int emThreadCount = 1;
+        if (threadCount > restartCount)
+        {
+            emThreadCount = threadCount / restartCount;
+            threadCount = restartCount;
+        }
+        
+        GMMRestartState state;
+        std::vector<GaussianMixtureModel<ScalarType>*> models;
+        for (unsigned int i=0; i<restartCount; i++)
+        {
+            GaussianMixtureModel<ScalarType>* model = this->clone();
+            model->useRandomSeed = true;
+            model->randomState = std::rand();
+            model->restartState = &state;
+            model->threadCount = emThreadCount;
+            models.push_back(model);
+        }
+        
+        //the calling thread trains its share of the models itself.
+        std::vector<GMMRestartThread<ScalarType>*> threads;
+        for (unsigned int t=1; t<threadCount; t++)
+        {
+            threads.push_back(new GMMRestartThread<ScalarType>(&models, t, threadCount, &data, gaussianCount, initVariance, minVariance, &state));
+            threads.back()->start();
+        }
+        GMMRestartThread<ScalarType>(&models, 0, threadCount, &data, gaussianCount, initVariance, minVariance, &state).run();
+        for (unsigned int t=0; t<threads.size(); t++)
+        {
+            threads[t]->join();
+            delete threads[t];
+        }
+        
+        unsigned int best = 0;
+        for (unsigned int i=1; i<restartCount; i++)
+        {
+            if (models[i]->getModelLogLikelihood() > models[best]->getModelLogLikelihood())
+                best = i;
+        }
+        DEBUG_OUT("best model: " << best << ", log-likelihood: " << models[best]->getModelLogLikelihood(), 20);
+        
+        //take over the gaussians of the best model.
+        for (unsigned int i=0; i<gaussians.size(); i++)
+            delete gaussians[i];
+        gaussians.clear();
+        gaussians.swap(models[best]->gaussians);
+        uniRNG = models[best]->uniRNG;
+        normalizationFactor = models[best]->normalizationFactor;
+        aic = models[best]->aic;
+        aicc = models[best]->aicc;
+        bic = models[best]->bic;
+        loglike = models[best]->loglike;
+        iterationCount = models[best]->iterationCount;
+        
+        for (unsigned int i=0; i<restartCount; i++)
+            delete models[i];
+    }
+    
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::trainGMMOnline(DataVectorGenerator<ScalarType>& generator, int gaussianCount, unsigned int dataCount, unsigned int batchSize, double initVariance, double minVariance, double stepSizeExponent)
+    {
+        assert(batchSize > (unsigned int)gaussianCount);
+        assert(stepSizeExponent > 0.5);
+        assert(stepSizeExponent <= 1.0);
+        
+        //the initial model and the center of the statistics come from the first batch.
+        DataSet<ScalarType> batch;
+        generator.generateDataVectors(batch, std::min(batchSize, dataCount));
+        assert((unsigned int)batch.cols() == std::min(batchSize, dataCount));
+        DEBUG_OUT("training initial model on the first batch...", 20);
+        trainGMM(batch, gaussianCount, initVariance, minVariance);
+        
+        Eigen::Matrix<double, Eigen::Dynamic, 1> center = batch.template cast<double>().rowwise().mean();
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > statistics;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > batchStatistics;
+        double averageLoglike = calculateOnlineStatistics(batch, center, minVariance, statistics) / batch.cols();
+        for (unsigned int i=0; i<statistics.size(); i++)
+            statistics[i] /= batch.cols();
+        
+        unsigned int dataDone = batch.cols();
+        unsigned int batchCount = 1;
+        while (dataDone < dataCount)
+        {
+            generator.generateDataVectors(batch, std::min(batchSize, dataCount - dataDone));
+            assert(batch.cols() > 0);
+            
+            //E-step with the current model.
+            double batchLoglike = calculateOnlineStatistics(batch, center, minVariance, batchStatistics);
+            
+            //the step size is per data vector, smaller batches at the end get a smaller step.
+            double stepSize = pow(batchCount + 1.0, -stepSizeExponent) * batch.cols() / batchSize;
+            for (unsigned int i=0; i<statistics.size(); i++)
+                statistics[i] = (1.0 - stepSize) * statistics[i] + (stepSize / batch.cols()) * batchStatistics[i];
+            averageLoglike = (1.0 - stepSize) * averageLoglike + stepSize * batchLoglike / batch.cols();
+            dataDone += batch.cols();
+            batchCount++;
+            
+            //M-step
+            setOnlineParameters(center, statistics, minVariance, averageLoglike * dataDone, dataDone);
+            DEBUG_OUT("online EM: " << dataDone << " of " << dataCount << " data vectors, log-likelihood per data vector: " << averageLoglike, 30);
+        }
+    }
+    
+    /**
+     * @brief Greedy reduction of a mixture of gaussians, see GaussianMixtureModel::trainGMMFromModels().
+     * 
+     * Every gaussian remembers its cheapest merge partner, so one merge
+     * usually only needs to look at all gaussians once, instead of at all pairs.
+     * Gaussians whose partner was merged need to look at all gaussians again,
+     * which makes a single merge quadratic in the worst case.
+     * Diagonal covariance matricies are stored as one column.
+     */
+    class RunnallsReduction
+    {
+    private:
+        bool diagonal;
+        std::vector<double> weights;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, 1> > means;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > covs;
+        std::vector<double> logDets;
+        std::vector<bool> active;
+        std::vector<unsigned int> partners;
+        std::vector<double> partnerCosts;
+        
+        double logDet(const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& cov) const
+        {
+            if (diagonal)
+                return cov.array().log().sum();
+            Eigen::LLT<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > llt(cov);
+            return 2.0 * llt.matrixLLT().diagonal().array().log().sum();
+        }
+        
+        //the gaussian with the same weight, mean and covariance as the mixture of i and j.
+        void merge(unsigned int i, unsigned int j, double& weight, Eigen::Matrix<double, Eigen::Dynamic, 1>& mean, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& cov) const
+        {
+            weight = weights[i] + weights[j];
+            double wi = weights[i] / weight;
+            double wj = weights[j] / weight;
+            Eigen::Matrix<double, Eigen::Dynamic, 1> diff = means[i] - means[j];
+            mean = wi * means[i] + wj * means[j];
+            if (diagonal)
+                cov = wi * covs[i] + wj * covs[j] + (wi * wj) * diff.cwiseAbs2();
+            else
+                cov = wi * covs[i] + wj * covs[j] + (wi * wj) * diff * diff.transpose();
+        }
+        
+        double cost(unsigned int i, unsigned int j) const
+        {
+            double weight;
+            Eigen::Matrix<double, Eigen::Dynamic, 1> mean;
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> cov;
+            merge(i, j, weight, mean, cov);
+            return 0.5 * (weight * logDet(cov) - weights[i] * logDets[i] - weights[j] * logDets[j]);
+        }
+        
+        void findPartner(unsigned int i)
+        {
+            partnerCosts[i] = std::numeric_limits<double>::max();
+            partners[i] = i;
+            for (unsigned int j=0; j<weights.size(); j++)
+            {
+                if ((j == i) || !active[j])
+                    continue;
+                double c = cost(i, j);
+                if (c < partnerCosts[i])
+                {
+                    partnerCosts[i] = c;
+                    partners[i] = j;
+                }
+            }
+        }
+    public:
+        RunnallsReduction(bool diagonal) :
+            diagonal(diagonal)
+        {
+            
+        }
+        
+        void addGaussian(double weight, const Eigen::Matrix<double, Eigen::Dynamic, 1>& mean, const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& cov)
+        {
+            weights.push_back(weight);
+            means.push_back(mean);
+            if (diagonal)
+                covs.push_back(cov.diagonal());
+            else
+                covs.push_back(cov);
+            logDets.push_back(logDet(covs.back()));
+            active.push_back(true);
+        }
+        
+        void reduce(unsigned int gaussianCount)
+        {
+            unsigned int count = weights.size();
+            if (count <= gaussianCount)
+                return;
+            
+            partners.resize(count);
+            partnerCosts.resize(count);
+            for (unsigned int i=0; i<count; i++)
+                findPartner(i);
+            
+            unsigned int activeCount = count;
+            while (activeCount > gaussianCount)
+            {
+                unsigned int i = count;
+                for (unsigned int k=0; k<count; k++)
+                {
+                    if (active[k] && ((i == count) || (partnerCosts[k] < partnerCosts[i])))
+                        i = k;
+                }
+                unsigned int j = partners[i];
+                
+                //the merged gaussian takes the place of i.
+                double weight;
+                Eigen::Matrix<double, Eigen::Dynamic, 1> mean;
+                Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> cov;
+                merge(i, j, weight, mean, cov);
+                weights[i] = weight;
+                means[i] = mean;
+                covs[i] = cov;
+                logDets[i] = logDet(cov);
+                active[j] = false;
+                activeCount--;
+                
+                //the costs of the other pairs do not change.
+                for (unsigned int k=0; k<count; k++)
+                {
+                    if (!active[k] || (k == i))
+                        continue;
+                    if ((partners[k] == i) || (partners[k] == j))
+                        findPartner(k);
+                    else
+                    {
+                        double c = cost(k, i);
+                        if (c < partnerCosts[k])
+                        {
+                            partnerCosts[k] = c;
+                            partners[k] = i;
+                        }
+                    }
+                }
+                findPartner(i);
+            }
+        }
+        
+        unsigned int getSize() const    {return weights.size();}
+        bool isActive(unsigned int i) const     {return active[i];}
+        double getWeight(unsigned int i) const  {return weights[i];}
+        const Eigen::Matrix<double, Eigen::Dynamic, 1>& getMean(unsigned int i) const   {return means[i];}
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> getCovarianceMatrix(unsigned int i) const
+        {
+            if (diagonal)
+                return covs[i].col(0).asDiagonal();
+            else
+                return covs[i];
+        }
+    };
+    
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::trainGMMFromModels(const std::vector<GaussianMixtureModel<ScalarType>*>& models, unsigned int gaussianCount)
+    {
+        assert(!models.empty());
+        assert(gaussianCount > 0);
+        
+        //every model gets the same total weight.
+        RunnallsReduction reduction(!isFullCov());
+        for (unsigned int m=0; m<models.size(); m++)
+        {
+            const std::vector<Gaussian<ScalarType>*>& modelGaussians = models[m]->gaussians;
+            double sumOfWeights = 0.0;
+            for (unsigned int g=0; g<modelGaussians.size(); g++)
+                sumOfWeights += modelGaussians[g]->getWeight();
+            for (unsigned int g=0; g<modelGaussians.size(); g++)
+            {
+                reduction.addGaussian(modelGaussians[g]->getWeight() / (sumOfWeights * models.size()),
+                    modelGaussians[g]->getMean().template cast<double>(), modelGaussians[g]->getCovarianceMatrix().template cast<double>());
+            }
+        }
+        DEBUG_OUT("reducing " << reduction.getSize() << " gaussians to " << gaussianCount << "...", 20);
+        reduction.reduce(gaussianCount);
+        
+        for (unsigned int i=0; i<gaussians.size(); i++)
+            delete gaussians[i];
+        gaussians.clear();
+        ScalarType sumOfWeights = 0.0;
+        normalizationFactor = 0.0;
+        for (unsigned int i=0; i<reduction.getSize(); i++)
+        {
+            if (!reduction.isActive(i))
+                continue;
+            unsigned int dimension = reduction.getMean(i).size();
+            Gaussian<ScalarType>* gaussian;
+            if (isFullCov())
+                gaussian = new GaussianFullCov<ScalarType>(dimension, normalRNG);
+            else
+                gaussian = new GaussianDiagCov<ScalarType>(dimension, normalRNG);
+            gaussian->setMean(reduction.getMean(i).template cast<ScalarType>());
+            gaussian->setCovarianceMatrix(reduction.getCovarianceMatrix(i).template cast<ScalarType>());
+            gaussian->setWeight(reduction.getWeight(i));
+            sumOfWeights += reduction.getWeight(i);
+            normalizationFactor += gaussian->calculateValue(gaussian->getMean());
+            gaussians.push_back(gaussian);
+        }
+        normalizationFactor /= gaussians.size();
+        uniRNG = UniformRNG<ScalarType>(0.0, sumOfWeights);
+        
+        aic = aicc = bic = loglike = 0.0;
+        iterationCount = 0;
+    }
+    
+    template <typename ScalarType>
+    unsigned int GaussianMixtureModel<ScalarType>::drawDataIndex(unsigned int dataSize)
+    {
+        unsigned int index;
+        if (useRandomSeed)
+            index = dataSize * (double(rand_r(&randomState)) / RAND_MAX);
+        else
+            index = UniformRNG<unsigned int>(0, dataSize).rand();
+        //the interval is closed for integer values.
+        return std::min(index, dataSize-1);
+    }
+    
+    template <typename ScalarType>
+    double GaussianMixtureModel<ScalarType>::drawUniform()
+    {
+        int value = useRandomSeed ? rand_r(&randomState) : std::rand();
+        return value / (double(RAND_MAX) + 1.0);
+    }
+    
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::calculateInitGaussians(const DataSet<ScalarType>& data, unsigned int gaussianCount, double initVariance, double minVariance, std::vector<Gaussian<ScalarType>*>& init)
+    {
+        init.clear();
+        if (initMethod == GMM_INIT_RANDOM)
+            return;
+        
+        unsigned int dimension = data.rows();
+        unsigned int dataSize = data.cols();
+        assert(dataSize >= gaussianCount);
+        
+        //k-means++ seeding. see KMeans::calculateInitGuess(), but with the random stream of this model.
+        DEBUG_OUT("choosing initial means with k-means++...", 20);
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > means;
+        means.push_back(data.col(drawDataIndex(dataSize)));
+        Eigen::Matrix<double, Eigen::Dynamic, 1> distances(dataSize);
+        distances.setConstant(std::numeric_limits<double>::max());
+        for (unsigned int g=1; g<gaussianCount; g++)
+        {
+            for (unsigned int i=0; i<dataSize; i++)
+                distances[i] = std::min(distances[i], (data.col(i) - means.back()).template cast<double>().squaredNorm());
+            means.push_back(data.col(drawWeightedIndex(distances, drawUniform())));
+        }
+        
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> variances = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Constant(dimension, gaussianCount, initVariance);
+        Eigen::Matrix<double, Eigen::Dynamic, 1> weights = Eigen::Matrix<double, Eigen::Dynamic, 1>::Constant(gaussianCount, 1.0/gaussianCount);
+        
+        if (initMethod == GMM_INIT_KMEANS)
+        {
+            //a few iterations are enough, the EM algorithm does the rest.
+            DEBUG_OUT("running k-means to initialize the gaussians...", 20);
+            KMeans<ScalarType, unsigned short> kmeans;
+            kmeans.trainKMeans(data, gaussianCount, 10, true, means);
+            means = kmeans.getMeans();
+            const std::vector<unsigned short>& assignments = kmeans.getAssignments();
+            
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> squaredDeviations = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(dimension, gaussianCount);
+            Eigen::Matrix<double, Eigen::Dynamic, 1> counts = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(gaussianCount);
+            for (unsigned int i=0; i<dataSize; i++)
+            {
+                squaredDeviations.col(assignments[i]) += (data.col(i) - means[assignments[i]]).template cast<double>().array().square().matrix();
+                counts[assignments[i]]++;
+            }
+            for (unsigned int g=0; g<gaussianCount; g++)
+            {
+                //clusters with less than two vectors have no variance, keep initVariance.
+                if (counts[g] > 1.0)
+                    variances.col(g) = (squaredDeviations.col(g) / counts[g]).cwiseMax(minVariance);
+            }
+            //empty clusters still get a small weight, such that they may catch some data.
+            weights = (counts.array() + 1.0) / double(dataSize + gaussianCount);
+        }
+        
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            Gaussian<ScalarType>* gaussian = new GaussianDiagCov<ScalarType>(dimension, normalRNG);
+            gaussian->setMean(means[g]);
+            gaussian->setCovarianceMatrix(variances.col(g).template cast<ScalarType>().asDiagonal());
+            gaussian->setWeight(weights[g]);
+            init.push_back(gaussian);
+        }
+    }
+    
+    template <typename ScalarType>
+    bool GaussianMixtureModel<ScalarType>::isLosingRestart(double loglike, double oldLoglike, unsigned int iteration, unsigned int maxIterations)
+    {
+        if (restartState == NULL)
+            return false;
+        
+        double bestLoglike = restartState->getBestLogLikelihood();
+        if (bestLoglike == -std::numeric_limits<double>::infinity())
+            return false;
+        
+        //oldLoglike is zero in the first iteration.
+        if (iteration <= 1)
+            return false;
+        
+        return loglike + (loglike - oldLoglike) * (maxIterations - iteration) < bestLoglike;
+    }
+    
+    //the step size of the accelerated EM algorithm grows by this factor with every
+    //step that increases the log-likelihood.
+    static const double emStepSizeGrowth = 1.5;
+    
+    //gaussians which represent less than this share of the data keep their
+    //parameters, and get this weight.
+    static const double minGaussianWeight = 1e-10;
+    
+    /**
+     * @brief Finds the gaussians which (almost) no data vector belongs to.
+     * 
+     * Their means and covariance matricies can not be estimated from the data,
+     * they need to keep the old ones. Their weights are set to
+     * <code>minGaussianWeight</code>, such that their log-weights stay finite,
+     * and all weights are normalized again.
+     * 
+     * @param[in,out] weights The weights after the M-step.
+     * @return A flag for every gaussian, set for the empty ones.
+     */
+    static std::vector<bool> floorEmptyGaussianWeights(Eigen::Matrix<double, Eigen::Dynamic, 1>& weights)
+    {
+        std::vector<bool> empty(weights.size(), false);
+        bool anyEmpty = false;
+        for (int g=0; g<weights.size(); g++)
+        {
+            if (!(weights[g] >= minGaussianWeight))
+            {
+                weights[g] = minGaussianWeight;
+                empty[g] = true;
+                anyEmpty = true;
+            }
+        }
+        if (anyEmpty)
+            weights /= weights.sum();
+        return empty;
+    }
+    
+    /**
+     * @brief Splits the data points of the EM algorithm into blocks, which are
+     *      processed in parallel.
+     * 
+     * The blocks only depend on the number of data points, not on the number
+     * of threads. Every block writes its partial sums to its own slot, and
+     * the slots are added up in block order afterwards. So the results
+     * do not depend on the number of threads.
+     * 
+     * The blocks are processed in chunks of at most <code>chunkSize</code>
+     * data points. The responsibilities of a chunk are folded into the sums of
+     * the block right away, so the memory needed does not grow with the number
+     * of data points.
+     */
+    class EMBlockJob
+    {
+    private:
+        unsigned int dataSize;
+        unsigned int blockCount;
+    public:
+        //blocks have at least this many data points, if there are enough of them...
+        static const unsigned int minBlockSize = 1024;
+        //...and there are at most this many blocks, which bounds the memory for the partial sums.
+        static const unsigned int maxBlockCount = 64;
+        //number of data points whose responsibilities are held in memory at the same time, per thread.
+        static const unsigned int chunkSize = 512;
+        
+        EMBlockJob(unsigned int dataSize) :
+            dataSize(dataSize), blockCount(std::min(maxBlockCount, std::max(1u, dataSize / minBlockSize)))
+        {
+            
+        }
+        virtual ~EMBlockJob() {}
+        
+        unsigned int getBlockCount() const {return blockCount;}
+        //the first dataSize % blockCount blocks get one data point more than the others.
+        unsigned int getBlockBegin(unsigned int block) const {return block * (dataSize / blockCount) + std::min(block, dataSize % blockCount);}
+        
+        /**
+         * @brief Processes the data points <code>from</code> to <code>to-1</code>,
+         *      which are block number <code>block</code>.
+         * 
+         * Will be called from several threads at the same time, with different blocks.
+         */
+        virtual void processBlock(unsigned int block, unsigned int from, unsigned int to)=0;
+        
+        /**
+         * @brief Processes all blocks and returns after all of them have been processed.
+         */
+        void run(unsigned int threadCount);
+    };
+    
+    const unsigned int EMBlockJob::minBlockSize;
+    const unsigned int EMBlockJob::maxBlockCount;
+    const unsigned int EMBlockJob::chunkSize;
+    
+    /**
+     * @brief Processes every <code>step</code>-th block of an EMBlockJob, beginning with block <code>first</code>.
+     */
+    class EMBlockThread : public PThread
+    {
+    private:
+        EMBlockJob* job;
+        unsigned int first;
+        unsigned int step;
+    public:
+        EMBlockThread(EMBlockJob* job, unsigned int first, unsigned int step) :
+            job(job), first(first), step(step)
+        {
+            
+        }
+        
+        void run()
+        {
+            for (unsigned int block=first; block<job->getBlockCount(); block+=step)
+                job->processBlock(block, job->getBlockBegin(block), job->getBlockBegin(block+1));
+        }
+    };
+    
+    void EMBlockJob::run(unsigned int threadCount)
+    {
+        if (threadCount > blockCount)
+            threadCount = blockCount;
+        if (threadCount == 0)
+            threadCount = 1;
+        
+        //the calling thread processes its share of the blocks itself.
+        std::vector<EMBlockThread*> threads;
+        for (unsigned int t=1; t<threadCount; t++)
+        {
+            threads.push_back(new EMBlockThread(this, t, threadCount));
+            threads.back()->start();
+        }
+        EMBlockThread(this, 0, threadCount).run();
+        for (unsigned int t=0; t<threads.size(); t++)
+        {
+            threads[t]->join();
+            delete threads[t];
+        }
+    }
+    
+    /**
+     * @brief One iteration of GaussianMixtureModelFullCov::emAlg() for a block: calculates the
+     *      responsibilities and the log-likelihood of the data points, and their
+     *      sufficient statistics for the M-step.
+     * 
+     * The statistics are calculated on the data points minus <code>dataMean</code>,
+     * in double precision.
+     */
+    template <typename ScalarType>
+    class FullCovEMJob : public EMBlockJob
+    {
+    private:
+        const DataSet<ScalarType>& data;
+        const Eigen::Matrix<double, Eigen::Dynamic, 1>& dataMean;
+        const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& means;
+        const std::vector<Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > >& ldlts;
+        //empty for gaussians that use the LDLT.
+        const std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> >& pseudoInverses;
+        const std::vector<double>& factors;
+        
+        //sum_i p_ig, sum_i p_ig x_i and sum_i p_ig x_i x_i^T of the block.
+        std::vector<Eigen::Matrix<double, 1, Eigen::Dynamic> > pSums;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > xSums;
+        std::vector<std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > > scatterSums;
+        std::vector<double> loglikes;
+    public:
+        FullCovEMJob(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& dataMean,
+                const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& means,
+                const std::vector<Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > >& ldlts,
+                const std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> >& pseudoInverses,
+                const std::vector<double>& factors) :
+            EMBlockJob(data.cols()), data(data), dataMean(dataMean), means(means), ldlts(ldlts), pseudoInverses(pseudoInverses), factors(factors),
+            pSums(getBlockCount()), xSums(getBlockCount()), scatterSums(getBlockCount()), loglikes(getBlockCount())
+        {
+            
+        }
+        
+        void processBlock(unsigned int block, unsigned int from, unsigned int to)
+        {
+            unsigned int dimension = data.rows();
+            unsigned int gaussianCount = means.size();
+            pSums[block].setZero(gaussianCount);
+            xSums[block].setZero(dimension, gaussianCount);
+            scatterSums[block].resize(gaussianCount);
+            for (unsigned int g=0; g<gaussianCount; g++)
+                scatterSums[block][g].setZero(dimension, dimension);
+            loglikes[block] = 0.0;
+            
+            Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> p;
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> x;
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> weightedX;
+            for (unsigned int chunkFrom=from; chunkFrom<to; chunkFrom+=chunkSize)
+            {
+                unsigned int chunkTo = std::min(chunkFrom + chunkSize, to);
+                p.resize(chunkTo - chunkFrom, gaussianCount);
+                
+                //for every gaussian do...
+                for (unsigned int g=0; g<gaussianCount; g++)
+                {
+                    //for every data point do...
+                    for (unsigned int i=chunkFrom; i<chunkTo; i++)
+                    {
+                        //calculate probability (non-normalized)
+                        if (pseudoInverses[g].size() != 0)
+                            p(i-chunkFrom,g) = -0.5 * ((data.col(i) - means[g]).transpose() * pseudoInverses[g] * (data.col(i) - means[g]))(0) + factors[g];
+                        else
+                            p(i-chunkFrom,g) = -0.5 * ((data.col(i) - means[g]).transpose() * ldlts[g].solve(data.col(i) - means[g]))(0) + factors[g];
+                    }
+                }
+                
+                double sum;
+                double max;
+                double logsum;
+                for (int i=0; i<p.rows(); i++)
+                {
+                    //normalize p.
+                    //use the log-exp-sum-trick from "Numerical Recipes", p.844-846
+                    max = p.row(i).maxCoeff();
+                    sum = (p.row(i) - max).exp().sum();
+                    logsum = log(sum);
+                    
+                    //resolve possible aliasing issues by calling eval().
+                    p.row(i) = (p.row(i) - (max + logsum)).exp().eval();
+                    
+                    loglikes[block] += max + logsum;
+                }
+                
+                //fold the responsibilities into the statistics, they are not needed afterwards.
+                x = data.middleCols(chunkFrom, chunkTo - chunkFrom).template cast<double>().colwise() - dataMean;
+                pSums[block] += p.colwise().sum().matrix();
+                xSums[block].noalias() += x * p.matrix();
+                for (unsigned int g=0; g<gaussianCount; g++)
+                {
+                    weightedX = (x.array().rowwise() * p.col(g).transpose()).matrix();
+                    scatterSums[block][g].noalias() += weightedX * x.transpose();
+                }
+            }
+        }
+        
+        /**
+         * @brief Adds up the results of the blocks in block order.
+         */
+        double getResults(Eigen::Matrix<double, 1, Eigen::Dynamic>& pSum, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& xSum, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& scatterSum) const
+        {
+            double loglike = loglikes[0];
+            pSum = pSums[0];
+            xSum = xSums[0];
+            scatterSum = scatterSums[0];
+            for (unsigned int block=1; block<getBlockCount(); block++)
+            {
+                loglike += loglikes[block];
+                pSum += pSums[block];
+                xSum += xSums[block];
+                for (unsigned int g=0; g<scatterSum.size(); g++)
+                    scatterSum[g] += scatterSums[block][g];
+            }
+            return loglike;
+        }
+    };
+    
+    /**
+     * @brief One iteration of GaussianMixtureModelDiagCov::emAlg() for a block: calculates the
+     *      responsibilities and the log-likelihood of the data points, and their
+     *      sufficient statistics for the M-step.
+     * 
+     * Both steps are written as matrix products over the data points and gaussians.
+     * They expand the squares (x-mu)^2, which loses precision for data far away from
+     * the origin. So they work on the data points minus <code>dataMean</code>, in double precision.
+     * The means and covariances need to be centered the same way.
+     */
+    template <typename ScalarType>
+    class DiagCovEMJob : public EMBlockJob
+    {
+    private:
+        const DataSet<ScalarType>& data;
+        const Eigen::Matrix<double, Eigen::Dynamic, 1>& dataMean;
+        const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& means;
+        const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& diagCovs;
+        const Eigen::Matrix<double, Eigen::Dynamic, 1>& weights;
+        
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> invDiagCovs;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> meansTimesInvDiagCovs;
+        Eigen::Matrix<double, 1, Eigen::Dynamic> constant;
+        
+        //sum_i p_ig, sum_i p_ig x_i and sum_i p_ig x_i^2 of the block, one column per gaussian.
+        std::vector<Eigen::Matrix<double, 1, Eigen::Dynamic> > pSums;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > xSums;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > xSquaredSums;
+        std::vector<double> loglikes;
+    public:
+        DiagCovEMJob(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& dataMean,
+                const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& means, const Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& diagCovs,
+                const Eigen::Matrix<double, Eigen::Dynamic, 1>& weights) :
+            EMBlockJob(data.cols()), data(data), dataMean(dataMean), means(means), diagCovs(diagCovs), weights(weights),
+            pSums(getBlockCount()), xSums(getBlockCount()), xSquaredSums(getBlockCount()), loglikes(getBlockCount())
+        {
+            
+        }
+        
+        /**
+         * @brief Runs one iteration with the current means, covariances and weights.
+         */
+        void run(unsigned int threadCount)
+        {
+            unsigned int dimension = data.rows();
+            invDiagCovs = diagCovs.cwiseInverse();
+            meansTimesInvDiagCovs = (means.array() * invDiagCovs.array()).matrix();
+            
+            //log of the normal distribution, with diagonal covariance matricies:
+            //  -0.5 * sum_d (x_d - mu_d)^2 / sigma_d + factor
+            //= -0.5 * (sum_d x_d^2/sigma_d - 2 * sum_d x_d * mu_d/sigma_d + sum_d mu_d^2/sigma_d) + factor
+            //the log of the determinant is the sum of the logs of the diagonal. the factor includes the log of the weight.
+            constant = (-0.5 * (means.array().square() * invDiagCovs.array()).colwise().sum()
+                - 0.5 * diagCovs.array().log().colwise().sum() - (0.5*dimension) * log(2*M_PI)
+                + weights.array().log().transpose()).matrix();
+            
+            EMBlockJob::run(threadCount);
+        }
+        
+        void processBlock(unsigned int block, unsigned int from, unsigned int to)
+        {
+            pSums[block].setZero(means.cols());
+            xSums[block].setZero(means.rows(), means.cols());
+            xSquaredSums[block].setZero(means.rows(), means.cols());
+            loglikes[block] = 0.0;
+            
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> x;
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> xSquared;
+            //log-densities first, responsibilities afterwards. one row per data point.
+            Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> p;
+            for (unsigned int chunkFrom=from; chunkFrom<to; chunkFrom+=chunkSize)
+            {
+                unsigned int chunkTo = std::min(chunkFrom + chunkSize, to);
+                x = data.middleCols(chunkFrom, chunkTo - chunkFrom).template cast<double>().colwise() - dataMean;
+                xSquared = x.array().square().matrix();
+                
+                p.noalias() = -0.5 * xSquared.transpose() * invDiagCovs;
+                p.noalias() += x.transpose() * meansTimesInvDiagCovs;
+                p.rowwise() += constant;
+                
+                //normalize p.
+                //use the log-exp-sum-trick from "Numerical Recipes", p.844-846
+                Eigen::Matrix<double, Eigen::Dynamic, 1> max = p.rowwise().maxCoeff();
+                p.colwise() -= max;
+                //responsibilities below exp(-100) do not change the result, but may be
+                //denormal numbers, which make the matrix products of the M-step very slow.
+                p = (p.array() < -100.0).select(0.0, p.array().exp()).matrix();
+                Eigen::Matrix<double, Eigen::Dynamic, 1> sum = p.rowwise().sum();
+                p = (p.array().colwise() / sum.array()).matrix();
+                loglikes[block] += (max.array() + sum.array().log()).sum();
+                
+                //fold the responsibilities into the statistics, they are not needed afterwards.
+                pSums[block] += p.colwise().sum();
+                xSums[block].noalias() += x * p;
+                xSquaredSums[block].noalias() += xSquared * p;
+            }
+        }
+        
+        /**
+         * @brief Adds up the results of the blocks in block order.
+         */
+        double getResults(Eigen::Matrix<double, 1, Eigen::Dynamic>& pSum, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& xSum, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& xSquaredSum) const
+        {
+            double loglike = loglikes[0];
+            pSum = pSums[0];
+            xSum = xSums[0];
+            xSquaredSum = xSquaredSums[0];
+            for (unsigned int block=1; block<getBlockCount(); block++)
+            {
+                loglike += loglikes[block];
+                pSum += pSums[block];
+                xSum += xSums[block];
+                xSquaredSum += xSquaredSums[block];
+            }
+            return loglike;
+        }
+    };
+    
+    /**
+     * @brief Prepares the E-step of GaussianMixtureModelFullCov: calculates the
+     *      decompositions of the covariance matricies and the normalization factors.
+     * 
+     * Variances smaller than <code>minVariance</code> are set to <code>minVariance</code> first.
+     * Singular covariance matricies get a pseudo-inverse, the others an LDLT.
+     * The factors include the log of the weights.
+     */
+    template <typename ScalarType>
+    void prepareFullCovEStep(std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >& fullCovs, const Eigen::Matrix<double, Eigen::Dynamic, 1>& weights, double minVariance,
+            std::vector<Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > >& ldlts,
+            std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> >& pseudoInverses,
+            std::vector<double>& factors)
+    {
+        unsigned int gaussianCount = fullCovs.size();
+        unsigned int dimension = (gaussianCount > 0) ? fullCovs[0].rows() : 0;
+        ldlts.resize(gaussianCount);
+        pseudoInverses.resize(gaussianCount);
+        factors.resize(gaussianCount);
+        
+        //for every gaussian do...
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            if ((fullCovs[g].diagonal().array() < minVariance).any())
+            {
+                //if there is a coefficient that is smaller than minVariance in
+                // magnitude, set it to minVariance. This helps with bad results
+                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> diag = fullCovs[g].diagonal();
+                for (int i=0; i<diag.size(); i++)
+                {
+                    if (fabs(diag[i]) < minVariance)
+                    {
+                        fullCovs[g](i, i) = minVariance;
+                    }
+                }
+            }
+            
+            //DEBUG_VAR_OUT(fullCovs[g], 0);
+            
+            ldlts[g].compute(fullCovs[g]);
+            //fullCovs[g].prod() is equal to its determinant for diagonal matricies.
+            //double factor = 1.0/(pow(2*M_PI, dimension/2.0) * sqrt(fullCovs[g].template cast<double>().determinant()));
+            double factor = -0.5*log(fullCovs[g].template cast<double>().determinant()) - (0.5*dimension) * log(2*M_PI);
+            
+            if (factor != factor)
+            {
+                //the matrix is singular (determinant is zero, so factor is NaN)
+                //moore-penrose pseudo-inverse and pseudo-determinant will be used
+                //to calculate the value
+                //this is okay (degenerate case of multivariate gaussian)
+                
+                //calculate schur decomposition, which is an eigenvalue decomposition
+                //for the case of symmteric matricies.
+                //this is equivalent to a singular value decomposition since covariance
+                //matricies are positive semi-definite and thus is suited to calculate both
+                //moore-penrose pseudo-inverse and pseudo-determinant
+                Eigen::RealSchur<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > rSchur(fullCovs[g].template cast<double>());
+                Eigen::Matrix<double, Eigen::Dynamic, 1> eigenvalues = rSchur.matrixT().diagonal();
+                Eigen::Matrix<double, Eigen::Dynamic, 1> invEigenvalues(eigenvalues.size());
+                
+                double logPseudoDet = 0.0;
+                int rank = 0;
+                for (int i=0; i<eigenvalues.size(); i++)
+                {
+                    if (eigenvalues[i] > eigenvalues.size() * std::numeric_limits<kiss_fft_scalar>::epsilon())   //sum only nonzero eigenvalues. zero are values smaller than dimension*machineepsilon
+                    {
+                        logPseudoDet += log(eigenvalues[i]);
+                        rank++;
+                        invEigenvalues[i] = 1.0/eigenvalues[i];
+                    }
+                    else
+                    {
+                        invEigenvalues[i] = 0.0;
+                    }
+                }
+                
+                //TODO: if rank==0, evil things happen, because one gaussian does not represent any samples.
+                
+                factor = -0.5*log(2.0*M_PI)*rank -0.5*logPseudoDet;
+                
+                pseudoInverses[g] =
+                    (rSchur.matrixU() * invEigenvalues.asDiagonal() * rSchur.matrixU().transpose()).template cast<kiss_fft_scalar>()
+                    ;
+            }
+            else
+            {
+                pseudoInverses[g].resize(0, 0);
+            }
+            factors[g] = factor + log(weights[g]);
+        }
+    }
+    
     /**
      * @bug This function does not work properly when you give it just a few data vectors.
      *      Seems to be a problem with linear dependent rows, as the covariance matricies are ill-conditioned
@@ -31,7 +989,7 @@ namespace music
      * @bug if the rank of a covariance matrix is zero, evil things happen.
      */
     template <typename ScalarType>
-    std::vector<Gaussian<ScalarType>*> GaussianMixtureModelFullCov<ScalarType>::emAlg(const std::vector<Gaussian<ScalarType>*>& init, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int gaussianCount, unsigned int maxIterations, double initVariance, double minVariance)
+    std::vector<Gaussian<ScalarType>*> GaussianMixtureModelFullCov<ScalarType>::emAlg(const std::vector<Gaussian<ScalarType>*>& init, const DataSet<ScalarType>& data, unsigned int gaussianCount, unsigned int maxIterations, double initVariance, double minVariance)
     {
         //if init is empty, choose some data points as initialization.
         //k-means or something else should be done by somebody else beforehand.
@@ -39,9 +997,9 @@ namespace music
         std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > means;
         std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > fullCovs;
         
-        unsigned int dimension = data[0].size();
+        unsigned int dimension = data.rows();
         assert(dimension > 0);
-        unsigned int dataSize = data.size();
+        unsigned int dataSize = data.cols();
         assert(dataSize > 0);
         assert(dataSize >= dimension);
         
@@ -51,10 +1009,9 @@ namespace music
             //init with random data points and identity matricies as covariance matrix
             //first add points to a set, such that we have distinct init elements.
             std::set<unsigned int> initElements;
-            UniformRNG<unsigned int> uniRNG(0, dataSize);
             while (initElements.size() < gaussianCount)
             {
-                int newElement = uniRNG.rand();
+                int newElement = this->drawDataIndex(dataSize);
                 if (initElements.count(newElement) == 0)
                 {
                     initElements.insert(newElement);
@@ -63,7 +1020,7 @@ namespace music
             //use the set to draw the elements
             for (std::set<unsigned int>::iterator it = initElements.begin(); it != initElements.end(); it++)
             {
-                means.push_back(data[*it]);
+                means.push_back(data.col(*it));
                 fullCovs.push_back(initVariance * Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>::Identity(dimension, dimension));
             }
         }
@@ -81,10 +1038,25 @@ namespace music
             }
         }
         
-        //set initial weights all equal to 1/gaussianCount
+        //set initial weights all equal to 1/gaussianCount, or take the ones given.
         Eigen::Matrix<double, Eigen::Dynamic, 1> weights = Eigen::Matrix<double, Eigen::Dynamic, 1>::Constant(gaussianCount, 1.0/double(gaussianCount));
+        for (unsigned int g=0; g<init.size(); g++)
+            weights[g] = init[g]->getWeight();
         Eigen::Matrix<double, Eigen::Dynamic, 1> oldWeights = weights;
-        Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> p(dataSize, gaussianCount);
+        //the statistics of the M-step are calculated on centered data.
+        Eigen::Matrix<double, Eigen::Dynamic, 1> dataMean = data.template cast<double>().rowwise().mean();
+        Eigen::Matrix<double, 1, Eigen::Dynamic> pSum;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> xSum;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > scatterSums;
+        std::vector<Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > > ldlts(gaussianCount);
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> > pseudoInverses(gaussianCount);
+        std::vector<double> factors(gaussianCount);
+        //the parameters after the plain step of the EM algorithm. the accelerated
+        //EM algorithm extrapolates from them, and falls back to them.
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > emMeans(gaussianCount);
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > emFullCovs(gaussianCount);
+        double stepSize = 1.0;
+        bool extrapolated = false;
         float loglike=0.0, oldLoglike=0.0;
         
         unsigned int iteration = 0;
@@ -99,147 +1071,77 @@ namespace music
             
             //E-step BEGIN
             DEBUG_OUT("E-step BEGIN", 30);
-            //for every gaussian do...
-            for (unsigned int g=0; g<gaussianCount; g++)
-            {
-                if ((fullCovs[g].diagonal().array() < minVariance).any())
-                {
-                    //if there is a coefficient that is smaller than minVariance in
-                    // magnitude, set it to minVariance. This helps with bad results
-                    Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> diag = fullCovs[g].diagonal();
-                    for (int i=0; i<diag.size(); i++)
-                    {
-                        if (fabs(diag[i]) < minVariance)
-                        {
-                            fullCovs[g](i, i) = minVariance;
-                        }
-                    }
-                }
-                
-                //DEBUG_VAR_OUT(fullCovs[g], 0);
-                
-                Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > ldlt(fullCovs[g]);
-                //fullCovs[g].prod() is equal to its determinant for diagonal matricies.
-                //double factor = 1.0/(pow(2*M_PI, dimension/2.0) * sqrt(fullCovs[g].template cast<double>().determinant()));
-                double factor = -0.5*log(fullCovs[g].template cast<double>().determinant()) - (0.5*dimension) * log(2*M_PI);
-                
-                if (factor != factor)
-                {
-                    //the matrix is singular (determinant is zero, so factor is NaN)
-                    //moore-penrose pseudo-inverse and pseudo-determinant will be used
-                    //to calculate the value
-                    //this is okay (degenerate case of multivariate gaussian)
-                    
-                    //calculate schur decomposition, which is an eigenvalue decomposition
-                    //for the case of symmteric matricies.
-                    //this is equivalent to a singular value decomposition since covariance
-                    //matricies are positive semi-definite and thus is suited to calculate both
-                    //moore-penrose pseudo-inverse and pseudo-determinant
-                    Eigen::RealSchur<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > rSchur(fullCovs[g].template cast<double>());
-                    Eigen::Matrix<double, Eigen::Dynamic, 1> eigenvalues = rSchur.matrixT().diagonal();
-                    Eigen::Matrix<double, Eigen::Dynamic, 1> invEigenvalues(eigenvalues.size());
-                    
-                    double logPseudoDet = 0.0;
-                    int rank = 0;
-                    for (int i=0; i<eigenvalues.size(); i++)
-                    {
-                        if (eigenvalues[i] > eigenvalues.size() * std::numeric_limits<kiss_fft_scalar>::epsilon())   //sum only nonzero eigenvalues. zero are values smaller than dimension*machineepsilon
-                        {
-                            logPseudoDet += log(eigenvalues[i]);
-                            rank++;
-                            invEigenvalues[i] = 1.0/eigenvalues[i];
-                        }
-                        else
-                        {
-                            invEigenvalues[i] = 0.0;
-                        }
-                    }
-                    
-                    //TODO: if rank==0, evil things happen, because one gaussian does not represent any samples.
-                    
-                    factor = -0.5*log(2.0*M_PI)*rank -0.5*logPseudoDet;
-                    
-                    Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> pseudoInverse =
-                        (rSchur.matrixU() * invEigenvalues.asDiagonal() * rSchur.matrixU().transpose()).template cast<kiss_fft_scalar>()
-                        ;
-                    
-                    //for every data point do...
-                    for (unsigned int i=0; i < dataSize; i++)
-                    {
-                        //calculate probability (non-normalized)
-                        //p(i,g) = factor * std::exp(-0.5 * ((data[i] - means[g]).transpose() * ldlt.solve(data[i] - means[g]))(0));
-                        p(i,g) = -0.5 * ((data[i] - means[g]).transpose() * pseudoInverse * (data[i] - means[g]))(0) + factor;
-                    }
-                }
-                else
-                {
-                    //for every data point do...
-                    for (unsigned int i=0; i < dataSize; i++)
-                    {
-                        //calculate probability (non-normalized)
-                        //p(i,g) = factor * std::exp(-0.5 * ((data[i] - means[g]).transpose() * ldlt.solve(data[i] - means[g]))(0));
-                        p(i,g) = -0.5 * ((data[i] - means[g]).transpose() * ldlt.solve(data[i] - means[g]))(0) + factor;
-                    }
-                }
-            }
-            
-            //DEBUG_VAR_OUT(p, 0);
+            prepareFullCovEStep(fullCovs, weights, minVariance, ldlts, pseudoInverses, factors);
             
-            double sum;
-            double max;
-            double logsum;
-            oldLoglike = loglike;
-            loglike=0.0;
-            for (unsigned int i=0; i<dataSize; i++)
-            {
-                //normalize p.
-                //use the log-exp-sum-trick from "Numerical Recipes", p.844-846
-                max = p.row(i).maxCoeff();
-                sum = (p.row(i) - max).exp().sum();
-                logsum = log(sum);
-                
-                //resolve possible aliasing issues by calling eval().
-                p.row(i) = (p.row(i) - (max + logsum)).exp().eval();
-                
-                loglike += max + logsum;
-            }
+            //calculate the probabilities of the data points and the sums for the M-step, in parallel.
+            FullCovEMJob<ScalarType> job(data, dataMean, means, ldlts, pseudoInverses, factors);
+            job.run(this->threadCount);
+            float newLoglike = job.getResults(pSum, xSum, scatterSums);
             DEBUG_OUT("E-step END", 30);
             //E-step END
             
-            //DEBUG_VAR_OUT(p, 0);
+            if (extrapolated && (newLoglike < loglike))
+            {
+                //the over-relaxed step went too far. take the plain step instead.
+                DEBUG_OUT("over-relaxed step with step size " << stepSize << " rejected.", 40);
+                means = emMeans;
+                fullCovs = emFullCovs;
+                stepSize = 1.0;
+                extrapolated = false;
+                continue;
+            }
+            oldLoglike = loglike;
+            loglike = newLoglike;
             
             //M-step BEGIN
             DEBUG_OUT("M-step BEGIN", 30);
-            Eigen::Matrix<double, Eigen::Dynamic, 1> prob(gaussianCount);
             //calculate probabilities for all clusters
-            prob = p.colwise().mean();
+            Eigen::Matrix<double, Eigen::Dynamic, 1> prob = pSum.transpose() / dataSize;
             DEBUG_VAR_OUT(prob.transpose(), 0);
+            std::vector<bool> empty = floorEmptyGaussianWeights(prob);
             for (unsigned int g=0; g<gaussianCount; g++)
             {
-                //calculate mu
-                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> mu(dimension);
-                mu.setZero();
-                for (unsigned int i=0; i<dataSize; i++)
+                if (empty[g])
                 {
-                    //aliasing occurs, but does not harm.
-                    mu.noalias() += (data[i] * p(i,g));
+                    DEBUG_OUT("gaussian " << g << " does not represent any data vectors, keeping it.", 30);
+                    emMeans[g] = means[g];
+                    emFullCovs[g] = fullCovs[g];
+                    continue;
                 }
-                mu = mu / (dataSize * prob(g));
-                
-                //calculate sigma
-                Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> sigma(dimension, dimension);
-                sigma.setZero();
-                for (unsigned int i=0; i< dataSize; i++)
+                //mu = sum_i p_ig x_i / sum_i p_ig
+                Eigen::Matrix<double, Eigen::Dynamic, 1> mu = xSum.col(g) / pSum[g];
+                //sigma = sum_i p_ig x_i x_i^T / sum_i p_ig - mu mu^T
+                emFullCovs[g] = (scatterSums[g] / pSum[g] - mu * mu.transpose()).template cast<ScalarType>();
+                emMeans[g] = (mu + dataMean).template cast<ScalarType>();
+            }
+            
+            extrapolated = false;
+            if (this->emAcceleration)
+            {
+                stepSize *= emStepSizeGrowth;
+                std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > newFullCovs(gaussianCount);
+                bool valid = true;
+                for (unsigned int g=0; (g<gaussianCount) && valid; g++)
                 {
-                    //sigma = sigma + (p(i,g) * (data[i] - mu).array().square()).matrix();
-                    Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> dist = data[i] - mu;
-                    sigma.noalias() += (p(i,g) * (dist * dist.transpose()));
+                    newFullCovs[g] = fullCovs[g] + ScalarType(stepSize) * (emFullCovs[g] - fullCovs[g]);
+                    //the covariance matricies need to stay positive definite, if the plain step keeps them that way.
+                    valid = (Eigen::LLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >(newFullCovs[g]).info() == Eigen::Success) ||
+                        (Eigen::LLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> >(emFullCovs[g]).info() != Eigen::Success);
                 }
-                sigma = sigma / (dataSize * prob(g));
-                //DEBUG_VAR_OUT(sigma, 0);
-                
-                means[g] = mu;
-                fullCovs[g] = sigma;
+                if (valid)
+                {
+                    for (unsigned int g=0; g<gaussianCount; g++)
+                        means[g] += ScalarType(stepSize) * (emMeans[g] - means[g]);
+                    fullCovs.swap(newFullCovs);
+                    extrapolated = true;
+                }
+                else
+                    stepSize = 1.0;
+            }
+            if (!extrapolated)
+            {
+                means = emMeans;
+                fullCovs = emFullCovs;
             }
             
             DEBUG_OUT("M-step END", 30);
@@ -250,7 +1152,17 @@ namespace music
             //    converged = true;
             if (fabs(oldLoglike - loglike) < 1e-6)
                 converged=true;
+            else if (this->isLosingRestart(loglike, oldLoglike, iteration, maxIterations))
+            {
+                DEBUG_OUT("another restart found a better model, abandoning this one.", 20);
+                break;
+            }
         }
+        //the model consists of the parameters after the last plain step, the
+        //over-relaxed ones have not been evaluated.
+        means = emMeans;
+        fullCovs = emFullCovs;
+        this->iterationCount = iteration;
         
         //get results with all-zero covariance matricies "right" (quick&dirty)
         for (unsigned int g=0; g<gaussianCount; g++)
@@ -303,62 +1215,75 @@ namespace music
     }
     
     template <typename ScalarType>
-    std::vector<Gaussian<ScalarType>*> GaussianMixtureModelDiagCov<ScalarType>::emAlg(const std::vector<Gaussian<ScalarType>*>& init, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int gaussianCount, unsigned int maxIterations, double initVariance, double minVariance)
+    std::vector<Gaussian<ScalarType>*> GaussianMixtureModelDiagCov<ScalarType>::emAlg(const std::vector<Gaussian<ScalarType>*>& init, const DataSet<ScalarType>& data, unsigned int gaussianCount, unsigned int maxIterations, double initVariance, double minVariance)
     {
         //if init is empty, choose some data points as initialization.
         //k-means or something else should be done by somebody else beforehand.
         
-        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > means;
-        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > diagCovs;
         std::vector<Gaussian<ScalarType>* > gaussians;
         
-        unsigned int dimension = data[0].size();
+        unsigned int dimension = data.rows();
         assert(dimension>0);
-        unsigned int dataSize = data.size();
+        unsigned int dataSize = data.cols();
         assert(dataSize>0);
         assert(dataSize > gaussianCount);
         assert(dataSize >= dimension);
         
+        //the means and covariances are centered and in double precision, see DiagCovEMJob.
+        Eigen::Matrix<double, Eigen::Dynamic, 1> dataMean = data.template cast<double>().rowwise().mean();
+        
+        //one column per gaussian.
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> means(dimension, gaussianCount);
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> diagCovs(dimension, gaussianCount);
+        
         if (init.empty())
         {
             DEBUG_OUT("no init vectors given. using random values...", 20);
             //init with random data points and identity matricies as covariance matrix
             //first add points to a set, such that we have distinct init elements.
             std::set<unsigned int> initElements;
-            UniformRNG<unsigned int> uniRNG(0, dataSize);
             while (initElements.size() < gaussianCount)
             {
-                int newElement = uniRNG.rand();
+                int newElement = this->drawDataIndex(dataSize);
                 if (initElements.count(newElement) == 0)
                 {
                     initElements.insert(newElement);
                 }
             }
             //use the set to draw the elements
-            for (std::set<unsigned int>::iterator it = initElements.begin(); it != initElements.end(); it++)
-            {
-                means.push_back(data[*it]);
-                diagCovs.push_back(Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>::Constant(dimension, 1, initVariance));
-            }
+            unsigned int g = 0;
+            for (std::set<unsigned int>::iterator it = initElements.begin(); it != initElements.end(); it++, g++)
+                means.col(g) = data.col(*it).template cast<double>() - dataMean;
+            diagCovs.setConstant(initVariance);
         }
         else
         {
             DEBUG_OUT("init vectors given. using them...", 20);
             assert(init.size() == gaussianCount);
-            //init with random data points and identity matricies as covariance matrix
             for (unsigned int g=0; g<gaussianCount; g++)
             {
                 DEBUG_OUT("adding gaussian distribution " << g << "...", 25);
                 
-                means.push_back(init[g]->getMean());
-                diagCovs.push_back(init[g]->getCovarianceMatrix());
+                means.col(g) = init[g]->getMean().template cast<double>() - dataMean;
+                diagCovs.col(g) = init[g]->getCovarianceMatrix().diagonal().template cast<double>();
             }
         }
         
-        //set initial weights all equal to 1/gaussianCount
+        //set initial weights all equal to 1/gaussianCount, or take the ones given.
         Eigen::Matrix<double, Eigen::Dynamic, 1> weights = Eigen::Matrix<double, Eigen::Dynamic, 1>::Constant(gaussianCount, 1.0/double(gaussianCount));
+        for (unsigned int g=0; g<init.size(); g++)
+            weights[g] = init[g]->getWeight();
         Eigen::Matrix<double, Eigen::Dynamic, 1> oldWeights = weights;
-        Eigen::Array<double, Eigen::Dynamic, Eigen::Dynamic> p(dataSize, gaussianCount);
+        DiagCovEMJob<ScalarType> job(data, dataMean, means, diagCovs, weights);
+        Eigen::Matrix<double, 1, Eigen::Dynamic> pSum;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> xSum;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> xSquaredSum;
+        //the parameters after the plain step of the EM algorithm. the accelerated
+        //EM algorithm extrapolates from them, and falls back to them.
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> emMeans;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> emDiagCovs;
+        double stepSize = 1.0;
+        bool extrapolated = false;
         double loglike=0.0, oldLoglike=0.0;
         
         unsigned int iteration = 0;
@@ -371,93 +1296,77 @@ namespace music
             assert(weights.sum() > 0.95);
             assert(weights.sum() < 1.05);
             
-            //E-step BEGIN
-            DEBUG_OUT("E-step BEGIN", 30);
-            //for every gaussian do...
+            //if there is a coefficient that is smaller than minVariance,
+            //set it to minVariance. This helps with bad results
             for (unsigned int g=0; g<gaussianCount; g++)
             {
-                //if there is a coefficient that is smaller than minVariance in
-                // magnitude, set it to minVariance. This helps with bad results
-                for (int i=0; i<diagCovs[g].size(); i++)
-                {
-                    if (fabs(diagCovs[g][i]) < minVariance)
-                    {
-                        diagCovs[g][i] = minVariance;
-                    }
-                }
-                //Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > ldlt(diagCovs[g].asDiagonal());
-                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> diagCovInv = diagCovs[g].array().inverse();
-                //diagCovs[g].prod() is equal to its determinant for diagonal matricies.
-                //taking the sqrt first helps with some accuracy issues
-                //double factor = 1.0/( pow(2*M_PI, dimension/2.0) * diagCovs[g].template cast<double>().cwiseSqrt().prod() );
-                
-                //alternative version with logarithms. log of determinant is sum of logs, since it is a log of a product.
-                double factor = -0.5 * diagCovs[g].array().log().sum() - (0.5*dimension) * log(2*M_PI);
-                
-                //for every data point do...
-                for (unsigned int i=0; i < dataSize; i++)
+                for (unsigned int i=0; i<dimension; i++)
                 {
-                    //calculate probability (non-normalized)
-                    //first version: with ldlt-solver. second version: optimized for diagonal matricies. third version: diagonal matricies with logarithms
-                    //p(i,g) = factor * std::exp(-0.5 * ((data[i] - means[g]).transpose() * ldlt.solve(data[i] - means[g]))(0));
-                    //p(i,g) = factor * std::exp(-0.5 * ((data[i] - means[g]).transpose() * (diagCovInv.array() * (data[i] - means[g]).array() ).matrix() )(0));
-                    p(i,g) = -0.5 * ((data[i] - means[g]).transpose() * (diagCovInv.array() * (data[i] - means[g]).array() ).matrix() )(0) + factor;
+                    if (diagCovs(i, g) < minVariance)
+                        diagCovs(i, g) = minVariance;
                 }
             }
             
-            //DEBUG_VAR_OUT(p, 0);
-            
-            double sum;
-            double max;
-            double logsum;
-            oldLoglike = loglike;
-            loglike=0.0;
-            for (unsigned int i=0; i<dataSize; i++)
-            {
-                //normalize p.
-                //use the log-exp-sum-trick from "Numerical Recipes", p.844-846
-                max = p.row(i).maxCoeff();
-                sum = (p.row(i) - max).exp().sum();
-                logsum = log(sum);
-                
-                //resolve possible aliasing issues by calling eval().
-                p.row(i) = (p.row(i) - (max + logsum)).exp().eval();
-                
-                loglike += max + logsum;
-            }
+            //E-step and the sums of the M-step, in parallel.
+            DEBUG_OUT("E-step BEGIN", 30);
+            job.run(this->threadCount);
+            double newLoglike = job.getResults(pSum, xSum, xSquaredSum);
             DEBUG_OUT("E-step END", 30);
             //E-step END
             
-            //DEBUG_VAR_OUT(p, 0);
+            if (extrapolated && (newLoglike < loglike))
+            {
+                //the over-relaxed step went too far. take the plain step instead.
+                DEBUG_OUT("over-relaxed step with step size " << stepSize << " rejected.", 40);
+                means = emMeans;
+                diagCovs = emDiagCovs;
+                stepSize = 1.0;
+                extrapolated = false;
+                continue;
+            }
+            oldLoglike = loglike;
+            loglike = newLoglike;
             
             //M-step BEGIN
             DEBUG_OUT("M-step BEGIN", 30);
-            Eigen::Matrix<double, Eigen::Dynamic, 1> prob(gaussianCount);
             //calculate probabilities for all clusters
-            prob = p.colwise().mean();
+            Eigen::Matrix<double, Eigen::Dynamic, 1> prob = pSum.transpose() / dataSize;
+            std::vector<bool> empty = floorEmptyGaussianWeights(prob);
+            
+            //mu = sum_i p_ig x_i / sum_i p_ig
+            emMeans = (xSum.array().rowwise() / pSum.array()).matrix();
+            //sigma = sum_i p_ig x_i^2 / sum_i p_ig - mu^2
+            //rounding errors may make this slightly negative. the next E-step fixes that.
+            emDiagCovs = ((xSquaredSum.array().rowwise() / pSum.array()) - emMeans.array().square()).matrix();
             for (unsigned int g=0; g<gaussianCount; g++)
             {
-                //calculate mu
-                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> mu(dimension);
-                mu.setZero();
-                for (unsigned int i=0; i<dataSize; i++)
+                if (empty[g])
                 {
-                    //aliasing occurs, but does not harm.
-                    mu.noalias() += (data[i] * p(i,g));
+                    DEBUG_OUT("gaussian " << g << " does not represent any data vectors, keeping it.", 30);
+                    emMeans.col(g) = means.col(g);
+                    emDiagCovs.col(g) = diagCovs.col(g);
                 }
-                mu = mu / (dataSize * prob(g));
-                
-                //calculate sigma
-                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> sigma(dimension);
-                sigma.setZero();
-                for (unsigned int i=0; i< dataSize; i++)
+            }
+            
+            extrapolated = false;
+            if (this->emAcceleration)
+            {
+                stepSize *= emStepSizeGrowth;
+                Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> newDiagCovs = diagCovs + stepSize * (emDiagCovs - diagCovs);
+                //variances which the plain step makes too small are set to minVariance either way.
+                if (((newDiagCovs.array() >= minVariance) || (emDiagCovs.array() < minVariance)).all())
                 {
-                    sigma.noalias() += (p(i,g) * (data[i] - mu).array().square()).matrix();
+                    means += stepSize * (emMeans - means);
+                    diagCovs = newDiagCovs;
+                    extrapolated = true;
                 }
-                sigma = sigma / (dataSize * prob(g));
-                
-                means[g] = mu;
-                diagCovs[g] = sigma;
+                else
+                    stepSize = 1.0;
+            }
+            if (!extrapolated)
+            {
+                means = emMeans;
+                diagCovs = emDiagCovs;
             }
             
             DEBUG_OUT("M-step END", 30);
@@ -468,21 +1377,33 @@ namespace music
             //    converged = true;
             if (fabs(oldLoglike - loglike) < 1e-6)
                 converged=true;
+            else if (this->isLosingRestart(loglike, oldLoglike, iteration, maxIterations))
+            {
+                DEBUG_OUT("another restart found a better model, abandoning this one.", 20);
+                break;
+            }
         }
+        //the model consists of the parameters after the last plain step, the
+        //over-relaxed ones have not been evaluated.
+        means = emMeans;
+        diagCovs = emDiagCovs;
+        this->iterationCount = iteration;
         
         //get results with all-zero covariance matricies "right" (quick&dirty)
         for (unsigned int g=0; g<gaussianCount; g++)
         {
-            //if there is a coefficient that is smaller than minVariance in
-            // magnitude, set it to minVariance. This helps with bad results
-            for (int i=0; i<diagCovs[g].size(); i++)
+            //if there is a coefficient that is smaller than minVariance,
+            //set it to minVariance. This helps with bad results
+            for (unsigned int i=0; i<dimension; i++)
             {
-                if (fabs(diagCovs[g][i]) < minVariance)
+                if (diagCovs(i, g) < minVariance)
                 {
-                    diagCovs[g][i] = minVariance;
+                    diagCovs(i, g) = minVariance;
                 }
             }
         }
+        //undo the centering
+        means.colwise() += dataMean;
         
         if (converged)
         {
@@ -503,8 +1424,8 @@ namespace music
         {
             sumOfWeights += weights[g];
             Gaussian<ScalarType>* gaussian = new GaussianDiagCov<ScalarType>(dimension, normalRNG);
-            gaussian->setMean(means[g]);
-            gaussian->setCovarianceMatrix(diagCovs[g].asDiagonal());    //TODO: Improve this interface.
+            gaussian->setMean(means.col(g).template cast<ScalarType>());
+            gaussian->setCovarianceMatrix(diagCovs.col(g).template cast<ScalarType>().asDiagonal());    //TODO: Improve this interface.
             gaussian->setWeight(weights[g]);
             normalizationFactor += gaussian->calculateValue(gaussian->getMean());
             
@@ -516,6 +1437,159 @@ namespace music
         return gaussians;
     }
     
+    template <typename ScalarType>
+    double GaussianMixtureModelFullCov<ScalarType>::calculateOnlineStatistics(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, double minVariance, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics)
+    {
+        unsigned int gaussianCount = gaussians.size();
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > means(gaussianCount);
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > fullCovs(gaussianCount);
+        Eigen::Matrix<double, Eigen::Dynamic, 1> weights(gaussianCount);
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            means[g] = gaussians[g]->getMean();
+            fullCovs[g] = gaussians[g]->getCovarianceMatrix();
+            weights[g] = gaussians[g]->getWeight();
+        }
+        //the weights of the online parameters are not normalized.
+        weights /= weights.sum();
+        std::vector<Eigen::LDLT<Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > > ldlts;
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> > pseudoInverses;
+        std::vector<double> factors;
+        prepareFullCovEStep(fullCovs, weights, minVariance, ldlts, pseudoInverses, factors);
+        
+        FullCovEMJob<ScalarType> job(data, center, means, ldlts, pseudoInverses, factors);
+        job.run(this->threadCount);
+        Eigen::Matrix<double, 1, Eigen::Dynamic> pSum;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> xSum;
+        std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > scatterSums;
+        double loglike = job.getResults(pSum, xSum, scatterSums);
+        
+        //sum_i p_ig, sum_i p_ig x_i and sum_i p_ig x_i x_i^T for every gaussian.
+        statistics.resize(2 + gaussianCount);
+        statistics[0] = pSum;
+        statistics[1] = xSum;
+        for (unsigned int g=0; g<gaussianCount; g++)
+            statistics[2 + g] = scatterSums[g];
+        return loglike;
+    }
+    
+    template <typename ScalarType>
+    void GaussianMixtureModelFullCov<ScalarType>::setOnlineParameters(const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, const std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics, double minVariance, double loglike, unsigned int dataCount)
+    {
+        unsigned int gaussianCount = gaussians.size();
+        unsigned int dimension = center.size();
+        assert(statistics.size() == 2 + gaussianCount);
+        
+        std::vector<Gaussian<ScalarType>*> newGaussians;
+        ScalarType sumOfWeights = 0.0;
+        normalizationFactor = 0.0;
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            double pSum = statistics[0](0, g);
+            Gaussian<ScalarType>* gaussian = new GaussianFullCov<ScalarType>(dimension, normalRNG);
+            //gaussians which do not represent any data vectors stay where they are, with a small weight.
+            if (pSum >= minGaussianWeight)
+            {
+                Eigen::Matrix<double, Eigen::Dynamic, 1> mu = statistics[1].col(g) / pSum;
+                Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> fullCov = (statistics[2 + g] / pSum - mu * mu.transpose()).template cast<ScalarType>();
+                for (unsigned int i=0; i<dimension; i++)
+                {
+                    if (fullCov(i, i) < minVariance)
+                        fullCov(i, i) = minVariance;
+                }
+                gaussian->setMean((mu + center).template cast<ScalarType>());
+                gaussian->setCovarianceMatrix(fullCov);
+            }
+            else
+            {
+                gaussian->setMean(gaussians[g]->getMean());
+                gaussian->setCovarianceMatrix(gaussians[g]->getCovarianceMatrix());
+            }
+            gaussian->setWeight(std::max(pSum, minGaussianWeight));
+            sumOfWeights += gaussian->getWeight();
+            normalizationFactor += gaussian->calculateValue(gaussian->getMean());
+            newGaussians.push_back(gaussian);
+        }
+        normalizationFactor /= gaussianCount;
+        uniRNG = UniformRNG<ScalarType>(0.0, sumOfWeights);
+        
+        for (unsigned int g=0; g<gaussianCount; g++)
+            delete gaussians[g];
+        gaussians.swap(newGaussians);
+        
+        this->calculateInformationCriteria(gaussianCount * (dimension + double(dimension*dimension+dimension)/(2.0)), dataCount, loglike);
+    }
+    
+    template <typename ScalarType>
+    double GaussianMixtureModelDiagCov<ScalarType>::calculateOnlineStatistics(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, double minVariance, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics)
+    {
+        unsigned int gaussianCount = gaussians.size();
+        unsigned int dimension = center.size();
+        //centered and in double precision, see DiagCovEMJob.
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> means(dimension, gaussianCount);
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> diagCovs(dimension, gaussianCount);
+        Eigen::Matrix<double, Eigen::Dynamic, 1> weights(gaussianCount);
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            means.col(g) = gaussians[g]->getMean().template cast<double>() - center;
+            diagCovs.col(g) = gaussians[g]->getCovarianceMatrix().diagonal().template cast<double>().cwiseMax(minVariance);
+            weights[g] = gaussians[g]->getWeight();
+        }
+        //the weights of the online parameters are not normalized.
+        weights /= weights.sum();
+        
+        DiagCovEMJob<ScalarType> job(data, center, means, diagCovs, weights);
+        job.run(this->threadCount);
+        //sum_i p_ig, sum_i p_ig x_i and sum_i p_ig x_i^2, one column per gaussian.
+        statistics.resize(3);
+        Eigen::Matrix<double, 1, Eigen::Dynamic> pSum;
+        double loglike = job.getResults(pSum, statistics[1], statistics[2]);
+        statistics[0] = pSum;
+        return loglike;
+    }
+    
+    template <typename ScalarType>
+    void GaussianMixtureModelDiagCov<ScalarType>::setOnlineParameters(const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, const std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics, double minVariance, double loglike, unsigned int dataCount)
+    {
+        unsigned int gaussianCount = gaussians.size();
+        unsigned int dimension = center.size();
+        assert(statistics.size() == 3);
+        
+        std::vector<Gaussian<ScalarType>*> newGaussians;
+        ScalarType sumOfWeights = 0.0;
+        normalizationFactor = 0.0;
+        for (unsigned int g=0; g<gaussianCount; g++)
+        {
+            double pSum = statistics[0](0, g);
+            Gaussian<ScalarType>* gaussian = new GaussianDiagCov<ScalarType>(dimension, normalRNG);
+            //gaussians which do not represent any data vectors stay where they are, with a small weight.
+            if (pSum >= minGaussianWeight)
+            {
+                Eigen::Matrix<double, Eigen::Dynamic, 1> mu = statistics[1].col(g) / pSum;
+                Eigen::Matrix<double, Eigen::Dynamic, 1> diagCov = (statistics[2].col(g) / pSum - mu.cwiseAbs2()).cwiseMax(minVariance);
+                gaussian->setMean((mu + center).template cast<ScalarType>());
+                gaussian->setCovarianceMatrix(diagCov.template cast<ScalarType>().asDiagonal());
+            }
+            else
+            {
+                gaussian->setMean(gaussians[g]->getMean());
+                gaussian->setCovarianceMatrix(gaussians[g]->getCovarianceMatrix());
+            }
+            gaussian->setWeight(std::max(pSum, minGaussianWeight));
+            sumOfWeights += gaussian->getWeight();
+            normalizationFactor += gaussian->calculateValue(gaussian->getMean());
+            newGaussians.push_back(gaussian);
+        }
+        normalizationFactor /= gaussianCount;
+        uniRNG = UniformRNG<ScalarType>(0.0, sumOfWeights);
+        
+        for (unsigned int g=0; g<gaussianCount; g++)
+            delete gaussians[g];
+        gaussians.swap(newGaussians);
+        
+        this->calculateInformationCriteria(gaussianCount * 2*dimension, dataCount, loglike);
+    }
+    
     template <typename ScalarType>
     void GaussianMixtureModel<ScalarType>::calculateInformationCriteria(int k, int n, double loglike)
     {
@@ -561,6 +1635,66 @@ namespace music
         return retVal/gaussians.size();
     }
     
+    template <typename ScalarType>
+    double GaussianMixtureModel<ScalarType>::logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& pos) const
+    {
+        assert(gaussians.size() > 0);
+        std::vector<double> logValues(gaussians.size());
+        double maxLogValue = -std::numeric_limits<double>::infinity();
+        for (unsigned int g=0; g<gaussians.size(); g++)
+        {
+            logValues[g] = gaussians[g]->logDensity(pos);
+            maxLogValue = std::max(maxLogValue, logValues[g]);
+        }
+        //only gaussians with zero weight
+        if (maxLogValue == -std::numeric_limits<double>::infinity())
+            return maxLogValue;
+        
+        double sum = 0.0;
+        for (unsigned int g=0; g<gaussians.size(); g++)
+            sum += exp(logValues[g] - maxLogValue);
+        return maxLogValue + log(sum);
+    }
+    
+    template <typename ScalarType>
+    void GaussianMixtureModel<ScalarType>::logDensityBatch(const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const
+    {
+        assert(gaussians.size() > 0);
+        //blocks of positions, such that the values of all gaussians stay in the cache.
+        const int blockSize = 256;
+        logDensities.resize(data.cols());
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> logValues;
+        Eigen::Matrix<double, Eigen::Dynamic, 1> gaussianLogValues;
+        for (int start=0; start<data.cols(); start+=blockSize)
+        {
+            int size = std::min<int>(blockSize, data.cols() - start);
+            //the columns are stored one after another, so the block does not need to be copied.
+            Eigen::Map<const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic> > block(data.col(start).data(), data.rows(), size);
+            logValues.resize(gaussians.size(), size);
+            for (unsigned int g=0; g<gaussians.size(); g++)
+            {
+                gaussians[g]->logDensityBatch(block, gaussianLogValues);
+                logValues.row(g) = gaussianLogValues.transpose();
+            }
+            
+            for (int i=0; i<size; i++)
+            {
+                double maxLogValue = logValues.col(i).maxCoeff();
+                if (maxLogValue == -std::numeric_limits<double>::infinity())
+                    logDensities[start + i] = maxLogValue;
+                else
+                    logDensities[start + i] = maxLogValue + log((logValues.col(i).array() - maxLogValue).exp().sum());
+            }
+        }
+    }
+    
+    //the logarithms as used by compareTo(): no -inf values, and nothing below -100.
+    static double clampedLogDensity(double logValue)
+    {
+        assert(logValue == logValue);
+        return (logValue < -100) ? -100 : logValue;
+    }
+    
     template <typename ScalarType>
     ScalarType GaussianMixtureModel<ScalarType>::compareTo(const GaussianMixtureModel<ScalarType>& other, int sampleCount)
     {
@@ -569,7 +1703,6 @@ namespace music
         
         UniformRNG<float> rng(0,1);
         Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> tmp;
-        double tmpVal;
         
         for (int i=0; i<sampleCount; i++)
         {
@@ -591,23 +1724,7 @@ namespace music
             
             //Kullback-Leibler-Divergence
             tmp = this->rand();
-            tmpVal = this->calculateValue(tmp);
-            assert(tmpVal > 0);
-            assert(tmpVal == tmpVal);
-            //DEBUG_VAR_OUT(tmpVal, 0);
-            double logTmpVal = log(tmpVal);
-            //do not allow +-inf values...
-            if (logTmpVal < -100)
-                logTmpVal = -100;
-            //if (logTmpVal > 100)
-            //    logTmpVal = 100;
-            double logOtherVal = log(other.calculateValue(tmp));
-            assert(logOtherVal == logOtherVal);
-            if (logOtherVal < -100)
-                logOtherVal = -100;
-            //if (logOtherVal > 100)
-            //    logOtherVal = 100;
-            value += 1.0 * (logTmpVal - logOtherVal);       //1.0 will be optimized out by the compiler
+            value += clampedLogDensity(this->logDensity(tmp)) - clampedLogDensity(other.logDensity(tmp));
             
             assert(value == value);
         }
@@ -615,6 +1732,129 @@ namespace music
         return value/sampleCount;
     }
     
+    /**
+     * @brief The parts of a gaussian that are needed for the closed-form
+     *      Kullback-Leibler divergence of two gaussians.
+     * 
+     * If both models have diagonal covariance matricies, only the
+     * variances are kept and the divergence is calculated elementwise.
+     */
+    struct GaussianDivergenceTerms
+    {
+        double logWeight;
+        Eigen::VectorXd mean;
+        bool diagonal;
+        Eigen::VectorXd variances;
+        Eigen::VectorXd inverseVariances;
+        Eigen::MatrixXd cov;
+        Eigen::MatrixXd inverseCov;
+        double logDet;
+    };
+    
+    template <typename ScalarType>
+    static void calculateDivergenceTerms(const std::vector<Gaussian<ScalarType>*>& gaussians, bool diagonal, std::vector<GaussianDivergenceTerms>& terms)
+    {
+        double sumOfWeights = 0.0;
+        for (unsigned int g=0; g<gaussians.size(); g++)
+            sumOfWeights += gaussians[g]->getWeight();
+        
+        terms.resize(gaussians.size());
+        for (unsigned int g=0; g<gaussians.size(); g++)
+        {
+            terms[g].logWeight = log(gaussians[g]->getWeight() / sumOfWeights);
+            terms[g].mean = gaussians[g]->getMean().template cast<double>();
+            terms[g].diagonal = diagonal;
+            if (diagonal)
+            {
+                terms[g].variances = gaussians[g]->getCovarianceMatrix().diagonal().template cast<double>();
+                terms[g].inverseVariances = terms[g].variances.cwiseInverse();
+                terms[g].logDet = terms[g].variances.array().log().sum();
+            }
+            else
+            {
+                terms[g].cov = gaussians[g]->getCovarianceMatrix().template cast<double>();
+                Eigen::LLT<Eigen::MatrixXd> llt(terms[g].cov);
+                terms[g].inverseCov = llt.solve(Eigen::MatrixXd::Identity(terms[g].cov.rows(), terms[g].cov.cols()));
+                terms[g].logDet = 2.0 * llt.matrixLLT().diagonal().array().log().sum();
+            }
+        }
+    }
+    
+    //D(a||b) = 1/2 (log|S_b|/|S_a| + tr(S_b^-1 S_a) + (m_b-m_a)^T S_b^-1 (m_b-m_a) - d)
+    static double gaussianDivergence(const GaussianDivergenceTerms& a, const GaussianDivergenceTerms& b)
+    {
+        if (a.diagonal)
+        {
+            return 0.5 * (b.logDet - a.logDet + a.variances.dot(b.inverseVariances)
+                + ((b.mean - a.mean).array().square() * b.inverseVariances.array()).sum() - a.mean.size());
+        }
+        Eigen::VectorXd diff = b.mean - a.mean;
+        return 0.5 * (b.logDet - a.logDet + b.inverseCov.cwiseProduct(a.cov).sum()
+            + diff.dot(b.inverseCov * diff) - a.mean.size());
+    }
+    
+    //log(sum_b exp(logWeight_b - D(a||b)))
+    static double logSumDivergences(const GaussianDivergenceTerms& a, const std::vector<GaussianDivergenceTerms>& terms)
+    {
+        std::vector<double> exponents(terms.size());
+        double maxExponent = -std::numeric_limits<double>::max();
+        for (unsigned int b=0; b<terms.size(); b++)
+        {
+            exponents[b] = terms[b].logWeight - gaussianDivergence(a, terms[b]);
+            maxExponent = std::max(maxExponent, exponents[b]);
+        }
+        double sum = 0.0;
+        for (unsigned int b=0; b<terms.size(); b++)
+            sum += exp(exponents[b] - maxExponent);
+        return maxExponent + log(sum);
+    }
+    
+    static double variationalDivergence(const std::vector<GaussianDivergenceTerms>& f, const std::vector<GaussianDivergenceTerms>& g)
+    {
+        double value = 0.0;
+        for (unsigned int a=0; a<f.size(); a++)
+            value += exp(f[a].logWeight) * (logSumDivergences(f[a], f) - logSumDivergences(f[a], g));
+        return value;
+    }
+    
+    static double matchedPairDivergence(const std::vector<GaussianDivergenceTerms>& f, const std::vector<GaussianDivergenceTerms>& g)
+    {
+        double value = 0.0;
+        for (unsigned int a=0; a<f.size(); a++)
+        {
+            double minCost = std::numeric_limits<double>::max();
+            for (unsigned int b=0; b<g.size(); b++)
+                minCost = std::min(minCost, gaussianDivergence(f[a], g[b]) - g[b].logWeight);
+            value += exp(f[a].logWeight) * (minCost + f[a].logWeight);
+        }
+        return value;
+    }
+    
+    template <typename ScalarType>
+    ScalarType GaussianMixtureModel<ScalarType>::compareTo(const GaussianMixtureModel<ScalarType>& other, GMM_DIVERGENCE_METHOD method, int sampleCount)
+    {
+        if (method == GMM_DIVERGENCE_MONTECARLO)
+            return compareTo(other, sampleCount);
+        
+        assert(gaussians.size() > 0);
+        assert(other.gaussians.size() > 0);
+        std::vector<GaussianDivergenceTerms> f;
+        std::vector<GaussianDivergenceTerms> g;
+        bool diagonal = !isFullCov() && !other.isFullCov();
+        calculateDivergenceTerms(gaussians, diagonal, f);
+        calculateDivergenceTerms(other.gaussians, diagonal, g);
+        
+        double value;
+        if (method == GMM_DIVERGENCE_MATCHED_PAIR)
+            value = matchedPairDivergence(f, g);
+        else if (method == GMM_DIVERGENCE_VARIATIONAL)
+            value = variationalDivergence(f, g);
+        else
+            value = variationalDivergence(f, g) + variationalDivergence(g, f);
+        assert(value == value);
+        return value;
+    }
+    
     template <typename ScalarType>
     Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> GaussianMixtureModel<ScalarType>::rand() const
     {
@@ -636,7 +1876,9 @@ namespace music
     template <typename ScalarType>
     GaussianMixtureModel<ScalarType>::GaussianMixtureModel() :
         gaussians(), uniRNG(0.0, 1.0), normalizationFactor(1.0),
-        aic(0.0), aicc(0.0), bic(0.0), loglike(0.0)
+        aic(0.0), aicc(0.0), bic(0.0), loglike(0.0),
+        useRandomSeed(false), randomState(0), restartState(NULL), threadCount(1), initMethod(GMM_INIT_RANDOM),
+        maxIterations(10), iterationCount(0), emAcceleration(false)
     {
         
     }
@@ -644,7 +1886,9 @@ namespace music
     template <typename ScalarType>
     GaussianMixtureModel<ScalarType>::GaussianMixtureModel(const GaussianMixtureModel<ScalarType>& other) :
         gaussians(), uniRNG(0.0, 1.0), normalizationFactor(other.normalizationFactor),
-        aic(other.aic), aicc(other.aicc), bic(other.bic), loglike(other.loglike)
+        aic(other.aic), aicc(other.aicc), bic(other.bic), loglike(other.loglike),
+        useRandomSeed(false), randomState(0), restartState(NULL), threadCount(other.threadCount), initMethod(other.initMethod),
+        maxIterations(other.maxIterations), iterationCount(other.iterationCount), emAcceleration(other.emAcceleration)
     {
         for (unsigned int i=0; i<other.gaussians.size(); i++)
         {
@@ -902,9 +2146,166 @@ namespace music
     
     
     
+    //inverse of the standard normal CDF, for p in ]0,1[. Relative error below 1.2e-9 (P. J. Acklam).
+    static double inverseNormalCDF(double p)
+    {
+        static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02, 1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+        static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02, 6.680131188771972e+01, -1.328068155288572e+01};
+        static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00, -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+        static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00, 3.754408661907416e+00};
+        
+        assert((p > 0.0) && (p < 1.0));
+        if ((p >= 0.02425) && (p <= 0.97575))
+        {
+            double q = p - 0.5;
+            double r = q * q;
+            return (((((a[0]*r + a[1])*r + a[2])*r + a[3])*r + a[4])*r + a[5]) * q /
+                (((((b[0]*r + b[1])*r + b[2])*r + b[3])*r + b[4])*r + 1.0);
+        }
+        double q = sqrt(-2.0 * log((p < 0.5) ? p : 1.0 - p));
+        double x = (((((c[0]*q + c[1])*q + c[2])*q + c[3])*q + c[4])*q + c[5]) /
+            ((((d[0]*q + d[1])*q + d[2])*q + d[3])*q + 1.0);
+        return (p < 0.5) ? x : -x;
+    }
+    
+    //element index of the Halton sequence in the given base. in ]0,1[ for index > 0.
+    static double radicalInverse(unsigned int index, unsigned int base)
+    {
+        double value = 0.0;
+        double factor = 1.0 / base;
+        while (index > 0)
+        {
+            value += factor * (index % base);
+            index /= base;
+            factor /= base;
+        }
+        return value;
+    }
+    
+    template <typename ScalarType>
+    GMMSampleSet<ScalarType>::GMMSampleSet()
+    {
+        
+    }
+    
+    template <typename ScalarType>
+    GMMSampleSet<ScalarType>::GMMSampleSet(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount, GMM_SAMPLING_METHOD method)
+    {
+        drawSamples(model, sampleCount, method);
+    }
+    
+    template <typename ScalarType>
+    void GMMSampleSet<ScalarType>::drawSamples(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount, GMM_SAMPLING_METHOD method)
+    {
+        assert(sampleCount > 0);
+        if (method == GMM_SAMPLING_RANDOM)
+        {
+            for (unsigned int i=0; i<sampleCount; i++)
+            {
+                Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> sample = model.rand();
+                if (i == 0)
+                    samples.resize(sample.size(), sampleCount);
+                samples.col(i) = sample;
+            }
+        }
+        else
+            drawStratifiedSamples(model, sampleCount, method == GMM_SAMPLING_QUASIRANDOM);
+        
+        model.logDensityBatch(samples, logDensities);
+        for (int i=0; i<logDensities.size(); i++)
+            logDensities[i] = clampedLogDensity(logDensities[i]);
+    }
+    
+    template <typename ScalarType>
+    void GMMSampleSet<ScalarType>::drawStratifiedSamples(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount, bool quasiRandom)
+    {
+        std::vector<Gaussian<ScalarType>*> gaussians = model.getGaussians();
+        assert(gaussians.size() > 0);
+        unsigned int dimension = gaussians[0]->getMean().size();
+        samples.resize(dimension, sampleCount);
+        
+        //every gaussian gets the integer part of its share, the rest goes to the largest remainders.
+        double sumOfWeights = 0.0;
+        for (unsigned int g=0; g<gaussians.size(); g++)
+            sumOfWeights += gaussians[g]->getWeight();
+        std::vector<unsigned int> counts(gaussians.size());
+        std::vector<std::pair<double, unsigned int> > remainders(gaussians.size());
+        unsigned int assigned = 0;
+        for (unsigned int g=0; g<gaussians.size(); g++)
+        {
+            double share = sampleCount * gaussians[g]->getWeight() / sumOfWeights;
+            counts[g] = std::min<unsigned int>(floor(share), sampleCount - assigned);
+            assigned += counts[g];
+            remainders[g] = std::make_pair(share - counts[g], g);
+        }
+        std::sort(remainders.begin(), remainders.end());
+        for (unsigned int r=0; assigned < sampleCount; r++, assigned++)
+            counts[remainders[remainders.size() - 1 - (r % remainders.size())].second]++;
+        
+        //one prime per dimension for the Halton sequence.
+        std::vector<unsigned int> primes;
+        for (unsigned int n=2; quasiRandom && (primes.size() < dimension); n++)
+        {
+            bool isPrime = true;
+            for (unsigned int p=0; isPrime && (p < primes.size()) && (primes[p] * primes[p] <= n); p++)
+                isPrime = (n % primes[p] != 0);
+            if (isPrime)
+                primes.push_back(n);
+        }
+        
+        //the gaussians share one Halton sequence, such that they do not get the same points.
+        //the first points are skipped, they are badly distributed in high dimensions.
+        unsigned int haltonIndex = 20;
+        unsigned int i = 0;
+        for (unsigned int g=0; g<gaussians.size(); g++)
+        {
+            if (counts[g] == 0)
+                continue;
+            if (!quasiRandom)
+            {
+                for (unsigned int j=0; j<counts[g]; j++)
+                    samples.col(i++) = gaussians[g]->rand();
+                continue;
+            }
+            
+            Eigen::LLT<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > llt(gaussians[g]->getCovarianceMatrix().template cast<double>());
+            Eigen::Matrix<double, Eigen::Dynamic, 1> mean = gaussians[g]->getMean().template cast<double>();
+            Eigen::Matrix<double, Eigen::Dynamic, 1> normal(dimension);
+            for (unsigned int j=0; j<counts[g]; j++, haltonIndex++)
+            {
+                for (unsigned int k=0; k<dimension; k++)
+                    normal[k] = inverseNormalCDF(radicalInverse(haltonIndex, primes[k]));
+                samples.col(i++) = (mean + llt.matrixL() * normal).template cast<ScalarType>();
+            }
+        }
+        assert(i == sampleCount);
+    }
+    
+    template <typename ScalarType>
+    ScalarType GMMSampleSet<ScalarType>::compareTo(const GaussianMixtureModel<ScalarType>& other) const
+    {
+        assert(samples.getSize() > 0);
+        Eigen::Matrix<double, Eigen::Dynamic, 1> otherLogDensities;
+        other.logDensityBatch(samples, otherLogDensities);
+        for (int i=0; i<otherLogDensities.size(); i++)
+            otherLogDensities[i] = clampedLogDensity(otherLogDensities[i]);
+        double value = (logDensities - otherLogDensities).mean();
+        assert(value == value);
+        return value;
+    }
+    
+    template <typename ScalarType>
+    void GMMSampleSet<ScalarType>::compareTo(const std::vector<GaussianMixtureModel<ScalarType>*>& others, std::vector<ScalarType>& divergences) const
+    {
+        divergences.resize(others.size());
+        for (unsigned int m=0; m<others.size(); m++)
+            divergences[m] = compareTo(*others[m]);
+    }
+    
     template class GaussianMixtureModel<kiss_fft_scalar>;
     template class GaussianMixtureModelFullCov<kiss_fft_scalar>;
     template class GaussianMixtureModelDiagCov<kiss_fft_scalar>;
+    template class GMMSampleSet<kiss_fft_scalar>;
     
     template <> NormalRNG<kiss_fft_scalar>* GaussianMixtureModel<kiss_fft_scalar>::normalRNG = new NormalRNG<kiss_fft_scalar>();
     
@@ -13,9 +13,95 @@
 #include "fft.hpp"
 
 #include "gaussian.hpp"
+#include "dataset.hpp"
 
 namespace music
 {
+    class GMMRestartState;
+    
+    /**
+     * @brief The ways the EM algorithm of a GaussianMixtureModel can be initialized.
+     * 
+     * @see GaussianMixtureModel::setInitMethod()
+     * @ingroup classification
+     */
+    enum GMM_INIT_METHOD
+    {
+        //random data vectors as means, initVariance as variances.
+        GMM_INIT_RANDOM,
+        //means chosen by k-means++ seeding, initVariance as variances.
+        GMM_INIT_KMEANSPP,
+        //means, variances and weights of the clusters of a short k-means run, seeded by k-means++.
+        GMM_INIT_KMEANS
+    };
+    
+    /**
+     * @brief The ways GaussianMixtureModel::compareTo() can approximate
+     *      the Kullback-Leibler divergence of two models.
+     * 
+     * There is no closed form for the divergence of two mixtures of gaussians,
+     * but there is one for the divergence of two gaussians. All methods but the
+     * Monte-Carlo estimate are built on the divergences of the pairs of gaussians,
+     * they are deterministic and do not draw samples.
+     * 
+     * @see John R. Hershey, Peder A. Olsen: Approximating the Kullback Leibler
+     *      divergence between Gaussian mixture models, ICASSP 2007.
+     * @ingroup classification
+     */
+    enum GMM_DIVERGENCE_METHOD
+    {
+        //mean of log(f(x)/g(x)) over samples x drawn from f.
+        GMM_DIVERGENCE_MONTECARLO,
+        //variational approximation of Hershey and Olsen.
+        GMM_DIVERGENCE_VARIATIONAL,
+        //every gaussian of f is matched with the gaussian of g that fits best (Goldberger).
+        GMM_DIVERGENCE_MATCHED_PAIR,
+        //variational approximation of D(f||g) + D(g||f).
+        GMM_DIVERGENCE_SYMMETRIC_VARIATIONAL
+    };
+    
+    /**
+     * @brief The ways a GMMSampleSet can draw its samples.
+     * 
+     * @see GMMSampleSet::drawSamples()
+     * @ingroup classification
+     */
+    enum GMM_SAMPLING_METHOD
+    {
+        //every sample from a randomly chosen gaussian, like GaussianMixtureModel::rand().
+        GMM_SAMPLING_RANDOM,
+        //every gaussian gets a number of samples proportional to its weight, the samples are random.
+        GMM_SAMPLING_STRATIFIED,
+        //like GMM_SAMPLING_STRATIFIED, but the samples are taken from a Halton sequence instead of being random.
+        GMM_SAMPLING_QUASIRANDOM
+    };
+    
+    /**
+     * @brief Produces the data vectors for GaussianMixtureModel::trainGMMOnline().
+     * 
+     * Derive from this class to generate the data vectors on demand, e.g. by drawing
+     * them from other models, such that they never need to be in memory all at once.
+     * The data vectors should be in random order: the online EM algorithm
+     * adapts to the latest vectors more than to the older ones.
+     * 
+     * @ingroup classification
+     */
+    template <typename ScalarType=kiss_fft_scalar>
+    class DataVectorGenerator
+    {
+    public:
+        virtual ~DataVectorGenerator() {}
+        
+        /**
+         * @brief Generates the next data vectors.
+         * 
+         * @param[out] data The data vectors, one per column. Needs to be resized
+         *      to <code>count</code> columns.
+         * @param count The number of data vectors that should be generated.
+         */
+        virtual void generateDataVectors(DataSet<ScalarType>& data, unsigned int count)=0;
+    };
+    
     /**
      * @brief This class is able to generate a gaussian mixture model for data.
      * 
@@ -49,6 +135,67 @@ namespace music
         
         double aic, aicc, bic, loglike;
         
+        //random stream for the initialization, if useRandomSeed is set. otherwise, std::rand() is used.
+        bool useRandomSeed;
+        unsigned int randomState;
+        //shared with the other restarts of trainGMMBestOf(), or NULL.
+        GMMRestartState* restartState;
+        //number of threads a single run of the EM algorithm is split across.
+        unsigned int threadCount;
+        GMM_INIT_METHOD initMethod;
+        //maximum number of iterations of the EM algorithm, and the number of iterations the last run needed.
+        unsigned int maxIterations;
+        unsigned int iterationCount;
+        //if the EM algorithm uses over-relaxed steps.
+        bool emAcceleration;
+        
+        /**
+         * @brief Draws the index of a random data vector, e.g. for the initialization of the EM algorithm.
+         * 
+         * Uses the own random stream of the model, if one has been set
+         * by trainGMMBestOf(), and <code>std::rand()</code> otherwise.
+         * 
+         * @param dataSize The number of data vectors.
+         * @return an index in <code>[0, dataSize[</code>.
+         */
+        unsigned int drawDataIndex(unsigned int dataSize);
+        /**
+         * @brief Draws a uniformly distributed random number in <code>[0, 1[</code>,
+         *      from the same random stream as drawDataIndex().
+         */
+        double drawUniform();
+        
+        /**
+         * @brief Calculates the initial gaussians of the EM algorithm, as set by setInitMethod().
+         * 
+         * @param data The data that should be modeled, one data vector per column.
+         * @param gaussianCount The number of gaussians.
+         * @param initVariance The variance of the gaussians, if it is not estimated from the data.
+         * @param minVariance The minimum variance of the gaussians.
+         * @param[out] init The initial gaussians. Will be empty for GMM_INIT_RANDOM, which
+         *      is done by the EM algorithm itself. The caller needs to delete them.
+         */
+        void calculateInitGaussians(const DataSet<ScalarType>& data, unsigned int gaussianCount, double initVariance, double minVariance, std::vector<Gaussian<ScalarType>*>& init);
+        
+        
+        /**
+         * @brief Tells if the EM algorithm should stop, because another restart
+         *      of trainGMMBestOf() has already finished with a better model.
+         * 
+         * The log-likelihood of the EM algorithm never decreases, and its
+         * improvements get smaller with every iteration. If the model
+         * would still be worse than the best finished one if it improved
+         * by the last improvement in every remaining iteration, it is
+         * considered to be losing.
+         * 
+         * @param loglike The log-likelihood after the current iteration.
+         * @param oldLoglike The log-likelihood after the iteration before.
+         * @param iteration The number of iterations done so far.
+         * @param maxIterations The maximum number of iterations.
+         * @return if the restart is clearly losing and should be abandoned, or not.
+         */
+        bool isLosingRestart(double loglike, double oldLoglike, unsigned int iteration, unsigned int maxIterations);
+        
         /**
          * @brief Calculates the AIC, AICc, BIC and stores them internally.
          * 
@@ -65,7 +212,7 @@ namespace music
          * @param init The initial guesses for the centers of gravity and covariance matricies
          *      of the normal distributions. Setting the diagonal elements of the
          *      covariance matrix to approximately 10000 is a good initial guess.
-         * @param data The data that should be analyzed
+         * @param data The data that should be analyzed, one data vector per column.
          * @param gaussianCount The count of gaussian distributions that will be used to model the data
          * @param maxIterations The maximum number of iterations of the algorithm. Usually, it converges much faster.
          * 
@@ -74,7 +221,31 @@ namespace music
          * 
          * @return A list of the gaussian distributions that build the model.
          */
-        virtual std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1)=0;
+        virtual std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const DataSet<ScalarType>& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1)=0;
+        
+        /**
+         * @brief The E-step of the online EM algorithm: calculates the sufficient
+         *      statistics of some data vectors with the current gaussians.
+         * 
+         * @param data The data vectors.
+         * @param center The statistics are calculated on the data vectors minus <code>center</code>.
+         * @param minVariance The minimum variance of the gaussians.
+         * @param[out] statistics The sums of the statistics over the data vectors. What they are
+         *      is up to the derived class, the online EM algorithm only averages them.
+         * @return the log-likelihood of the data vectors.
+         */
+        virtual double calculateOnlineStatistics(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, double minVariance, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics)=0;
+        /**
+         * @brief The M-step of the online EM algorithm: replaces the gaussians by the ones
+         *      that maximize the averaged statistics.
+         * 
+         * @param center The center the statistics were calculated with.
+         * @param statistics The statistics of calculateOnlineStatistics(), averaged per data vector.
+         * @param minVariance The minimum variance of the gaussians.
+         * @param loglike The log-likelihood of the model, for the information criteria.
+         * @param dataCount The number of data vectors the model has been trained with.
+         */
+        virtual void setOnlineParameters(const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, const std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics, double minVariance, double loglike, unsigned int dataCount)=0;
     public:
         /**
          * @brief Creates a new empty Gaussian Mixture Model.
@@ -91,7 +262,7 @@ namespace music
         /**
          * @brief Train this GMM to model the data given.
          * 
-         * @param data The data that should be modeled. You need to give at
+         * @param data The data that should be modeled, one data vector per column. You need to give at
          *      least as many data points to the algorithm as the dimension of the
          *      data is, otherwise the algorithm fails (built-in assertion).
          *      Ideally, you would give around <code>10^dimension</code>
@@ -103,8 +274,201 @@ namespace music
          *      than this value, it will be set to this value.
          * 
          */
+        void trainGMM(const DataSet<ScalarType>& data, int gaussianCount=10, double initVariance = 100.0, double minVariance = 0.1);
+        /**
+         * @brief Train this GMM to model the data given.
+         * 
+         * Copies the data vectors into a DataSet and trains the model on it.
+         * If you train more than one model on the same data, or have
+         * the data in a matrix anyway, use the DataSet version.
+         * 
+         * @see trainGMM(const DataSet<ScalarType>&, int, double, double)
+         */
         void trainGMM(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, int gaussianCount=10, double initVariance = 100.0, double minVariance = 0.1);
         
+        /**
+         * @brief Trains several models on the data and keeps the one with the
+         *      best log-likelihood.
+         * 
+         * The EM algorithm only finds a local maximum, which depends on the
+         * random initialization. This function restarts it <code>restartCount</code> times
+         * and keeps the best result. The restarts are independent of each other, and
+         * are split across <code>threadCount</code> threads. Every restart has its own random
+         * stream, seeded from <code>std::rand()</code> in the calling thread.
+         * 
+         * Restarts which are clearly worse than a restart that already finished
+         * are abandoned early, see isLosingRestart(). With more than one thread,
+         * which restarts get abandoned may depend on the timing of the threads.
+         * 
+         * @param data The data that should be modeled, one data vector per column.
+         * @param gaussianCount The count of gaussian distributions that will be used to model the data
+         * @param restartCount The number of models that will be trained.
+         * @param threadCount The number of threads the restarts will be split across.
+         *      If there are more threads than restarts, every restart gets a share
+         *      of the remaining threads, see setThreadCount().
+         * @param initVariance The initial variance (diagonal) of the covariance matricies.
+         * @param minVariance The minimum variance (diagonal) of the covariance matricies.
+         * 
+         * @see trainGMM(const DataSet<ScalarType>&, int, double, double)
+         */
+        void trainGMMBestOf(const DataSet<ScalarType>& data, int gaussianCount=10, unsigned int restartCount=3, unsigned int threadCount=1, double initVariance = 100.0, double minVariance = 0.1);
+        
+        /**
+         * @brief Trains this GMM with the online EM algorithm on a stream of data vectors.
+         * 
+         * trainGMM() needs all data vectors in memory, and every iteration runs over
+         * all of them. This function draws the data vectors from <code>generator</code>
+         * in batches of <code>batchSize</code> vectors. The first batch is used to train
+         * an initial model with trainGMM(). Then every batch is used once: the sufficient statistics of
+         * the batch are calculated with the current model (E-step), and the averaged statistics
+         * \f$s\f$ are updated with the step size \f$\gamma_t = (t+1)^{-\kappa}\f$,
+         * \f[
+         *      s_t = (1-\gamma_t) s_{t-1} + \gamma_t \bar{s}(\mathrm{batch}_t) ,
+         * \f]
+         * before the model is calculated from them (M-step). Memory and time only depend on
+         * <code>batchSize</code> and <code>dataCount</code>.
+         * 
+         * The log-likelihood of the model is estimated from the log-likelihoods of
+         * the batches, averaged the same way as the statistics.
+         * 
+         * @param generator The generator of the data vectors.
+         * @param gaussianCount The count of gaussian distributions that will be used to model the data
+         * @param dataCount The number of data vectors that will be drawn from <code>generator</code>.
+         * @param batchSize The number of data vectors per batch. Every batch needs to have more data
+         *      vectors than gaussians.
+         * @param initVariance The initial variance (diagonal) of the covariance matricies.
+         * @param minVariance The minimum variance (diagonal) of the covariance matricies.
+         * @param stepSizeExponent The exponent \f$\kappa\in]0.5,1]\f$ of the step size. Smaller values
+         *      forget the old statistics faster.
+         * 
+         * @see Olivier Cappé, Eric Moulines: On-line expectation-maximization algorithm for latent data models,
+         *      Journal of the Royal Statistical Society B 71(3), 2009.
+         */
+        void trainGMMOnline(DataVectorGenerator<ScalarType>& generator, int gaussianCount, unsigned int dataCount, unsigned int batchSize=10000, double initVariance = 100.0, double minVariance = 0.1, double stepSizeExponent = 0.6);
+        
+        /**
+         * @brief Builds this GMM from the gaussians of other GMMs, without drawing samples.
+         * 
+         * The gaussians of all models are pooled, every model gets the same total
+         * weight. Then the pair of gaussians whose merge loses the least
+         * information is merged, until <code>gaussianCount</code> gaussians are left
+         * (Runnalls' algorithm). Merging keeps the weight, the mean and the covariance of the pair;
+         * the cost of merging gaussians \f$i\f$ and \f$j\f$ into \f$m\f$ is the upper bound
+         * \f[
+         *      B(i,j) = \frac{1}{2} \left( w_m \log|\Sigma_m| - w_i \log|\Sigma_i| - w_j \log|\Sigma_j| \right)
+         * \f]
+         * of the Kullback-Leibler divergence between the mixtures before and after the merge.
+         * For models with diagonal covariance matricies, the merged covariance
+         * matricies are diagonal, too.
+         * 
+         * The work does not depend on any number of samples. For \f$N\f$ pooled gaussians,
+         * it usually grows with \f$N^2\f$; it is \f$O(N^3)\f$ in the worst case, when many
+         * gaussians lose their cheapest merge partner in every merge.
+         * The result does not depend on random numbers.
+         * As there is no data, the information criteria and the log-likelihood of the model will be zero.
+         * 
+         * @param models The models whose gaussians will be merged. They need to have the same dimension.
+         * @param gaussianCount The number of gaussians of this model. If the models have
+         *      less gaussians in total, all of them are kept.
+         * 
+         * @see Andrew R. Runnalls: Kullback-Leibler approach to Gaussian mixture reduction,
+         *      IEEE Transactions on Aerospace and Electronic Systems 43(3), 2007.
+         */
+        void trainGMMFromModels(const std::vector<GaussianMixtureModel<ScalarType>*>& models, unsigned int gaussianCount);
+        
+        /**
+         * @brief Tells if the gaussians of this model have full covariance matricies.
+         * @return <code>true</code> for full, <code>false</code> for diagonal covariance matricies.
+         */
+        virtual bool isFullCov() const=0;
+        
+        /**
+         * @brief Sets the number of threads a single run of the EM algorithm
+         *      will be split across.
+         * 
+         * The data points are split into blocks, which are processed in parallel.
+         * The blocks do not depend on the number of threads, and their
+         * results are added up in the same order every time, such that the
+         * trained model is the same for every number of threads.
+         * 
+         * trainGMMBestOf() uses the threads which are not needed for the
+         * restarts this way, if there are more threads than restarts.
+         * 
+         * @param threadCount The number of threads. The default is <code>1</code>.
+         */
+        void setThreadCount(unsigned int threadCount)   {this->threadCount = (threadCount > 0) ? threadCount : 1;}
+        /**
+         * @brief Returns the number of threads a single run of the EM algorithm
+         *      will be split across.
+         * @return the number of threads a single run of the EM algorithm
+         *      will be split across.
+         */
+        unsigned int getThreadCount() const             {return threadCount;}
+        
+        /**
+         * @brief Sets how the EM algorithm will be initialized.
+         * 
+         * With random initialization, the EM algorithm needs many iterations to move
+         * the gaussians to the clusters of the data, and it often gets stuck in
+         * a bad local maximum. Starting from k-means++ seeds or from the clusters of
+         * a short k-means run, it usually converges within the iterations it has.
+         * The initialization uses the random stream of the model, so trainGMMBestOf()
+         * still gets independent restarts.
+         * 
+         * @param initMethod The initialization. The default is GMM_INIT_RANDOM.
+         */
+        void setInitMethod(GMM_INIT_METHOD initMethod)  {this->initMethod = initMethod;}
+        /**
+         * @brief Returns how the EM algorithm will be initialized.
+         * @return how the EM algorithm will be initialized.
+         */
+        GMM_INIT_METHOD getInitMethod() const           {return initMethod;}
+        
+        /**
+         * @brief Sets the maximum number of iterations of the EM algorithm.
+         * 
+         * @param maxIterations The maximum number of iterations. The default is <code>10</code>.
+         */
+        void setMaxIterations(unsigned int maxIterations)   {this->maxIterations = (maxIterations > 0) ? maxIterations : 1;}
+        /**
+         * @brief Returns the maximum number of iterations of the EM algorithm.
+         * @return the maximum number of iterations of the EM algorithm.
+         */
+        unsigned int getMaxIterations() const               {return maxIterations;}
+        /**
+         * @brief Returns the number of iterations the EM algorithm needed
+         *      when the model was trained.
+         * 
+         * Every evaluation of the log-likelihood counts as one iteration, including
+         * the rejected steps of the accelerated EM algorithm.
+         * 
+         * @return the number of iterations of the last training, or zero
+         *      if the model has not been trained.
+         */
+        unsigned int getIterationCount() const              {return iterationCount;}
+        
+        /**
+         * @brief Sets if the EM algorithm should use over-relaxed steps.
+         * 
+         * The EM algorithm moves the parameters only a small step per iteration
+         * if the gaussians overlap, and then needs a lot of iterations to converge.
+         * With acceleration, the parameters are moved by <code>stepSize</code> times
+         * the step of the EM algorithm, where the step size grows with every step that
+         * increases the log-likelihood (adaptive over-relaxation). If a step
+         * decreases the log-likelihood or makes a covariance matrix invalid, the plain step
+         * of the EM algorithm is taken instead and the step size starts at <code>1</code> again,
+         * so the log-likelihood still never decreases.
+         * 
+         * @param emAcceleration If the EM algorithm should be accelerated. The default is <code>false</code>.
+         * @see Ruslan Salakhutdinov, Sam Roweis: Adaptive Overrelaxed Bound Optimization Methods, ICML 2003.
+         */
+        void setEMAcceleration(bool emAcceleration)         {this->emAcceleration = emAcceleration;}
+        /**
+         * @brief Returns if the EM algorithm uses over-relaxed steps.
+         * @return if the EM algorithm uses over-relaxed steps.
+         */
+        bool getEMAcceleration() const                      {return emAcceleration;}
+        
         /**
          * @brief Returns the Akaike Information Criterion of the model.
          * 
@@ -162,6 +526,26 @@ namespace music
          * @return A distance measure of the two gaussians.
          */
         ScalarType compareTo(const GaussianMixtureModel<ScalarType>& other, int sampleCount=200);
+        /**
+         * @brief Compare this gaussian mixture model with another one, with the
+         *      given approximation of the Kullback-Leibler divergence \f$D(this||other)\f$.
+         * 
+         * The Monte-Carlo estimate is the same as compareTo(other, sampleCount).
+         * The other methods do not draw samples and are much faster. They
+         * calculate the divergences of all pairs of gaussians of the two models,
+         * and, for the variational approximations, also of all pairs of
+         * gaussians of each model.
+         * 
+         * @param other The model this model will be compared to.
+         * @param method The approximation of the divergence.
+         * @param sampleCount The number of samples of the Monte-Carlo estimate.
+         *      Not used by the other methods.
+         * @return The approximated divergence. Zero for equal models, larger for models that
+         *      are further apart. The variational approximation and the matched-pair
+         *      approximation may be slightly negative for very close models.
+         * @see GMM_DIVERGENCE_METHOD
+         */
+        ScalarType compareTo(const GaussianMixtureModel<ScalarType>& other, GMM_DIVERGENCE_METHOD method, int sampleCount=200);
         
         /**
          * @brief Returns the list of gaussian distributions of this model.
@@ -184,6 +568,30 @@ namespace music
         ScalarType calculateValue(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& pos) const;
         ScalarType calculateValueWithoutWeights(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& pos) const;
         
+        /**
+         * @brief Computes the logarithm of the probability density function
+         *      represented by this GMM at the given position.
+         * 
+         * The logarithms of the values of the gaussians are added up with the
+         * log-sum-exp trick, so the result does not underflow for positions far away from
+         * all gaussians, as <code>log(calculateValue(pos))</code> would.
+         * 
+         * @return The logarithm of the value of the probability density at the given position.
+         */
+        double logDensity(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& pos) const;
+        /**
+         * @brief Computes the logarithm of the probability density function
+         *      represented by this GMM at a lot of positions.
+         * 
+         * Same as logDensity(), but every gaussian is evaluated at a block of
+         * positions at once, which is a lot faster than evaluating the positions one by one.
+         * 
+         * @param data The positions, one per column.
+         * @param[out] logDensities The logarithm of the value of the probability density
+         *      for every column of <code>data</code>.
+         */
+        void logDensityBatch(const Eigen::Matrix<ScalarType, Eigen::Dynamic, Eigen::Dynamic>& data, Eigen::Matrix<double, Eigen::Dynamic, 1>& logDensities) const;
+        
         /**
          * @brief Create a JSON string that represents this model.
          * @param styledWriter If a styled writer should be used, or not. With a styled writer,
@@ -308,12 +716,15 @@ namespace music
             using GaussianMixtureModel<ScalarType>::normalRNG;
             using GaussianMixtureModel<ScalarType>::normalizationFactor;
             
-            std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1);
+            std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const DataSet<ScalarType>& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1);
+            double calculateOnlineStatistics(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, double minVariance, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics);
+            void setOnlineParameters(const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, const std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics, double minVariance, double loglike, unsigned int dataCount);
         public:
             GaussianMixtureModel<ScalarType>* clone();
             GaussianMixtureModelFullCov(const GaussianMixtureModelFullCov<ScalarType>& other);
             GaussianMixtureModelFullCov();
             ~GaussianMixtureModelFullCov() {}
+            bool isFullCov() const  {return true;}
     };
     
     /**
@@ -339,12 +750,101 @@ namespace music
             using GaussianMixtureModel<ScalarType>::normalRNG;
             using GaussianMixtureModel<ScalarType>::normalizationFactor;
             
-            std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1);
+            std::vector<Gaussian<ScalarType>* > emAlg(const std::vector<Gaussian<ScalarType>*>& init, const DataSet<ScalarType>& data, unsigned int gaussianCount = 10, unsigned int maxIterations=50, double initVariance = 100.0, double minVariance = 0.1);
+            double calculateOnlineStatistics(const DataSet<ScalarType>& data, const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, double minVariance, std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics);
+            void setOnlineParameters(const Eigen::Matrix<double, Eigen::Dynamic, 1>& center, const std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >& statistics, double minVariance, double loglike, unsigned int dataCount);
         public:
             GaussianMixtureModel<ScalarType>* clone();
             GaussianMixtureModelDiagCov(const GaussianMixtureModelDiagCov<ScalarType>& other);
             GaussianMixtureModelDiagCov();
             ~GaussianMixtureModelDiagCov() {}
+            bool isFullCov() const  {return false;}
+    };
+    
+    /**
+     * @brief A set of samples drawn from a gaussian mixture model, to compare
+     *      the model with a lot of other models.
+     * 
+     * GaussianMixtureModel::compareTo() draws new samples from the model
+     * and evaluates the model at them for every comparison. If one model is compared
+     * with a lot of others, e.g. the model of a recording with the models of
+     * all categories, this work only needs to be done once: this class keeps
+     * the samples and the logarithm of the density of the model at the samples.
+     * Every comparison then only evaluates the other model.
+     * 
+     * The samples may be stratified by the gaussians of the model, or taken
+     * from a low-discrepancy sequence. Both give estimates with a lower variance
+     * than random samples.
+     * 
+     * @code
+     * GMMSampleSet<kiss_fft_scalar> samples(*recordingModel, 200, GMM_SAMPLING_STRATIFIED);
+     * std::vector<kiss_fft_scalar> divergences;
+     * samples.compareTo(categoryModels, divergences);
+     * @endcode
+     * 
+     * @ingroup classification
+     */
+    template <typename ScalarType=kiss_fft_scalar>
+    class GMMSampleSet
+    {
+    private:
+        DataSet<ScalarType> samples;
+        Eigen::Matrix<double, Eigen::Dynamic, 1> logDensities;
+        
+        void drawStratifiedSamples(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount, bool quasiRandom);
+    public:
+        /**
+         * @brief Creates an empty sample set. Call drawSamples() before using it.
+         */
+        GMMSampleSet();
+        /**
+         * @brief Creates a sample set and draws the samples from the model.
+         * 
+         * @see drawSamples()
+         */
+        GMMSampleSet(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount=200, GMM_SAMPLING_METHOD method=GMM_SAMPLING_RANDOM);
+        
+        /**
+         * @brief Draws new samples from the model and evaluates the model at them.
+         * 
+         * The old samples will be replaced. With GMM_SAMPLING_QUASIRANDOM,
+         * the samples are the same every time.
+         * 
+         * @param model The model the samples will be drawn from.
+         * @param sampleCount The number of samples.
+         * @param method How the samples will be drawn.
+         */
+        void drawSamples(const GaussianMixtureModel<ScalarType>& model, unsigned int sampleCount=200, GMM_SAMPLING_METHOD method=GMM_SAMPLING_RANDOM);
+        
+        /**
+         * @brief Compares the model of the samples with another one.
+         * 
+         * Gives the same estimate of the Kullback-Leibler divergence as
+         * GaussianMixtureModel::compareTo(), for the samples of this set.
+         * 
+         * @param other The model the model of the samples will be compared to.
+         * @return The estimated divergence.
+         */
+        ScalarType compareTo(const GaussianMixtureModel<ScalarType>& other) const;
+        /**
+         * @brief Compares the model of the samples with a lot of other models.
+         * 
+         * @param others The models the model of the samples will be compared to.
+         * @param[out] divergences The estimated divergence for every model
+         *      of <code>others</code>, in the same order.
+         */
+        void compareTo(const std::vector<GaussianMixtureModel<ScalarType>*>& others, std::vector<ScalarType>& divergences) const;
+        
+        /**
+         * @brief Returns the samples, one per column.
+         * @return the samples, one per column.
+         */
+        const DataSet<ScalarType>& getSamples() const   {return samples;}
+        /**
+         * @brief Returns the number of samples.
+         * @return the number of samples.
+         */
+        unsigned int getSampleCount() const             {return samples.getSize();}
     };
     
     template <typename ScalarType> std::ostream& operator<<(std::ostream& os, const GaussianMixtureModel<ScalarType>& model);
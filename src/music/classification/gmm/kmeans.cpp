@@ -2,6 +2,8 @@
 
 #include "debug.hpp"
 #include <limits>
+#include <algorithm>
+#include <assert.h>
 #include "randomnumbers.hpp"
 
 namespace music
@@ -16,14 +18,20 @@ namespace music
     template <typename ScalarType, typename AssignmentType>
     bool KMeans<ScalarType, AssignmentType>::trainKMeans(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int meanCount, unsigned int maxIterations, bool keepAssignments, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& init)
     {
-        assert(data.size() > 0u);
+        return trainKMeans(DataSet<ScalarType>(data), meanCount, maxIterations, keepAssignments, init);
+    }
+    
+    template <typename ScalarType, typename AssignmentType>
+    bool KMeans<ScalarType, AssignmentType>::trainKMeans(const DataSet<ScalarType>& data, unsigned int meanCount, unsigned int maxIterations, bool keepAssignments, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& init)
+    {
+        assert(data.cols() > 0);
         assert(meanCount > 0u);
         DEBUG_OUT("initialize k-means algorithm...", 20);
         
         means.clear();
         
-        unsigned int dataSize = data.size();
-        int dimension = data[0].size();
+        unsigned int dataSize = data.cols();
+        int dimension = data.rows();
         
         //if no or wrong initialization is given: take random values out of the data
         if (init.empty() || (init.size() != meanCount))
@@ -31,15 +39,23 @@ namespace music
             DEBUG_OUT("no init vectors given. using random values...", 25);
             for (unsigned int i=0; i<meanCount; i++)
             {
-                means.push_back(data[std::rand() % dataSize]);
+                means.push_back(data.col(std::rand() % dataSize));
             }
         }
+        else
+        {
+            DEBUG_OUT("init vectors given. using them...", 25);
+            means = init;
+        }
         
-        //initialize assignments
+        //initialize assignments. no data vector is assigned to a cluster in the beginning.
         AssignmentType* assignments = new AssignmentType[dataSize];
         AssignmentType* oldAssignments = new AssignmentType[dataSize];
         AssignmentType* tmp = NULL;
+        for (unsigned int i=0; i<dataSize; i++)
+            oldAssignments[i] = -1;
         this->assignments.clear();
+        std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> > sums(meanCount);
         
         AssignmentType assignment;
         double minDistance, distance;
@@ -66,8 +82,8 @@ namespace music
                     // /smallest/ distance, we can omit the sqrt operation.
                     // it is not proven to be faster this way, so I will have
                     // both instructions here - you can choose. both work.
-                    distance = (means[j] - data[i]).norm();
-                    //distance = (means[j] - data[i]).array().square().sum();
+                    distance = (means[j] - data.col(i)).norm();
+                    //distance = (means[j] - data.col(i)).array().square().sum();
                     if (distance < minDistance)
                     {
                         minDistance = distance;
@@ -84,24 +100,24 @@ namespace music
             DEBUG_VAR_OUT(assignmentChanges, 0);
             
             DEBUG_OUT("recalculating means...", 25);
-            //first set means to zero...
+            //first set sums to zero...
             for (unsigned int i=0; i<meanCount; i++)
             {
-                means[i] = Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>(dimension);
-                means[i].setZero();
+                sums[i].setZero(dimension);
                 vectorCountInCluster[i] = 0;
             }
             //then add up values in each cluster...
             for (unsigned int i=0; i<dataSize; i++)
             {
-                means[assignments[i]] += data[i];
+                sums[assignments[i]] += data.col(i);
                 vectorCountInCluster[assignments[i]]++;
             }
-            //set mean by dividing through value count in cluster
+            //set mean by dividing through value count in cluster.
+            //empty clusters keep their old mean.
             for (unsigned int i=0; i<meanCount; i++)
             {
                 if (vectorCountInCluster[i] != 0)
-                    means[i] = means[i] / vectorCountInCluster[i];
+                    means[i] = sums[i] / vectorCountInCluster[i];
             }
             
             //for determining convergence
@@ -135,66 +151,65 @@ namespace music
     
     template<typename ScalarType, typename AssignmentType>
     void KMeans<ScalarType, AssignmentType>::calculateInitGuess(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& initGuess, unsigned int meanCount)
+    {
+        calculateInitGuess(DataSet<ScalarType>(data), initGuess, meanCount);
+    }
+    
+    template<typename ScalarType, typename AssignmentType>
+    void KMeans<ScalarType, AssignmentType>::calculateInitGuess(const DataSet<ScalarType>& data, std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& initGuess, unsigned int meanCount)
     {
         assert(meanCount > 0u);
-        assert(data.size() > 0u);
+        assert(data.cols() > 0);
         //first clear the initGuess vector. might not be empty.
         initGuess.clear();
         
-        UniformRNG<double> rng;
-        
-        unsigned int dataSize = data.size();
+        unsigned int dataSize = data.cols();
         //insert first point.
-        initGuess.push_back(data[std::rand() % dataSize]);
+        initGuess.push_back(data.col(std::rand() % dataSize));
         
-        Eigen::VectorXf distances(dataSize);
-        
-        float distance, minDistance;
-        int minDistanceElement=0;
-        double draw;
+        //squared distance of every data vector to the nearest guess so far.
+        Eigen::Matrix<double, Eigen::Dynamic, 1> distances(dataSize);
+        distances.setConstant(std::numeric_limits<double>::max());
         
         //create meanCount guesses. first value has been taken.
         for (unsigned int g=1; g<meanCount; g++)
         {
-            //calculate distances to nearest cluster mean guess
-            for (unsigned int i=0; i<dataSize; i++)
-            {
-                distance = minDistance = std::numeric_limits<float>::max();
-                for (unsigned int j=0; j<initGuess.size(); j++)
-                {
-                    // since we don't need the distance, but only the
-                    // /smallest/ distance, we can omit the sqrt operation.
-                    // it is not proven to be faster this way, so I will have
-                    // both instructions here - you can choose. both work.
-                    distance = (initGuess[j] - data[i]).norm();
-                    //distance = (initGuess[j] - data[i]).array().square().sum();
-                    if (distance < minDistance)
-                    {
-                        minDistance = distance;
-                    }
-                }
-                distances[i] = minDistance;
-            }
-            //draw random value in [0, maxDistance];
-            draw = rng.rand() * distances.maxCoeff();
-            //find the element that best fits to the drawn value (distance).
-            minDistance = std::numeric_limits<float>::max();
+            //only the distances to the newest guess can be smaller than before.
             for (unsigned int i=0; i<dataSize; i++)
-            {
-                distance = std::fabs(distances[i] - draw);
-                if (distance < minDistance)
-                {
-                    minDistance = distance;
-                    minDistanceElement = i;
-                }
-            }
-            //take that element.
-            initGuess.push_back(data[minDistanceElement]);
+                distances[i] = std::min(distances[i], (data.col(i) - initGuess.back()).template cast<double>().squaredNorm());
+            
+            //draw a data vector with a probability proportional to its squared distance.
+            initGuess.push_back(data.col(drawWeightedIndex(distances, double(std::rand()) / (double(RAND_MAX) + 1.0))));
         }
         
         assert(initGuess.size() == meanCount);
     }
     
+    unsigned int drawWeightedIndex(const Eigen::Matrix<double, Eigen::Dynamic, 1>& weights, double draw)
+    {
+        assert(weights.size() > 0);
+        double sum = weights.sum();
+        //all weights are zero: every index is as good as the others.
+        if (!(sum > 0.0))
+            return std::min((unsigned int)(draw * weights.size()), (unsigned int)(weights.size() - 1));
+        
+        double threshold = draw * sum;
+        double cumulatedWeight = 0.0;
+        for (int i=0; i<weights.size(); i++)
+        {
+            cumulatedWeight += weights[i];
+            if ((cumulatedWeight > threshold) && (weights[i] > 0.0))
+                return i;
+        }
+        //rounding errors. take the last index with a nonzero weight.
+        int i = weights.size() - 1;
+        while (!(weights[i] > 0.0))
+            i--;
+        return i;
+    }
+    
     template class KMeans<double>;
     template class KMeans<float>;
+    template class KMeans<double, unsigned short>;
+    template class KMeans<float, unsigned short>;
 }
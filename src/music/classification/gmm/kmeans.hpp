@@ -4,6 +4,8 @@
 #include <Eigen/Dense>
 #include <vector>
 
+#include "dataset.hpp"
+
 namespace music
 {
     /**
@@ -53,7 +55,7 @@ namespace music
          * If you don't know good guesses, it just takes random values
          * out of the data.
          * 
-         * @param data The data the algorithm will be run on.
+         * @param data The data the algorithm will be run on, one data vector per column.
          * @param meanCount The number of clusters, or means.
          * @param maxIterations The maximum number of iterations of the algorithm.
          * @param keepAssignments If the assignments of the data vectors should
@@ -68,6 +70,14 @@ namespace music
          * @return If the algorithm finished by fulfilling the convergence criterion,
          *      or stopped by reaching the maximum number of iterations.
          */
+        bool trainKMeans(const DataSet<ScalarType>& data, unsigned int meanCount=10, unsigned int maxIterations=500, bool keepAssignments = false, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& init=std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >());
+        /**
+         * @brief Runs the k-means algorithm.
+         * 
+         * Copies the data vectors into a DataSet and runs the algorithm on it.
+         * 
+         * @see trainKMeans(const DataSet<ScalarType>&, unsigned int, unsigned int, bool, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >&)
+         */
         bool trainKMeans(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, unsigned int meanCount=10, unsigned int maxIterations=500, bool keepAssignments = false, const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& init=std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >());
         
         /**
@@ -77,12 +87,22 @@ namespace music
          * 
          * The initial guesses are calculated such that the space of
          * input data will be represented in a better way than just
-         * taking random data.
+         * taking random data: The first guess is a random data vector, every
+         * following guess is a data vector drawn with a probability proportional
+         * to its squared distance to the nearest guess so far.
          * 
-         * @param data The data vectors used to find the initial clusters.
+         * @param data The data vectors used to find the initial clusters, one per column.
          * @param[out] initGuess The initial guesses will be given back in this vector.
          * @param meanCount The number of clusters, or means.
          */
+        void calculateInitGuess(const DataSet<ScalarType>& data, std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& initGuess, unsigned int meanCount=10);
+        /**
+         * @brief Calculates good initial guesses for the algorithm.
+         * 
+         * Copies the data vectors into a DataSet first.
+         * 
+         * @see calculateInitGuess(const DataSet<ScalarType>&, std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >&, unsigned int)
+         */
         void calculateInitGuess(const std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& data, std::vector<Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> >& initGuess, unsigned int meanCount=10);
         
         /**
@@ -114,6 +134,19 @@ namespace music
          */
         const std::vector<AssignmentType>& getAssignments() const                               {return assignments;}
     };
+    
+    /**
+     * @brief Draws an index with a probability proportional to its weight.
+     * 
+     * This is the sampling step of the k-means++ initialization.
+     * 
+     * @param weights The nonnegative weights of the indices.
+     * @param draw A uniformly distributed random number in <code>[0, 1[</code>.
+     * @return the index <code>i</code> for which the sum of the weights up to <code>i</code>
+     *      first exceeds <code>draw</code> times the sum of all weights. Indices with a weight of
+     *      zero are never chosen, unless all weights are zero.
+     */
+    unsigned int drawWeightedIndex(const Eigen::Matrix<double, Eigen::Dynamic, 1>& weights, double draw);
 }
 
 #endif //KMEANS_HPP
@@ -189,6 +189,22 @@ namespace music
          */
         virtual bool getRecordingIDs(std::vector<databaseentities::id_datatype>& recordingIDs, databaseentities::id_datatype minID=0, unsigned int limit = 10000)=0;
         
+        /**
+         * @brief Reads the IDs of all recordings whose features are marked
+         *      as preview-quality.
+         * 
+         * Use this to find the recordings that still need a full analysis.
+         * 
+         * @param recordingIDs The IDs of the recordings. The vector is empty if nothing matches.
+         * @param minID The minimum recordingID that should be found. Should
+         *      be used in combination with limit to find all recordings.
+         *      This ID is included in the results, if it is found.
+         * @param limit The maximum number of elements that will be given back.
+         * @return <code>true</code> if the operation succeeded, <code>false</code> otherwise
+         * @see databaseentities::RecordingFeatures::isPreview()
+         */
+        virtual bool getPreviewRecordingIDs(std::vector<databaseentities::id_datatype>& recordingIDs, databaseentities::id_datatype minID=0, unsigned int limit = 10000)=0;
+        
         /**
          * @brief Updates a recording in the database by giving the id.
          * 
@@ -41,7 +41,8 @@ namespace music
             tempo(0.0),
             dynamicRange(0.0),
             timbreModel(""),
-            chromaModel("")
+            chromaModel(""),
+            preview(false)
         {
             
         }
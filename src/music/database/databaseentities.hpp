@@ -33,6 +33,7 @@ namespace music
             double dynamicRange;
             std::string timbreModel;
             std::string chromaModel;
+            bool preview;
         protected:
             
         public:
@@ -57,6 +58,16 @@ namespace music
             
             void setChromaModel(const std::string& model) {this->chromaModel = model;}
             std::string getChromaModel() const        {return chromaModel;}
+            
+            /**
+             * @brief Marks the features as preview-quality.
+             * 
+             * Preview features have been extracted from a part of the
+             * recording only (see FilePreprocessor::setPreviewLength()).
+             * They should be replaced by a full analysis later on.
+             */
+            void setPreview(bool preview)             {this->preview = preview;}
+            bool isPreview() const                    {return preview;}
         };
         
         /**
@@ -21,6 +21,7 @@ namespace music
         _getRecordingByIDStatement                      (NULL),
         _getRecordingIDByFilenameStatement              (NULL),
         _getAllRecordingIDsStatement                    (NULL),
+        _getPreviewRecordingIDsStatement                (NULL),
         _getRecordingIDsByArtistTitleAlbumStatement     (NULL),
         _getRecordingIDsByCategoryMembershipScoresStatement(NULL),
         _getRecordingIDsByCategoryExampleScoresStatement(NULL),
@@ -84,6 +85,8 @@ namespace music
             sqlite3_finalize(_getRecordingIDByFilenameStatement);
         if (_getAllRecordingIDsStatement != NULL)
             sqlite3_finalize(_getAllRecordingIDsStatement);
+        if (_getPreviewRecordingIDsStatement != NULL)
+            sqlite3_finalize(_getPreviewRecordingIDsStatement);
         if (_getRecordingIDsByArtistTitleAlbumStatement != NULL)
             sqlite3_finalize(_getRecordingIDsByArtistTitleAlbumStatement);
         if (_getRecordingIDsByCategoryMembershipScoresStatement != NULL)
@@ -217,6 +220,15 @@ namespace music
         else
         {
             _dbOpen = true;
+            
+            //the database might have been created by an older version.
+            retVal = migrateTables();
+            
+            if (!retVal)
+            {
+                ERROR_OUT("migrating tables failed.", 10);
+                return false;
+            }
         }
         
         //now, database file is open.
@@ -255,7 +267,8 @@ namespace music
         ctstatements.push_back("CREATE TABLE IF NOT EXISTS features(featuresID INTEGER PRIMARY KEY, length REAL, "
             "tempo REAL, dynamicrange REAL, "
             "timbreModel TEXT, "
-            "chromaModel TEXT"
+            "chromaModel TEXT, "
+            "preview INTEGER"
             ");");
         
         ctstatements.push_back("CREATE TABLE IF NOT EXISTS category(categoryID INTEGER PRIMARY KEY, categoryName TEXT UNIQUE, "
@@ -312,6 +325,44 @@ namespace music
         return retVal;
     }
     
+    bool SQLiteDatabaseConnection::migrateTables()
+    {
+        assert(_dbOpen);
+        
+        //the preview flag of the features was added later.
+        sqlite3_stmt* statement = NULL;
+        int rc = sqlite3_prepare_v2(_db, "PRAGMA table_info(features);", -1, &statement, NULL);
+        if (rc != SQLITE_OK)
+        {
+            ERROR_OUT("Failed to prepare statement. Resultcode: " << rc, 10);
+            return false;
+        }
+        
+        bool tableExists = false;
+        bool hasPreviewColumn = false;
+        while ((rc = sqlite3_step(statement)) == SQLITE_ROW)
+        {
+            tableExists = true;
+            //the second column of the result is the name of the column.
+            if (std::string(reinterpret_cast<const char*>(sqlite3_column_text(statement, 1))) == "preview")
+                hasPreviewColumn = true;
+        }
+        sqlite3_finalize(statement);
+        if (rc != SQLITE_DONE)
+        {
+            ERROR_OUT("Failed to read the columns of the features table. Resultcode: " << rc, 10);
+            return false;
+        }
+        
+        if (tableExists && !hasPreviewColumn)
+        {
+            DEBUG_OUT("adding preview column to features table...", 20);
+            return execStatement("ALTER TABLE features ADD COLUMN preview INTEGER DEFAULT 0;");
+        }
+        
+        return true;
+    }
+    
     bool SQLiteDatabaseConnection::execStatement(std::string statement)
     {
         assert(_dbOpen);
@@ -589,7 +640,7 @@ namespace music
         
         if (_saveRecordingFeaturesStatement == NULL)
         {
-            rc = sqlite3_prepare_v2(_db, "INSERT INTO features VALUES(@featuresID, @length, @tempo, @dynamicrange, @timbreModel, @chromaModel);", -1, &_saveRecordingFeaturesStatement, NULL);
+            rc = sqlite3_prepare_v2(_db, "INSERT INTO features VALUES(@featuresID, @length, @tempo, @dynamicrange, @timbreModel, @chromaModel, @preview);", -1, &_saveRecordingFeaturesStatement, NULL);
             if (rc != SQLITE_OK)
             {
                 ERROR_OUT("Failed to prepare statement. Resultcode: " << rc, 10);
@@ -605,6 +656,7 @@ namespace music
         sqlite3_bind_double(_saveRecordingFeaturesStatement, 4, recordingFeatures.getDynamicRange());
         sqlite3_bind_text(_saveRecordingFeaturesStatement, 5, recordingFeatures.getTimbreModel().c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(_saveRecordingFeaturesStatement, 6, recordingFeatures.getChromaModel().c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int(_saveRecordingFeaturesStatement, 7, recordingFeatures.isPreview() ? 1 : 0);
         
         rc = sqlite3_step(_saveRecordingFeaturesStatement);
         if (rc != SQLITE_DONE)
@@ -1340,6 +1392,56 @@ namespace music
         return true;
     }
     
+    bool SQLiteDatabaseConnection::getPreviewRecordingIDs(std::vector<databaseentities::id_datatype>& recordingIDs, databaseentities::id_datatype minID, unsigned int limit)
+    {
+        DEBUG_OUT("will read recordingIDs with preview features now...", 35);
+        
+        int rc;
+        recordingIDs.clear();
+        
+        if (_getPreviewRecordingIDsStatement == NULL)
+        {
+            rc = sqlite3_prepare_v2(_db, "SELECT recordingID FROM recording NATURAL JOIN features WHERE preview=1 AND recordingID>=@minID ORDER BY recordingID ASC LIMIT @limit;", -1, &_getPreviewRecordingIDsStatement, NULL);
+            if (rc != SQLITE_OK)
+            {
+                ERROR_OUT("Failed to prepare statement. Resultcode: " << rc, 10);
+                return false;
+            }
+        }
+        
+        //bind parameters
+        sqlite3_bind_int64(_getPreviewRecordingIDsStatement, 1, minID);
+        sqlite3_bind_int(_getPreviewRecordingIDsStatement, 2, limit);
+        
+        while ((rc = sqlite3_step(_getPreviewRecordingIDsStatement)) != SQLITE_DONE)
+        {
+            if (rc == SQLITE_ROW)
+            {
+                recordingIDs.push_back(sqlite3_column_int64(_getPreviewRecordingIDsStatement, 0));
+            }
+            else
+            {
+                ERROR_OUT("Failed to read data from database. Resultcode: " << rc, 10);
+                return false;
+            }
+        }
+        
+        if (rc != SQLITE_DONE)
+        {
+            ERROR_OUT("Failed to execute statement. Resultcode: " << rc, 10);
+            return false;
+        }
+        
+        rc = sqlite3_reset(_getPreviewRecordingIDsStatement);
+        if (rc != SQLITE_OK)
+        {
+            ERROR_OUT("Failed to reset statement. Resultcode: " << rc, 10);
+            return false;
+        }
+        
+        return true;
+    }
+    
     bool SQLiteDatabaseConnection::getRecordingIDsInCategory(std::vector<std::pair<databaseentities::id_datatype, double> >& recordingIDsAndScores, databaseentities::id_datatype categoryID, double minScore, double maxScore, int limit)
     {
         DEBUG_OUT("will read recordingIDs and their scores by category ID and score now...", 35);
@@ -1467,7 +1569,7 @@ namespace music
         
         if (_getRecordingFeaturesByIDStatement == NULL)
         {
-            rc = sqlite3_prepare_v2(_db, "SELECT length, tempo, dynamicrange, timbreModel, chromaModel FROM features WHERE featuresID=@featuresID;", -1, &_getRecordingFeaturesByIDStatement, NULL);
+            rc = sqlite3_prepare_v2(_db, "SELECT length, tempo, dynamicrange, timbreModel, chromaModel, preview FROM features WHERE featuresID=@featuresID;", -1, &_getRecordingFeaturesByIDStatement, NULL);
             if (rc != SQLITE_OK)
             {
                 ERROR_OUT("Failed to prepare statement. Resultcode: " << rc, 10);
@@ -1488,6 +1590,7 @@ namespace music
                 recordingFeatures.setDynamicRange(sqlite3_column_double(_getRecordingFeaturesByIDStatement, 2));
                 recordingFeatures.setTimbreModel( std::string(reinterpret_cast<const char*>(sqlite3_column_text(_getRecordingFeaturesByIDStatement, 3))));
                 recordingFeatures.setChromaModel( std::string(reinterpret_cast<const char*>(sqlite3_column_text(_getRecordingFeaturesByIDStatement, 4))));
+                recordingFeatures.setPreview(     sqlite3_column_int(_getRecordingFeaturesByIDStatement, 5) != 0);
             }
             else
             {
@@ -1972,7 +2075,7 @@ namespace music
         int rc;
         if (_updateRecordingFeaturesStatement == NULL)
         {
-            rc = sqlite3_prepare_v2(_db, "UPDATE features SET length=@length, tempo=@tempo, dynamicrange=@dynamicrange, timbreModel=@timbreModel, chromaModel=@chromaModel WHERE featuresID=@featuresID;", -1, &_updateRecordingFeaturesStatement, NULL);
+            rc = sqlite3_prepare_v2(_db, "UPDATE features SET length=@length, tempo=@tempo, dynamicrange=@dynamicrange, timbreModel=@timbreModel, chromaModel=@chromaModel, preview=@preview WHERE featuresID=@featuresID;", -1, &_updateRecordingFeaturesStatement, NULL);
             if (rc != SQLITE_OK)
             {
                 ERROR_OUT("Failed to prepare statement. Resultcode: " << rc, 10);
@@ -1985,7 +2088,8 @@ namespace music
         sqlite3_bind_double(_updateRecordingFeaturesStatement, 3, recordingFeatures.getDynamicRange());
         sqlite3_bind_text(  _updateRecordingFeaturesStatement, 4, recordingFeatures.getTimbreModel().c_str(), -1, SQLITE_TRANSIENT);
         sqlite3_bind_text(  _updateRecordingFeaturesStatement, 5, recordingFeatures.getChromaModel().c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_int64( _updateRecordingFeaturesStatement, 6, recordingFeatures.getID());
+        sqlite3_bind_int(   _updateRecordingFeaturesStatement, 6, recordingFeatures.isPreview() ? 1 : 0);
+        sqlite3_bind_int64( _updateRecordingFeaturesStatement, 7, recordingFeatures.getID());
         
         rc = sqlite3_step(_updateRecordingFeaturesStatement);
         if (rc != SQLITE_DONE)
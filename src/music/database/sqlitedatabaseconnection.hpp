@@ -53,6 +53,7 @@ namespace music
          */
         bool getRecordingIDsByProperties(std::vector<databaseentities::id_datatype>& recordingIDs, const std::string& artist="%", const std::string& title="%", const std::string& album="%", const std::string& filename="%");
         bool getRecordingIDs(std::vector<databaseentities::id_datatype>& recordingIDs, databaseentities::id_datatype minID=0, unsigned int limit = 10000);
+        bool getPreviewRecordingIDs(std::vector<databaseentities::id_datatype>& recordingIDs, databaseentities::id_datatype minID=0, unsigned int limit = 10000);
         
         bool getRecordingFeaturesByID(databaseentities::RecordingFeatures& recordingFeatures);
         bool updateRecordingFeaturesByID(databaseentities::RecordingFeatures& recordingFeatures);
@@ -95,6 +96,7 @@ namespace music
         sqlite3_stmt* _getRecordingByIDStatement;
         sqlite3_stmt* _getRecordingIDByFilenameStatement;
         sqlite3_stmt* _getAllRecordingIDsStatement;
+        sqlite3_stmt* _getPreviewRecordingIDsStatement;
         sqlite3_stmt* _getRecordingIDsByArtistTitleAlbumStatement;
         sqlite3_stmt* _getRecordingIDsByCategoryMembershipScoresStatement;
         sqlite3_stmt* _getRecordingIDsByCategoryExampleScoresStatement;
@@ -146,6 +148,16 @@ namespace music
          * @return if the operation failed.
          */
         bool createTables();
+        /**
+         * @brief Updates the tables of a database that has been created
+         *      by an older version of the library.
+         * 
+         * This function is to be called upon opening an existing database.
+         * Columns that were added later will be added to the tables.
+         * 
+         * @return if the operation succeeded.
+         */
+        bool migrateTables();
         bool execStatement(std::string statement);
         databaseentities::id_datatype getLastInsertRowID();
         
@@ -0,0 +1,103 @@
+#include "adaptive_slicing.hpp"
+
+#include <assert.h>
+#include <cmath>
+#include <algorithm>
+
+#include "debug.hpp"
+
+namespace music
+{
+    bool findNonSilentRange(const float* samples, unsigned int sampleCount, unsigned int& firstSample, unsigned int& nonSilentSampleCount, unsigned int blockLength, double threshold)
+    {
+        assert(samples != NULL);
+        assert(blockLength > 0);
+        
+        //compare the sum of squares, no need for the square root.
+        double blockThreshold = threshold * threshold;
+        bool found = false;
+        unsigned int first = 0;
+        unsigned int end = 0;
+        for (unsigned int blockStart=0; blockStart<sampleCount; blockStart+=blockLength)
+        {
+            unsigned int blockEnd = std::min(blockStart + blockLength, sampleCount);
+            double sum = 0.0;
+            for (unsigned int i=blockStart; i<blockEnd; i++)
+                sum += double(samples[i]) * samples[i];
+            
+            if (sum > blockThreshold * (blockEnd - blockStart))
+            {
+                if (!found)
+                    first = blockStart;
+                found = true;
+                end = blockEnd;
+            }
+        }
+        
+        firstSample = first;
+        nonSilentSampleCount = end - first;
+        DEBUG_OUT("non-silent samples: " << firstSample << " to " << end << " of " << sampleCount, 20);
+        return found;
+    }
+    
+    void calculateSpectralFlux(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& means, Eigen::Matrix<double, Eigen::Dynamic, 1>& flux)
+    {
+        flux.resize(means.cols());
+        if (means.cols() == 0)
+            return;
+        
+        flux[0] = 0.0;
+        for (int i=1; i<means.cols(); i++)
+        {
+            double difference = (means.col(i) - means.col(i-1)).cwiseAbs().cast<double>().sum();
+            double sum = means.col(i).cwiseAbs().cast<double>().sum() + means.col(i-1).cwiseAbs().cast<double>().sum();
+            flux[i] = (sum > 0.0) ? difference / sum : 0.0;
+        }
+    }
+    
+    void selectTimeSlices(const Eigen::Matrix<double, Eigen::Dynamic, 1>& novelty, unsigned int maxCount, std::vector<int>& selected, double noveltyWeight)
+    {
+        assert(noveltyWeight >= 0.0);
+        assert(noveltyWeight <= 1.0);
+        
+        selected.clear();
+        int count = novelty.size();
+        if (count <= int(maxCount))
+        {
+            for (int i=0; i<count; i++)
+                selected.push_back(i);
+            return;
+        }
+        if (maxCount == 0)
+            return;
+        
+        double noveltySum = novelty.sum();
+        if (!(noveltySum > 0.0))
+            noveltyWeight = 0.0;
+        
+        //walk along the cumulated weights and take the time slice
+        //at the middle of every interval of length 1/maxCount.
+        double cumulatedWeight = 0.0;
+        unsigned int k = 0;
+        for (int i=0; (i<count) && (k<maxCount); i++)
+        {
+            assert(novelty[i] >= 0.0);
+            cumulatedWeight += (1.0 - noveltyWeight) / count;
+            if (noveltyWeight > 0.0)
+                cumulatedWeight += noveltyWeight * novelty[i] / noveltySum;
+            
+            //time slices with a high weight may contain more than one position.
+            //they are only taken once.
+            bool take = false;
+            while ((k < maxCount) && ((k + 0.5) / maxCount <= cumulatedWeight))
+            {
+                take = true;
+                k++;
+            }
+            if (take)
+                selected.push_back(i);
+        }
+        
+        DEBUG_OUT("selected " << selected.size() << " of " << count << " time slices.", 20);
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef ADAPTIVE_SLICING_HPP
+#define ADAPTIVE_SLICING_HPP
+
+#include "constantq.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+namespace music
+{
+    /**
+     * @brief Finds the part of a signal between its leading and trailing silence.
+     * 
+     * The signal is divided into blocks of <code>blockLength</code> samples.
+     * A block is silent if the RMS of its samples is below <code>threshold</code>.
+     * Silence in the middle of the signal is not removed.
+     * 
+     * @param samples The samples of the signal.
+     * @param sampleCount The number of samples.
+     * @param[out] firstSample The first sample of the first block that is not silent.
+     * @param[out] nonSilentSampleCount The number of samples from <code>firstSample</code>
+     *      to the end of the last block that is not silent.
+     * @param blockLength The length of the blocks, in samples. The default is 50ms at 22050Hz.
+     * @param threshold The RMS below which a block is silent. The default is -60dB.
+     * 
+     * @return <code>true</code> if the signal is not silent, <code>false</code> otherwise.
+     *      In the latter case, the output values are zero.
+     * @ingroup feature_extraction
+     */
+    bool findNonSilentRange(const float* samples, unsigned int sampleCount, unsigned int& firstSample, unsigned int& nonSilentSampleCount, unsigned int blockLength=1102, double threshold=0.001);
+    
+    /**
+     * @brief Calculates the spectral flux between consecutive time slices.
+     * 
+     * The flux of time slice <code>i</code> is the L1-distance of its mean values
+     * to the ones of time slice <code>i-1</code>, divided by the sum of both.
+     * It is in <code>[0, 1]</code>: zero for time slices which do not change,
+     * one for time slices which have nothing in common with the one before.
+     * The flux of the first time slice is zero.
+     * 
+     * @param means The mean values of the Constant Q bins, one column per time slice.
+     * @param[out] flux The spectral flux of every time slice.
+     * @ingroup feature_extraction
+     */
+    void calculateSpectralFlux(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& means, Eigen::Matrix<double, Eigen::Dynamic, 1>& flux);
+    
+    /**
+     * @brief Chooses at most <code>maxCount</code> time slices, preferring the ones where the signal changes.
+     * 
+     * Long stationary parts, like held notes or repeated loops, produce
+     * a lot of nearly identical feature vectors. This function samples the time
+     * slices such that parts with a high novelty (e.g. spectral flux) get more samples
+     * than stationary parts.
+     * 
+     * Every time slice gets the weight
+     * \f[
+     *      w_i = \frac{1-\alpha}{n} + \alpha \frac{novelty_i}{\sum_j novelty_j}
+     * \f]
+     * where \f$\alpha\f$ is <code>noveltyWeight</code>, and the time slices at
+     * <code>maxCount</code> evenly spaced positions of the cumulated weights
+     * are chosen. With \f$\alpha=0\f$, this is uniform subsampling. Stationary parts still get
+     * at least \f$1-\alpha\f$ times the samples they would get with uniform subsampling,
+     * so the distribution of the feature vectors does not change much.
+     * 
+     * @param novelty The novelty of every time slice. Needs to be nonnegative.
+     * @param maxCount The maximum number of time slices that will be chosen.
+     * @param[out] selected The indices of the chosen time slices, in ascending order.
+     *      If there are not more than <code>maxCount</code> time slices, all
+     *      of them will be chosen.
+     * @param noveltyWeight The weight \f$\alpha\in[0,1]\f$ of the novelty.
+     * @ingroup feature_extraction
+     */
+    void selectTimeSlices(const Eigen::Matrix<double, Eigen::Dynamic, 1>& novelty, unsigned int maxCount, std::vector<int>& selected, double noveltyWeight=0.5);
+}
+
+#endif  //ADAPTIVE_SLICING_HPP
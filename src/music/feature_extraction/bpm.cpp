@@ -2,6 +2,7 @@
 #include "debug.hpp"
 
 #include "feature_extraction_helper.hpp"
+#include "fft.hpp"
 
 #include <fstream>
 #include <algorithm>
@@ -13,6 +14,48 @@ namespace music
         return (T(0) < val) - (val < T(0));
     }
     
+    template <typename ScalarType>
+    void BPMEstimator<ScalarType>::calculateAutoCorrelation(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& data, int maxShift, Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& autoCorr)
+    {
+        assert(maxShift <= data.size());
+        
+        autoCorr.resize(std::max(maxShift, 0));
+        if (maxShift <= 0)
+            return;
+        
+        //zero-pad, such that the circular correlation of the FFT does not wrap around.
+        int fftLen = 1;
+        while (fftLen < data.size() + maxShift)
+            fftLen *= 2;
+        
+        FFT fft(fftLen);
+        kiss_fft_scalar* timeData = new kiss_fft_scalar[fftLen];
+        kiss_fft_cpx* freqData = new kiss_fft_cpx[fftLen];
+        
+        for (int i=0; i<data.size(); i++)
+            timeData[i] = data[i];
+        for (int i=data.size(); i<fftLen; i++)
+            timeData[i] = 0.0;
+        
+        int freqLength;
+        fft.doFFT(timeData, fftLen, freqData, freqLength);
+        
+        //the autocorrelation is the inverse transform of the power spectrum.
+        //the power spectrum is real and symmetric, so the inverse transform
+        //is the same as the forward transform, divided by fftLen.
+        for (int i=0; i<freqLength; i++)
+            timeData[i] = freqData[i].r * freqData[i].r + freqData[i].i * freqData[i].i;
+        for (int i=freqLength; i<fftLen; i++)
+            timeData[i] = timeData[fftLen - i];
+        
+        fft.doFFT(timeData, fftLen, freqData, freqLength);
+        for (int shift=0; shift<maxShift; shift++)
+            autoCorr[shift] = freqData[shift].r / fftLen;
+        
+        delete[] timeData;
+        delete[] freqData;
+    }
+    
     template <typename ScalarType>
     bool BPMEstimator<ScalarType>::estimateBPM(PerTimeSliceStatistics<ScalarType>* timeSliceStatistics)
     {
@@ -67,17 +110,8 @@ namespace music
         
         
         DEBUG_OUT("calculating auto correlation of derivation vector...", 15);
-        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> autoCorr(maxCorrShift);
-        for (int shift=0; shift<maxCorrShift; shift++)
-        {
-            double corr=0.0;
-            for (int i=0; i<derivSum.size(); i++)
-            {
-                int shiftPos = i + shift;
-                corr += derivSum[i] * ((shiftPos < derivSum.size()) ? derivSum[shiftPos] : 0.0);
-            }
-            autoCorr[shift] = corr;
-        }
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> autoCorr;
+        calculateAutoCorrelation(derivSum, maxCorrShift, autoCorr);
         
         #if DEBUG_LEVEL>=25
             std::ofstream outstr4("autoCorr.dat");
@@ -88,7 +122,12 @@ namespace music
             }
         #endif
         
-        
+        return estimateBPMFromAutoCorrelation(autoCorr, timeSliceStatistics->getTimeResolution());
+    }
+    
+    template <typename ScalarType>
+    bool BPMEstimator<ScalarType>::estimateBPMFromAutoCorrelation(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& autoCorr, double timeResolution)
+    {
         DEBUG_OUT("looking for maxima...", 15);
         std::vector<float> maxCorrPos;
         {
@@ -121,7 +160,7 @@ namespace music
             int risePos=-1;
             for (int i=1; i<autoCorr.size()-1; i++)
             {
-                if ((i-lastAddedPosition) > 0.2/timeSliceStatistics->getTimeResolution())
+                if ((i-lastAddedPosition) > 0.2/timeResolution)
                 {
                     if ((risePos < 0) && (autoCorr[i] > barrierVal) && (autoCorr[i] - autoCorr[i-1] > 0))   //rise
                     {
@@ -151,13 +190,13 @@ namespace music
             {
                 float val = *it - oldVal;
                 diffPosVector.push_back(val);
-                DEBUG_OUT("beat length bpm: " << 60.0/(double(val)*timeSliceStatistics->getTimeResolution()), 30);
+                DEBUG_OUT("beat length bpm: " << 60.0/(double(val)*timeResolution), 30);
                 DEBUG_OUT("val: " << double(val), 30);
                 bpmMean += val;
                 
                 oldVal = *it;
             }
-            this->bpmMean = 60.0/(bpmMean / diffPosVector.size()*timeSliceStatistics->getTimeResolution());
+            this->bpmMean = 60.0/(bpmMean / diffPosVector.size()*timeResolution);
             //sorting vector to get the median
             std::sort(diffPosVector.begin(), diffPosVector.end());
         }
@@ -168,12 +207,12 @@ namespace music
         while (this->bpmMean > 250) //try to get rid of too fast guesses
             this->bpmMean /= 2.0;
         
-        this->bpmMedian = 60.0/(double(diffPosVector[diffPosVector.size()/2])*timeSliceStatistics->getTimeResolution());
+        this->bpmMedian = 60.0/(double(diffPosVector[diffPosVector.size()/2])*timeResolution);
         
         this->bpmVariance = 0.0;
         for (std::vector<float>::iterator it = diffPosVector.begin(); it != diffPosVector.end(); it++)
         {
-            double val = 60.0/(double(*it)*timeSliceStatistics->getTimeResolution()) - bpmMean;
+            double val = 60.0/(double(*it)*timeResolution) - bpmMean;
             this->bpmVariance += val*val;
         }
         this->bpmVariance /= diffPosVector.size();
@@ -185,7 +224,7 @@ namespace music
  //       double newVariance = 0.0;
         for (std::vector<float>::iterator it = diffPosVector.begin(); it != diffPosVector.end(); it++)
         {
-            double val = 60.0/(double(*it)*timeSliceStatistics->getTimeResolution()) - bpmMean;
+            double val = 60.0/(double(*it)*timeResolution) - bpmMean;
             DEBUG_OUT(val << "; " << stdDeriv, 40);
             if (fabs(val) > stdDeriv + 5)
             {
@@ -197,10 +236,97 @@ namespace music
                 newDiffPosVector.push_back(*it);
             }
         }
-        this->bpmMean = 60.0/(newMean / newDiffPosVector.size()*timeSliceStatistics->getTimeResolution());
+        this->bpmMean = 60.0/(newMean / newDiffPosVector.size()*timeResolution);
         
         return true;
     }
     
+    template <typename ScalarType>
+    StreamingBPMEstimator<ScalarType>::StreamingBPMEstimator(double timeResolution, double windowLength, double maxShiftLength) :
+        timeResolution(timeResolution),
+        windowSize(windowLength / timeResolution),
+        maxShift(maxShiftLength / timeResolution),
+        history()
+    {
+        assert(timeResolution > 0.0);
+        assert(windowSize > 0);
+        assert(maxShift > 0);
+        
+        maxShift = std::min(maxShift, windowSize);
+        reset();
+    }
+    
+    template <typename ScalarType>
+    void StreamingBPMEstimator<ScalarType>::reset()
+    {
+        for (int i=0; i<5; i++)
+            hist[i] = 0.0;
+        histPos = 0;
+        lastSmoothedValue = 0.0;
+        inputCount = 0;
+        
+        history.assign(windowSize, 0.0);
+        valueCount = 0;
+        autoCorr = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(maxShift);
+    }
+    
+    template <typename ScalarType>
+    void StreamingBPMEstimator<ScalarType>::addValue(ScalarType value)
+    {
+        //same low-pass filter as in BPMEstimator::estimateBPM()
+        hist[histPos] = value;
+        double smoothedValue = (hist[0] + hist[1] + hist[2] + hist[3] + hist[4]) / 5.0;
+        histPos = (histPos + 1) % 5;
+        
+        if (inputCount > 0)
+            addDerivationValue(smoothedValue - lastSmoothedValue);
+        lastSmoothedValue = smoothedValue;
+        inputCount++;
+    }
+    
+    template <typename ScalarType>
+    void StreamingBPMEstimator<ScalarType>::addValues(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& values)
+    {
+        for (int i=0; i<values.size(); i++)
+            addValue(values[i]);
+    }
+    
+    template <typename ScalarType>
+    void StreamingBPMEstimator<ScalarType>::addDerivationValue(double value)
+    {
+        long n = valueCount;
+        
+        //the oldest value leaves the window: remove its products with the
+        //values following it, before its slot gets overwritten.
+        if (n >= windowSize)
+        {
+            long m = n - windowSize;
+            double oldValue = history[m % windowSize];
+            for (int shift=0; (shift<maxShift) && (m+shift<n); shift++)
+                autoCorr[shift] -= oldValue * history[(m+shift) % windowSize];
+        }
+        
+        history[n % windowSize] = value;
+        
+        //add the products of the new value with the values before it.
+        long firstInWindow = std::max(0l, n - windowSize + 1);
+        for (int shift=0; (shift<maxShift) && (n-shift>=firstInWindow); shift++)
+            autoCorr[shift] += value * history[(n-shift) % windowSize];
+        
+        valueCount++;
+    }
+    
+    template <typename ScalarType>
+    bool StreamingBPMEstimator<ScalarType>::estimateBPM()
+    {
+        int shiftCount = std::min(long(maxShift), valueCount);
+        if (shiftCount < 3)
+            return false;
+        
+        Eigen::Matrix<ScalarType, Eigen::Dynamic, 1> corr = autoCorr.head(shiftCount).template cast<ScalarType>();
+        return this->estimateBPMFromAutoCorrelation(corr, timeResolution);
+    }
+    
     template class BPMEstimator<kiss_fft_scalar>;
+    template class StreamingBPMEstimator<kiss_fft_scalar>;
 }
@@ -3,6 +3,7 @@
 
 #include "constantq.hpp"
 #include "feature_extraction_helper.hpp"
+#include <vector>
 
 namespace music
 {
@@ -21,13 +22,136 @@ namespace music
         
     protected:
         
+        /**
+         * @brief Estimates the tempo from the autocorrelation of the
+         *      derivation of the loudness of a signal.
+         * 
+         * Looks for the maxima of the autocorrelation and calculates
+         * the tempo from the distances between them.
+         * 
+         * @param autoCorr The autocorrelation, for shifts starting at zero.
+         * @param timeResolution The time between two values of the signal, in seconds.
+         * @return if a tempo could be found, or not.
+         */
+        bool estimateBPMFromAutoCorrelation(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& autoCorr, double timeResolution);
     public:
         bool estimateBPM(PerTimeSliceStatistics<ScalarType>* timeSliceStatistics);
         
+        /**
+         * @brief Calculates the autocorrelation of a signal for the shifts
+         *      <code>0</code> to <code>maxShift-1</code>.
+         * 
+         * The signal is zero-padded, so values shifted out of the signal
+         * count as zero. Uses the FFT of the zero-padded signal, which needs
+         * \f$O(n \log n)\f$ instead of \f$O(n \cdot maxShift)\f$ operations.
+         * 
+         * @param data The signal.
+         * @param maxShift The number of shifts the autocorrelation will be calculated for.
+         *      May not be larger than the size of the signal.
+         * @param[out] autoCorr The autocorrelation, <code>autoCorr[shift]</code>
+         *      is the sum of <code>data[i]*data[i+shift]</code>.
+         */
+        static void calculateAutoCorrelation(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& data, int maxShift, Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& autoCorr);
+        
         double getBPMMean() const       {return bpmMean;}
         double getBPMMedian() const     {return bpmMedian;}
         double getBPMVariance() const   {return bpmVariance;}
     };
+    
+    /**
+     * @brief Estimates the tempo of a signal while it is being read.
+     * 
+     * BPMEstimator::estimateBPM() needs the sum vector of the whole recording.
+     * This class takes the loudness of the signal one value at a time,
+     * e.g. the sums of the time slices of a constant Q transform, and
+     * may be asked for a tempo estimate at any time.
+     * 
+     * Only the last <code>windowLength</code> seconds of the signal are used.
+     * The autocorrelation of this window is updated with every new value,
+     * which needs \f$O(maxShift)\f$ operations, and the memory needed
+     * does not grow with the length of the signal. For long recordings,
+     * the estimate follows changes of the tempo.
+     * 
+     * @code
+     * StreamingBPMEstimator<kiss_fft_scalar> bpmEst(0.01);
+     * for (int i=0; i<sumVec.size(); i++)
+     * {
+     *     bpmEst.addValue(sumVec[i]);
+     *     if ((i % 1000 == 0) && bpmEst.estimateBPM())
+     *         std::cout << bpmEst.getBPMMean() << std::endl;
+     * }
+     * @endcode
+     * 
+     * @ingroup feature_extraction
+     */
+    template <typename ScalarType=kiss_fft_scalar>
+    class StreamingBPMEstimator : public BPMEstimator<ScalarType>
+    {
+    private:
+        double timeResolution;
+        int windowSize;
+        int maxShift;
+        
+        //moving average of the last 5 values, as in BPMEstimator::estimateBPM().
+        double hist[5];
+        int histPos;
+        double lastSmoothedValue;
+        long inputCount;
+        
+        //the last windowSize values of the derivation, as ring buffer.
+        std::vector<double> history;
+        long valueCount;
+        Eigen::Matrix<double, Eigen::Dynamic, 1> autoCorr;
+        
+        void addDerivationValue(double value);
+    protected:
+        
+    public:
+        using BPMEstimator<ScalarType>::estimateBPM;
+        
+        /**
+         * @brief Creates a new StreamingBPMEstimator object.
+         * 
+         * @param timeResolution The time between two values of the signal, in seconds.
+         * @param windowLength The length of the window the tempo will be estimated from, in seconds.
+         * @param maxShiftLength The longest shift of the autocorrelation, in seconds.
+         */
+        StreamingBPMEstimator(double timeResolution=0.01, double windowLength=30.0, double maxShiftLength=6.0);
+        
+        /**
+         * @brief Adds the next value of the signal.
+         * 
+         * @param value The loudness of the signal in the next time slice.
+         */
+        void addValue(ScalarType value);
+        /**
+         * @brief Adds the next values of the signal.
+         * 
+         * @param values The loudness of the signal in the next time slices.
+         */
+        void addValues(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& values);
+        
+        /**
+         * @brief Estimates the tempo from the values in the window.
+         * 
+         * Afterwards, the results may be read via getBPMMean(), getBPMMedian()
+         * and getBPMVariance().
+         * 
+         * @return if a tempo could be found, or not.
+         */
+        bool estimateBPM();
+        
+        /**
+         * @brief Forgets all values added so far.
+         */
+        void reset();
+        
+        /**
+         * @brief Returns the number of values added so far.
+         * @return the number of values added so far.
+         */
+        long getValueCount() const      {return inputCount;}
+    };
 }
 
 #endif
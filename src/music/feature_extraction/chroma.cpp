@@ -8,6 +8,7 @@
 #include <iomanip>
 #include <fstream>
 
+#include "feature_extraction_helper.hpp"
 #include "console_colors.hpp"
 #include "debug.hpp"
 
@@ -19,17 +20,35 @@ namespace music
         assert(transformResult != NULL);
     }
     
-    void ChromaEstimator::applyNonlinearFunction(Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>& vector)
+    void ChromaEstimator::applyNonlinearFunction(Eigen::Array<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& values)
     {
-        //vector = vector.array().pow(0.8);    //1.0236795
-        //vector = vector.array().pow(1.0);    //1.0253195
-        //vector = vector.array().pow(1.1);    //1.0256689
-        vector = vector.array().pow(1.2);    //1.0257333
-        //vector = vector.array().pow(1.3);    //1.0255818
-        //vector = vector.array().pow(1.5);    //1.0247591
-        //vector = vector.array().pow(2.0);    //1.0211522
-        //vector = vector.array().pow(2.5);    //1.0171494
-        //vector = vector.array().pow(3.0);    //works a bit better, but not good
+        //values = values.pow(0.8);    //1.0236795
+        //values = values.pow(1.0);    //1.0253195
+        //values = values.pow(1.1);    //1.0256689
+        values = values.pow(1.2);    //1.0257333
+        //values = values.pow(1.3);    //1.0255818
+        //values = values.pow(1.5);    //1.0247591
+        //values = values.pow(2.0);    //1.0211522
+        //values = values.pow(2.5);    //1.0171494
+        //values = values.pow(3.0);    //works a bit better, but not good
+    }
+    
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> ChromaEstimator::createChordTemplates(int binsPerOctave)
+    {
+        //row j is the major chord with root j, row j+binsPerOctave the minor one.
+        //the sum of the three notes is used instead of their mean: it is
+        //exact for float values, and the most likely chord is the same.
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> templates = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>::Zero(2*binsPerOctave, binsPerOctave);
+        for (int j=0; j<binsPerOctave; j++)
+        {
+            templates(j, j) += 1.0;
+            templates(j, (j+4)%binsPerOctave) += 1.0;
+            templates(j, (j+7)%binsPerOctave) += 1.0;
+            templates(j+binsPerOctave, j) += 1.0;
+            templates(j+binsPerOctave, (j+3)%binsPerOctave) += 1.0;
+            templates(j+binsPerOctave, (j+7)%binsPerOctave) += 1.0;
+        }
+        return templates;
     }
     
     std::string ChromaEstimator::getNoteName(int i)
@@ -57,103 +76,161 @@ namespace music
         return model;
     }
     
-    bool ChromaEstimator::estimateChroma(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength, bool makeTransposeInvariant)
+    //calculates the constant Q means of the time slices, column i-1 belongs to the time slice ending at i*timeSliceLength.
+    class ChromaMeanJob : public TimeSliceRangeJob
+    {
+    private:
+        ConstantQTransformResult* transformResult;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans;
+        double timeSliceLength;
+    public:
+        ChromaMeanJob(ConstantQTransformResult* transformResult, Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, double timeSliceLength) :
+            transformResult(transformResult), cqtMeans(cqtMeans), timeSliceLength(timeSliceLength)
+        {
+            
+        }
+        void processTimeSlices(int from, int to)
+        {
+            int binsPerOctave = transformResult->getBinsPerOctave();
+            int octaveCount = transformResult->getOctaveCount();
+            double time;
+            for (int i = from+1; i <= to; i++)
+            {
+                time = i * timeSliceLength;
+                
+                for (int bin=0; bin < binsPerOctave; bin++)
+                {
+                    for (int octave=0; octave<octaveCount; octave++)
+                    {
+                        cqtMeans(octave * binsPerOctave + bin, i-1) = transformResult->getNoteValueMean(time, octave, bin, timeSliceLength);
+                    }
+                }
+            }
+        }
+    };
+    
+    //calculates the unsmoothed chroma values of the time slices. they do not depend on each other.
+    class ChromaBinSumJob : public TimeSliceRangeJob
+    {
+    private:
+        const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans;
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& binSums;
+        std::vector<char>& valid;
+        int binsPerOctave;
+        int octaveCount;
+    public:
+        ChromaBinSumJob(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic>& binSums, std::vector<char>& valid, int binsPerOctave, int octaveCount) :
+            cqtMeans(cqtMeans), binSums(binSums), valid(valid), binsPerOctave(binsPerOctave), octaveCount(octaveCount)
+        {
+            
+        }
+        void processTimeSlices(int from, int to)
+        {
+            //calculate unsmoothed chroma of all time slices of this block at once, one per column
+            Eigen::Array<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> values = cqtMeans.middleCols(from, to-from).cwiseAbs();
+            Eigen::Array<kiss_fft_scalar, 1, Eigen::Dynamic> maxValues = values.colwise().maxCoeff();
+            for (int i=0; i<values.cols(); i++)
+            {
+                valid[from+i] = (maxValues[i] > 1e-14);
+                //silent time slices will not be used. keep them away from dividing by zero.
+                if (!valid[from+i])
+                    maxValues[i] = 1.0;
+            }
+            
+            //apply a nonlinear function.
+            //this step tries to cancel out overtones (hoping they are not
+            //as loud as the loudest parts of the signal) and find the
+            //relevant parts for chord estimation.
+            values.rowwise() /= maxValues;
+            ChromaEstimator::applyNonlinearFunction(values);
+            values.rowwise() *= maxValues;
+            
+            //fold the octaves. this is the product with a matrix of stacked identity
+            //matricies, but adding the octaves in order needs less operations.
+            binSums.middleCols(from, to-from) = values.topRows(binsPerOctave).cast<double>().matrix();
+            for (int octave=1; octave<octaveCount; octave++)
+                binSums.middleCols(from, to-from) += values.middleRows(octave * binsPerOctave, binsPerOctave).cast<double>().matrix();
+        }
+    };
+    
+    bool ChromaEstimator::estimateChroma(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength, bool makeTransposeInvariant, unsigned int threadCount)
     {
         assert(timeSliceLength > 0.0);
         
         int binsPerOctave = transformResult->getBinsPerOctave();
         int octaveCount = transformResult->getOctaveCount();
         
+        //the first time slice ends at timeSliceLength, so we have one column less than time slices.
+        int maxElement = transformResult->getOriginalDuration() / timeSliceLength;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> cqtMeans(binsPerOctave * octaveCount, std::max(maxElement - 1, 0));
+        ChromaMeanJob job(transformResult, cqtMeans, timeSliceLength);
+        job.run(cqtMeans.cols(), threadCount);
+        
+        return estimateChroma(cqtMeans, chromaVectors, mode, timeSliceLength, makeTransposeInvariant, threadCount);
+    }
+    
+    bool ChromaEstimator::estimateChroma(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength, bool makeTransposeInvariant, unsigned int threadCount)
+    {
+        assert(timeSliceLength > 0.0);
+        
+        int binsPerOctave = transformResult->getBinsPerOctave();
+        int octaveCount = transformResult->getOctaveCount();
+        
+        assert(cqtMeans.rows() == binsPerOctave * octaveCount);
+        
         chromaVectors.clear();
         
         //init chroma to all zeroes.
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> chroma(binsPerOctave);
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> actChroma(binsPerOctave);
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> overallChroma(binsPerOctave);
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> actChordLikelihood(2*binsPerOctave);
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> overallChordLikelihood(2*binsPerOctave);
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> actCQTmean(binsPerOctave * octaveCount);
         chroma.setZero();
         overallChroma.setZero();
         overallChordLikelihood.setZero();
         
-        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > chordLikelihoodVector;
-        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > localKeyChordLikelihoodVector;
+        //the unsmoothed chroma values of the time slices do not depend on each other,
+        //so they can be calculated in parallel. no std::vector<bool> here, since
+        //the threads would write to the same bytes.
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> binSums(binsPerOctave, cqtMeans.cols());
+        std::vector<char> valid(cqtMeans.cols(), false);
+        ChromaBinSumJob job(cqtMeans, binSums, valid, binsPerOctave, octaveCount);
+        job.run(cqtMeans.cols(), threadCount);
         
-        //calculate chroma vectors and chord likelihood vectors
-        int maxElement = transformResult->getOriginalDuration() / timeSliceLength;
+        //calculate chroma vectors.
+        //the smoothing depends on the previous time slices, so this is done in order.
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> chromaMatrix(binsPerOctave, cqtMeans.cols());
         int numValues = 0;
-        double time;
-        for (int i = 1; i < maxElement; i++)
+        for (int i = 0; i < cqtMeans.cols(); i++)
         {
-            time = i * timeSliceLength;
-            
-            //calculate unsmoothed chroma of active time slice
-            for (int bin=0; bin < binsPerOctave; bin++)
-            {
-                for (int octave=0; octave<octaveCount; octave++)
-                {
-                    actCQTmean[octave * binsPerOctave + bin] = std::abs(transformResult->getNoteValueMean(time, octave, bin, timeSliceLength));
-                }
-            }
-            
-            //apply a nonlinear function.
-            //this step tries to cancel out overtones (hoping they are not
-            //as loud as the loudest parts of the signal) and find the
-            //relevant parts for chord estimation.
-            double maxValue = fabs(actCQTmean.maxCoeff());
-            if (maxValue > 1e-14)
-            {
-                actCQTmean /= maxValue;
-                applyNonlinearFunction(actCQTmean);
-                actCQTmean *= maxValue;
-            }
-            else
+            if (!valid[i])
                 continue;
             
             //calculate new chroma values
             chroma *= 1.0-(timeSliceLength/0.125);     //exponential smoothing of the chroma vector, ca. 1/8s "half-life time"
             //DEBUG_VAR_OUT(chroma.transpose(), 0);
-            for (int bin=0; bin < binsPerOctave; bin++)
-            {
-                double binSum = 0.0;
-                for (int octave=0; octave<octaveCount; octave++)
-                {
-                    binSum += actCQTmean[octave * binsPerOctave + bin];
-                }
-                chroma[bin] += binSum*(timeSliceLength/0.125);     //exponential smoothing, see above
-            }
+            chroma = (chroma.cast<double>() + binSums.col(i)*(timeSliceLength/0.125)).cast<kiss_fft_scalar>();     //exponential smoothing, see above
             
             chroma.normalize();
-            chromaVectors.push_back(chroma);   //use normalized chroma vectors, don't want to depend on the volume
+            chromaMatrix.col(numValues) = chroma;   //use normalized chroma vectors, don't want to depend on the volume
             
             overallChroma += chroma;
             
-            //calculate the "likelihood" for chords. used to find out the mode of the recording
-            for (int j=0; j<binsPerOctave; j++)
-            {
-                actChordLikelihood[j]               = (chroma[j] + chroma[(j+4)%binsPerOctave] + chroma[(j+7)%binsPerOctave])/3.0;
-                actChordLikelihood[j+binsPerOctave] = (chroma[j] + chroma[(j+3)%binsPerOctave] + chroma[(j+7)%binsPerOctave])/3.0;
-            }
-            chordLikelihoodVector.push_back(actChordLikelihood);
-            
-            int maxLikelihoodChord = -1;
-            {
-                double maxLikelihoodValue = -std::numeric_limits<double>::max();
-                for (int k = 0; k < 2*binsPerOctave; k++)
-                {
-                    if (actChordLikelihood[k] > maxLikelihoodValue)
-                    {
-                        maxLikelihoodChord = k;
-                        maxLikelihoodValue = actChordLikelihood[k];
-                    }
-                }
-                overallChordLikelihood[maxLikelihoodChord] += 1.0;
-            }
-            
             numValues++;
         }
         
+        chromaVectors.reserve(numValues);
+        for (int i = 0; i < numValues; i++)
+            chromaVectors.push_back(chromaMatrix.col(i));
+        
+        //calculate the "likelihood" for chords of all chroma vectors at once. used to find out the mode of the recording
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> chordLikelihood = createChordTemplates(binsPerOctave) * chromaMatrix.leftCols(numValues).cast<double>();
+        for (int i = 0; i < numValues; i++)
+        {
+            int maxLikelihoodChord;
+            chordLikelihood.col(i).maxCoeff(&maxLikelihoodChord);
+            overallChordLikelihood[maxLikelihoodChord] += 1.0;
+        }
+        
         
         overallChroma /= numValues;
         
@@ -258,18 +335,17 @@ namespace music
             }
         }
         
-        chordLikelihoodVector.clear();
-        localKeyChordLikelihoodVector.clear();
         
         return true;
     }
     
-    bool ChromaModel::calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, double timeSliceLength, bool makeTransposeInvariant)
+    bool ChromaModel::calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, double timeSliceLength, bool makeTransposeInvariant, unsigned int threadCount)
     {
+        assert(transformResult != NULL);
         assert(timeSliceLength > 0.0);
         
         ChromaEstimator cEst(transformResult);
-        bool retVal = cEst.estimateChroma(chromaVectors, mode, timeSliceLength, makeTransposeInvariant);
+        bool retVal = cEst.estimateChroma(chromaVectors, mode, timeSliceLength, makeTransposeInvariant, threadCount);
         assert(mode != -1);
         
         return retVal;
@@ -277,13 +353,6 @@ namespace music
 
     bool ChromaModel::calculateModel(unsigned int modelSize, double timeSliceLength, bool makeTransposeInvariant, ProgressCallbackCaller* callback)
     {
-        if (model)
-        {
-            delete model;
-            model = NULL;
-        }
-        model = new GaussianMixtureModelDiagCov<kiss_fft_scalar>();
-        
         if (callback)
             callback->progress(0.0, "initialized");
         
@@ -291,69 +360,40 @@ namespace music
         if (!this->calculateChromaVectors(chroma, timeSliceLength, makeTransposeInvariant))
             return false;
         
-        DEBUG_VAR_OUT(chroma.size(), 0);
+        return calculateModel(chroma, modelSize, callback);
+    }
+    
+    bool ChromaModel::calculateModel(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chroma, unsigned int modelSize, ProgressCallbackCaller* callback)
+    {
+        return calculateModel(DataSet<kiss_fft_scalar>(chroma), modelSize, callback);
+    }
+    
+    bool ChromaModel::calculateModel(const DataSet<kiss_fft_scalar>& chroma, unsigned int modelSize, ProgressCallbackCaller* callback, unsigned int restartCount, unsigned int threadCount)
+    {
+        if (model)
+        {
+            delete model;
+            model = NULL;
+        }
+        model = new GaussianMixtureModelDiagCov<kiss_fft_scalar>();
+        
+        DEBUG_VAR_OUT(chroma.getSize(), 0);
         
         #if DEBUG_LEVEL > 30
             std::ofstream outstr("chroma.dat");
-            for (unsigned int i=0; i<chroma.size(); i++)
-                outstr << chroma[i].transpose() << std::endl;
+            for (int i=0; i<chroma.getSize(); i++)
+                outstr << chroma.col(i).transpose() << std::endl;
             outstr << std::endl;
         #endif
         
-        if (chroma.size() < modelSize)
+        if (chroma.getSize() < int(modelSize))
             return false;
         
-        //then train the model (best-of-three).
-        if (callback)
-            callback->progress(0.5,  "calculating model 1");
-        model->trainGMM(chroma, modelSize, 1e-8, 1e-10);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel1 = model->clone();
-        if (callback)
-            callback->progress(0.65, "calculating model 2");
-        model->trainGMM(chroma, modelSize, 1e-8, 1e-10);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel2 = model->clone();
+        //then train the model (best of restartCount models), starting from k-means clusters.
         if (callback)
-            callback->progress(0.8,  "calculating model 3");
-        model->trainGMM(chroma, modelSize, 1e-8, 1e-10);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel3 = model->clone();
-        
-        delete model;
-        model = NULL;
-        
-        if (callback)
-            callback->progress(0.95, "choose best model");
-        
-        //choose best-of-three
-        if (tmpModel1->getModelLogLikelihood() > tmpModel2->getModelLogLikelihood())
-        {
-            if (tmpModel1->getModelLogLikelihood() > tmpModel3->getModelLogLikelihood())
-            {
-                model = tmpModel1;
-                delete tmpModel2;
-                delete tmpModel3;
-            }
-            else
-            {
-                model = tmpModel3;
-                delete tmpModel1;
-                delete tmpModel2;
-            }
-        }
-        else
-        {
-            if (tmpModel2->getModelLogLikelihood() > tmpModel3->getModelLogLikelihood())
-            {
-                model = tmpModel2;
-                delete tmpModel1;
-                delete tmpModel3;
-            }
-            else
-            {
-                model = tmpModel3;
-                delete tmpModel1;
-                delete tmpModel2;
-            }
-        }
+            callback->progress(0.5,  "calculating models");
+        model->setInitMethod(GMM_INIT_KMEANS);
+        model->trainGMMBestOf(chroma, modelSize, restartCount, threadCount, 1e-8, 1e-10);
         
         if (callback)
             callback->progress(0.0, "finished");
@@ -372,6 +412,14 @@ namespace music
     {
         assert(transformResult != NULL);
     }
+    
+    ChromaModel::ChromaModel() :
+        transformResult(NULL),
+        model(NULL),
+        mode(-1)
+    {
+        
+    }
     ChromaModel::~ChromaModel()
     {
         if (model)
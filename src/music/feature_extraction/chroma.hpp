@@ -19,12 +19,52 @@ namespace music
     private:
         ConstantQTransformResult* transformResult;
         
-        void applyNonlinearFunction(Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>& vector);
+        static void applyNonlinearFunction(Eigen::Array<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& values);
         static std::string getNoteName(int i);
+        
+        friend class ChromaBinSumJob;
     protected:
     public:
         ChromaEstimator(ConstantQTransformResult* transformResult);
-        bool estimateChroma(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength = 0.05, bool makeTransposeInvariant = true);
+        
+        /**
+         * @brief Creates the matrix that calculates the likelihood of the major
+         *      and minor chords from a chroma vector.
+         * 
+         * Row <code>j</code> belongs to the major chord with root <code>j</code>,
+         * row <code>j+binsPerOctave</code> to the minor one. The most likely chord
+         * of a chroma vector is the largest entry of the product with it.
+         * 
+         * @param binsPerOctave The number of bins per octave of the chroma vectors.
+         * @return the chord templates, one chord per row.
+         */
+        static Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> createChordTemplates(int binsPerOctave);
+        
+        /**
+         * @brief Estimates the chroma vectors and the mode of the recording.
+         * 
+         * @param[out] chromaVectors A vector which will contain the chroma vectors.
+         * @param[out] mode The mode of the recording.
+         * @param timeSliceLength The length of the time slices in seconds.
+         * @param makeTransposeInvariant If the chroma vectors should be shifted
+         *      to the mode of the recording.
+         * @param threadCount The number of threads the time slices will be split across.
+         *      Only the smoothing of the chroma vectors is done in order afterwards,
+         *      so the result does not depend on the number of threads.
+         */
+        bool estimateChroma(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength = 0.05, bool makeTransposeInvariant = true, unsigned int threadCount = 1);
+        /**
+         * @brief Estimates the chroma vectors from the mean Constant Q values of all time slices.
+         * 
+         * Use this function if you already calculated the mean values,
+         * e.g. with a FusedFeatureExtractor.
+         * 
+         * @param cqtMeans The mean values of the Constant Q bins, one column per time slice.
+         *      Column <code>i</code> belongs to the time slice ending at
+         *      <code>(i+1)*timeSliceLength</code>. The rows are ordered by octave first and bin second.
+         * @param threadCount The number of threads the time slices will be split across.
+         */
+        bool estimateChroma(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, double timeSliceLength = 0.05, bool makeTransposeInvariant = true, unsigned int threadCount = 1);
     };
     
     /**
@@ -39,13 +79,20 @@ namespace music
         int mode;
     public:
         ChromaModel(ConstantQTransformResult* transformResult);
+        //for models of chroma vectors that have been calculated before. calculateChromaVectors()
+        //and calculateModel(modelSize, ...) need a transform result and may not be used.
+        ChromaModel();
         ~ChromaModel();
         
-        bool calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, double timeSliceLength=0.01, bool makeTransposeInvariant = true);
+        bool calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, double timeSliceLength=0.01, bool makeTransposeInvariant = true, unsigned int threadCount = 1);
         
         bool calculateModel(unsigned int modelSize=10, double timeSliceLength=0.05, bool makeTransposeInvariant = true, ProgressCallbackCaller* callback = NULL);
         
-        //bool calculateModel(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int modelSize=10, double timeSliceLength=0.02, unsigned int timbreVectorSize=12, ProgressCallbackCaller* callback = NULL);
+        //builds the model from chroma vectors that have been calculated before. does not change the mode.
+        bool calculateModel(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, unsigned int modelSize=10, ProgressCallbackCaller* callback = NULL);
+        //same as above, with the chroma vectors in one matrix, one per column.
+        //trains restartCount models in threadCount threads and keeps the best one.
+        bool calculateModel(const DataSet<kiss_fft_scalar>& chromaVectors, unsigned int modelSize=10, ProgressCallbackCaller* callback = NULL, unsigned int restartCount=3, unsigned int threadCount=1);
         
         //model of the chroma vectors
         GaussianMixtureModel<kiss_fft_scalar>* getModel();
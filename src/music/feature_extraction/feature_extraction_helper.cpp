@@ -2,7 +2,9 @@
 
 #include <assert.h>
 #include <limits>
+#include <vector>
 
+#include "pthread.hpp"
 #include "debug.hpp"
 
 namespace music
@@ -155,6 +157,10 @@ namespace music
     template <typename ScalarType>
     void PerTimeSliceStatistics<ScalarType>::calculateSum()
     {
+        //dynamic range and tempo both need the sum, only calculate it once.
+        if (sumVector != NULL)
+            return;
+        
         int binsPerOctave = transformResult->getBinsPerOctave();
         int octaveCount = transformResult->getOctaveCount();
         
@@ -187,6 +193,14 @@ namespace music
         }
     }
     
+    template <typename ScalarType>
+    void PerTimeSliceStatistics<ScalarType>::setSumVector(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& sumVector)
+    {
+        if (this->sumVector)
+            delete this->sumVector;
+        this->sumVector = new Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>(sumVector);
+    }
+    
     template <typename ScalarType>
     void PerTimeSliceStatistics<ScalarType>::calculateMeanMinMaxSum(bool calculateSum)
     {
@@ -258,6 +272,57 @@ namespace music
         (*varianceVector) /= binsPerOctave * octaveCount;
     }
     
+    //processes one block of time slices of a TimeSliceRangeJob.
+    class TimeSliceRangeThread : public PThread
+    {
+    private:
+        TimeSliceRangeJob* job;
+        int from;
+        int to;
+    public:
+        TimeSliceRangeThread(TimeSliceRangeJob* job, int from, int to) :
+            job(job), from(from), to(to)
+        {
+            
+        }
+        void run()
+        {
+            job->processTimeSlices(from, to);
+        }
+    };
+    
+    void TimeSliceRangeJob::run(int count, unsigned int threadCount)
+    {
+        if (count <= 0)
+            return;
+        if ((threadCount <= 1) || (count < 2))
+        {
+            processTimeSlices(0, count);
+            return;
+        }
+        if (threadCount > (unsigned int)count)
+            threadCount = count;
+        
+        //the calling thread processes the first block itself.
+        std::vector<TimeSliceRangeThread*> threads;
+        int blockSize = count / threadCount;
+        int firstBlockEnd = count - (threadCount-1)*blockSize;
+        for (unsigned int i=1; i<threadCount; i++)
+        {
+            int from = firstBlockEnd + (i-1)*blockSize;
+            TimeSliceRangeThread* thread = new TimeSliceRangeThread(this, from, from + blockSize);
+            thread->start();
+            threads.push_back(thread);
+        }
+        processTimeSlices(0, firstBlockEnd);
+        
+        for (unsigned int i=0; i<threads.size(); i++)
+        {
+            threads[i]->join();
+            delete threads[i];
+        }
+    }
+    
     template class PerBinStatistics<kiss_fft_scalar>;
     template class PerTimeSliceStatistics<kiss_fft_scalar>;
 }
@@ -123,7 +123,22 @@ namespace music
         
         double getTimeResolution()      {return timeResolution;}
         
+        /**
+         * @brief Calculates the sum of all bins per time slice.
+         * 
+         * Does nothing if the sum has already been calculated or set.
+         */
         void calculateSum();
+        /**
+         * @brief Sets a sum vector that has been calculated elsewhere.
+         * 
+         * Use this if you calculated the sum vector with the same
+         * time resolution before, e.g. with a FusedFeatureExtractor. calculateSum()
+         * will not calculate the sum again afterwards.
+         * 
+         * @param sumVector the sum vector with the sums per time slice.
+         */
+        void setSumVector(const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>& sumVector);
         /**
          * @brief Calculates the mean, maximum, minimum and sum values per bin.
          * 
@@ -209,5 +224,47 @@ namespace music
          */
         const Eigen::Matrix<ScalarType, Eigen::Dynamic, 1>* getSumVector() const             {return sumVector;}
     };
+    
+    /**
+     * @brief Base class for calculations on time slices that do not
+     *      depend on each other.
+     * 
+     * Implement processTimeSlices() in a derived class. run() splits the
+     * time slices into contiguous blocks and processes every block in its
+     * own thread. Write the result of time slice <code>i</code> to
+     * position <code>i</code> of the output, then the results are in order
+     * afterwards, no matter which thread finished first.
+     * 
+     * This lowers the latency of processing a single file, e.g. if there
+     * are less files to process than processor cores.
+     * 
+     * @ingroup feature_extraction
+     */
+    class TimeSliceRangeJob
+    {
+    public:
+        virtual ~TimeSliceRangeJob() {}
+        
+        /**
+         * @brief Processes the time slices <code>from</code> to <code>to-1</code>.
+         * 
+         * Will be called from several threads at the same time, with ranges
+         * that do not overlap.
+         * 
+         * @param from The first time slice that should be processed.
+         * @param to The time slice after the last one that should be processed.
+         */
+        virtual void processTimeSlices(int from, int to)=0;
+        
+        /**
+         * @brief Processes all time slices and returns after all of them have been processed.
+         * 
+         * @param count The number of time slices.
+         * @param threadCount The number of threads that should be used. If
+         *      it is <code>1</code>, all time slices will be processed in the
+         *      calling thread.
+         */
+        void run(int count, unsigned int threadCount=1);
+    };
 }
 #endif //FEATURE_EXTRACTION_HELPER_HPP
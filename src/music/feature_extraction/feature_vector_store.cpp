@@ -0,0 +1,230 @@
+#include "feature_vector_store.hpp"
+
+#include <stdint.h>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "stringhelper.hpp"
+#include "debug.hpp"
+
+#define FEATURE_VECTOR_STORE_MAGIC      "LMFV"
+#define FEATURE_VECTOR_STORE_VERSION    1
+#define FEATURE_VECTOR_STORE_ENDING     ".vec"
+
+namespace music
+{
+    //header of an entry. 32 bytes, so the values are aligned.
+    struct FeatureVectorStoreHeader
+    {
+        char magic[4];
+        uint32_t version;
+        //size of one value in bytes: 2 for half, 4 for single precision.
+        uint32_t valueSize;
+        uint32_t timbreDimension;
+        uint32_t timbreCount;
+        uint32_t chromaDimension;
+        uint32_t chromaCount;
+        uint32_t reserved;
+    };
+    
+    //IEEE 754 binary16, rounded to nearest even.
+    static uint16_t floatToHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign = (bits >> 16) & 0x8000;
+        uint32_t absBits = bits & 0x7fffffff;
+        
+        //infinity and NaN
+        if (absBits >= 0x7f800000)
+            return sign | 0x7c00 | ((absBits > 0x7f800000) ? 0x0200 : 0);
+        //too large, rounds to infinity
+        if (absBits >= 0x477ff000)
+            return sign | 0x7c00;
+        //subnormal halfs
+        if (absBits < 0x38800000)
+        {
+            //too small, rounds to zero
+            if (absBits < 0x33000000)
+                return sign;
+            uint32_t mantissa = (absBits & 0x007fffff) | 0x00800000;
+            int shift = 126 - int(absBits >> 23);
+            uint32_t half = mantissa >> shift;
+            uint32_t remainder = mantissa & ((1u << shift) - 1);
+            uint32_t halfway = 1u << (shift - 1);
+            if ((remainder > halfway) || ((remainder == halfway) && (half & 1)))
+                half++;
+            return sign | half;
+        }
+        
+        //normal halfs. a carry of the rounding goes into the exponent, which is correct.
+        uint32_t half = (absBits - 0x38000000) >> 13;
+        uint32_t remainder = absBits & 0x1fff;
+        if ((remainder > 0x1000) || ((remainder == 0x1000) && (half & 1)))
+            half++;
+        return sign | half;
+    }
+    static float halfToFloat(uint16_t half)
+    {
+        uint32_t sign = uint32_t(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1f;
+        uint32_t mantissa = half & 0x03ff;
+        
+        uint32_t bits;
+        if (exponent == 0)
+        {
+            //zero and subnormal halfs
+            float value = std::ldexp(float(mantissa), -24);
+            return sign ? -value : value;
+        }
+        else if (exponent == 0x1f)
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        else
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    
+    static bool writeValues(FILE* file, const DataSet<kiss_fft_scalar>& data, bool halfPrecision)
+    {
+        //DataSet is contiguous, so we can write everything at once.
+        if (!halfPrecision)
+        {
+            Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> values = data.cast<float>();
+            return fwrite(values.data(), sizeof(float), values.size(), file) == size_t(values.size());
+        }
+        
+        std::vector<uint16_t> values(data.size());
+        for (int i=0; i<data.size(); i++)
+            values[i] = floatToHalf(data.data()[i]);
+        return values.empty() || (fwrite(&values[0], sizeof(uint16_t), values.size(), file) == values.size());
+    }
+    
+    static void readValues(const char* values, uint32_t valueSize, uint32_t dimension, uint32_t count, DataSet<kiss_fft_scalar>& data)
+    {
+        data.resize(dimension, count);
+        if (valueSize == sizeof(float))
+        {
+            data = Eigen::Map<const Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic> >(reinterpret_cast<const float*>(values), dimension, count).cast<kiss_fft_scalar>();
+        }
+        else
+        {
+            const uint16_t* halfValues = reinterpret_cast<const uint16_t*>(values);
+            for (int i=0; i<data.size(); i++)
+                data.data()[i] = halfToFloat(halfValues[i]);
+        }
+    }
+    
+    FeatureVectorStore::FeatureVectorStore(const std::string& storeDirectory, bool halfPrecision) :
+        storeDirectory(storeDirectory), halfPrecision(halfPrecision)
+    {
+        if (!endsWith(this->storeDirectory, "/"))
+            this->storeDirectory += "/";
+        //fails if it already exists, which is okay.
+        mkdir(this->storeDirectory.c_str(), 0755);
+    }
+    
+    std::string FeatureVectorStore::getEntryFilename(databaseentities::id_datatype recordingID) const
+    {
+        std::ostringstream filename;
+        filename << storeDirectory << recordingID << FEATURE_VECTOR_STORE_ENDING;
+        return filename.str();
+    }
+    
+    bool FeatureVectorStore::store(databaseentities::id_datatype recordingID, const DataSet<kiss_fft_scalar>& timbreVectors, const DataSet<kiss_fft_scalar>& chromaVectors) const
+    {
+        //unique per process and thread, so nobody else writes to this file.
+        std::ostringstream tmpFilename;
+        tmpFilename << getEntryFilename(recordingID) << ".tmp." << getpid() << "." << (unsigned long)pthread_self();
+        
+        FILE* file = fopen(tmpFilename.str().c_str(), "wb");
+        if (file == NULL)
+        {
+            ERROR_OUT("could not create feature vector entry " << tmpFilename.str(), 10);
+            return false;
+        }
+        
+        FeatureVectorStoreHeader header;
+        std::memcpy(header.magic, FEATURE_VECTOR_STORE_MAGIC, 4);
+        header.version = FEATURE_VECTOR_STORE_VERSION;
+        header.valueSize = halfPrecision ? sizeof(uint16_t) : sizeof(float);
+        header.timbreDimension = timbreVectors.getDimension();
+        header.timbreCount = timbreVectors.getSize();
+        header.chromaDimension = chromaVectors.getDimension();
+        header.chromaCount = chromaVectors.getSize();
+        header.reserved = 0;
+        
+        bool success = (fwrite(&header, sizeof(FeatureVectorStoreHeader), 1, file) == 1);
+        success = success && writeValues(file, timbreVectors, halfPrecision);
+        success = success && writeValues(file, chromaVectors, halfPrecision);
+        success = (fclose(file) == 0) && success;
+        
+        if (!success || (rename(tmpFilename.str().c_str(), getEntryFilename(recordingID).c_str()) != 0))
+        {
+            ERROR_OUT("could not write feature vector entry " << getEntryFilename(recordingID), 10);
+            unlink(tmpFilename.str().c_str());
+            return false;
+        }
+        
+        return true;
+    }
+    
+    bool FeatureVectorStore::load(databaseentities::id_datatype recordingID, DataSet<kiss_fft_scalar>& timbreVectors, DataSet<kiss_fft_scalar>& chromaVectors) const
+    {
+        std::string entryFilename = getEntryFilename(recordingID);
+        int fd = ::open(entryFilename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        
+        struct stat entryStat;
+        if ((fstat(fd, &entryStat) != 0) || (size_t(entryStat.st_size) < sizeof(FeatureVectorStoreHeader)))
+        {
+            ::close(fd);
+            return false;
+        }
+        
+        size_t mappingSize = entryStat.st_size;
+        void* mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return false;
+        
+        const FeatureVectorStoreHeader* header = static_cast<const FeatureVectorStoreHeader*>(mapping);
+        uint64_t timbreValueCount = uint64_t(header->timbreDimension) * header->timbreCount;
+        uint64_t chromaValueCount = uint64_t(header->chromaDimension) * header->chromaCount;
+        if ((std::memcmp(header->magic, FEATURE_VECTOR_STORE_MAGIC, 4) != 0) ||
+            (header->version != FEATURE_VECTOR_STORE_VERSION) ||
+            ((header->valueSize != sizeof(uint16_t)) && (header->valueSize != sizeof(float))) ||
+            (sizeof(FeatureVectorStoreHeader) + (timbreValueCount + chromaValueCount) * header->valueSize != mappingSize))
+        {
+            DEBUG_OUT("ignoring broken feature vector entry " << entryFilename, 10);
+            munmap(mapping, mappingSize);
+            return false;
+        }
+        
+        const char* values = static_cast<const char*>(mapping) + sizeof(FeatureVectorStoreHeader);
+        readValues(values, header->valueSize, header->timbreDimension, header->timbreCount, timbreVectors);
+        values += timbreValueCount * header->valueSize;
+        readValues(values, header->valueSize, header->chromaDimension, header->chromaCount, chromaVectors);
+        
+        munmap(mapping, mappingSize);
+        return true;
+    }
+    
+    bool FeatureVectorStore::remove(databaseentities::id_datatype recordingID) const
+    {
+        return unlink(getEntryFilename(recordingID).c_str()) == 0;
+    }
+}
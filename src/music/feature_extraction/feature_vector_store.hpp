@@ -0,0 +1,109 @@
+#ifndef FEATURE_VECTOR_STORE_HPP
+#define FEATURE_VECTOR_STORE_HPP
+
+#include <string>
+#include "databaseentities.hpp"
+#include "constantq.hpp"
+#include "dataset.hpp"
+
+namespace music
+{
+    /**
+     * @brief An on-disk store for the timbre and chroma vectors of recordings.
+     * 
+     * The database only holds the models that have been trained from the
+     * timbre and chroma vectors of a recording, the vectors themselves
+     * are thrown away. Changing the size of the models or the training
+     * parameters would then mean to decode and transform every recording again.
+     * If the vectors are kept in this store, new models can be trained from them
+     * directly, see FilePreprocessor::remodelRecording().
+     * 
+     * Entries are addressed by the ID of the recording. Every entry is a flat file:
+     * a 32 byte header, followed by the timbre vectors and then the chroma vectors,
+     * one vector after the other, in host byte order. They are loaded via <code>mmap()</code>.
+     * The values can be saved with half precision (16 bit floats), which halves the size
+     * of the store. Both kinds of entries can be read, regardless of the setting.
+     * 
+     * All functions may be called from multiple threads at the same time.
+     * 
+     * @code
+     * FeatureVectorStore store("./vectors/", true);
+     * store.store(recordingID, timbreVectors, chromaVectors);
+     * //...
+     * DataSet<kiss_fft_scalar> timbreVectors;
+     * DataSet<kiss_fft_scalar> chromaVectors;
+     * if (store.load(recordingID, timbreVectors, chromaVectors))
+     * {
+     *     //train the models here
+     * }
+     * @endcode
+     * 
+     * @ingroup feature_extraction
+     */
+    class FeatureVectorStore
+    {
+    private:
+        std::string storeDirectory;
+        bool halfPrecision;
+        
+        std::string getEntryFilename(databaseentities::id_datatype recordingID) const;
+    public:
+        /**
+         * @brief Creates a new store in the given directory.
+         * 
+         * The directory will be created if it does not exist.
+         * 
+         * @param storeDirectory The directory the entries will be saved in.
+         * @param halfPrecision If new entries should be saved with half precision.
+         *      The values then have about three significant decimal digits, which
+         *      is enough to train the models.
+         */
+        FeatureVectorStore(const std::string& storeDirectory, bool halfPrecision = false);
+        
+        /**
+         * @brief Saves the feature vectors of a recording.
+         * 
+         * An old entry of the recording will be replaced. The entry is written to
+         * a temporary file first and then renamed, such that other threads or processes
+         * never see half-written entries.
+         * 
+         * @param recordingID The ID of the recording.
+         * @param timbreVectors The timbre vectors of the recording, one per column.
+         * @param chromaVectors The chroma vectors of the recording, one per column.
+         * @return <code>true</code> if the operation succeeded, <code>false</code> otherwise.
+         */
+        bool store(databaseentities::id_datatype recordingID, const DataSet<kiss_fft_scalar>& timbreVectors, const DataSet<kiss_fft_scalar>& chromaVectors) const;
+        
+        /**
+         * @brief Loads the feature vectors of a recording.
+         * 
+         * @param recordingID The ID of the recording.
+         * @param[out] timbreVectors The timbre vectors of the recording. The old contents will be replaced.
+         * @param[out] chromaVectors The chroma vectors of the recording. The old contents will be replaced.
+         * @return <code>true</code> if the operation succeeded, <code>false</code>
+         *      if there is no valid entry for the recording.
+         */
+        bool load(databaseentities::id_datatype recordingID, DataSet<kiss_fft_scalar>& timbreVectors, DataSet<kiss_fft_scalar>& chromaVectors) const;
+        
+        /**
+         * @brief Deletes the feature vectors of a recording.
+         * 
+         * @param recordingID The ID of the recording.
+         * @return <code>true</code> if the entry has been deleted, <code>false</code> otherwise.
+         */
+        bool remove(databaseentities::id_datatype recordingID) const;
+        
+        /**
+         * @brief Returns the directory the entries are saved in.
+         * @return the directory the entries are saved in.
+         */
+        std::string getStoreDirectory() const   {return storeDirectory;}
+        /**
+         * @brief Returns if new entries will be saved with half precision.
+         * @return if new entries will be saved with half precision.
+         */
+        bool isHalfPrecision() const            {return halfPrecision;}
+    };
+}
+
+#endif  //FEATURE_VECTOR_STORE_HPP
@@ -0,0 +1,268 @@
+#include "fused_extraction.hpp"
+
+#include "timbre.hpp"
+#include "chroma.hpp"
+#include "adaptive_slicing.hpp"
+#include "feature_extraction_helper.hpp"
+
+#include <assert.h>
+#include <complex>
+#include <algorithm>
+
+#include "debug.hpp"
+
+namespace music
+{
+    FusedFeatureExtractor::FusedFeatureExtractor(ConstantQTransformResult* transformResult, double sumTimeResolution, double timbreTimeSliceSize, double chromaTimeSliceSize) :
+        transformResult(transformResult),
+        sumTimeResolution(sumTimeResolution),
+        timbreTimeSliceSize(timbreTimeSliceSize),
+        chromaTimeSliceSize(chromaTimeSliceSize)
+    {
+        assert(transformResult != NULL);
+        assert(sumTimeResolution > 0.0);
+        assert(timbreTimeSliceSize > 0.0);
+        assert(chromaTimeSliceSize > 0.0);
+    }
+    
+    void FusedFeatureExtractor::initGrid(TimeSliceGrid& grid, int octave)
+    {
+        grid.prePos.resize(grid.times.size());
+        grid.pos.resize(grid.times.size());
+        
+        //empty time slices can only be at the beginning. they stay zero.
+        grid.first = 0;
+        for (unsigned int i=0; i<grid.times.size(); i++)
+        {
+            if (!transformResult->getColumnRange(grid.times[i], octave, grid.preDurations[i], grid.prePos[i], grid.pos[i]))
+                grid.first = i+1;
+        }
+        grid.next = grid.first;
+    }
+    
+    //sweeps a range of time slices, see TimeSliceRangeJob.
+    class FusedExtractionJob : public TimeSliceRangeJob
+    {
+    private:
+        FusedFeatureExtractor* extractor;
+        int blockCount;
+    public:
+        FusedExtractionJob(FusedFeatureExtractor* extractor, int blockCount) :
+            extractor(extractor), blockCount(blockCount)
+        {
+            
+        }
+        void processTimeSlices(int from, int to)
+        {
+            extractor->extractTimeSlices(from, to, blockCount);
+        }
+    };
+    
+    void FusedFeatureExtractor::extract(unsigned int threadCount)
+    {
+        int binsPerOctave = transformResult->getBinsPerOctave();
+        int octaveCount = transformResult->getOctaveCount();
+        double duration = transformResult->getOriginalDuration();
+        
+        //the time slices need to be exactly the same as the ones the single features use,
+        //so calculate them the same way.
+        TimeSliceGrid& sumGrid = grids[0];
+        TimeSliceGrid& timbreGrid = grids[1];
+        TimeSliceGrid& chromaGrid = grids[2];
+        for (int g=0; g<3; g++)
+        {
+            grids[g].times.clear();
+            grids[g].preDurations.clear();
+            grids[g].offset = 0;
+        }
+        
+        //see PerTimeSliceStatistics::calculateSum()
+        int elementCount = duration / sumTimeResolution;
+        for (int i=0; i<elementCount; i++)
+        {
+            sumGrid.times.push_back(i*sumTimeResolution);
+            sumGrid.preDurations.push_back(sumTimeResolution);
+        }
+        
+        //see TimbreModel::calculateTimbreVectors() and TimbreEstimator::estimateTimbre()
+        for (int i=1; i<duration/timbreTimeSliceSize; i++)
+        {
+            double time = i*timbreTimeSliceSize;
+            timbreGrid.times.push_back(time);
+            timbreGrid.preDurations.push_back(time - (time - timbreTimeSliceSize));
+        }
+        
+        //see ChromaEstimator::estimateChroma()
+        int maxElement = duration / chromaTimeSliceSize;
+        for (int i=1; i<maxElement; i++)
+        {
+            chromaGrid.times.push_back(i*chromaTimeSliceSize);
+            chromaGrid.preDurations.push_back(chromaTimeSliceSize);
+        }
+        
+        sums = Eigen::Matrix<double, Eigen::Dynamic, 1>::Zero(sumGrid.times.size());
+        timbreMeans = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>::Zero(binsPerOctave * octaveCount, timbreGrid.times.size());
+        chromaMeans = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>::Zero(binsPerOctave * octaveCount, chromaGrid.times.size());
+        
+        //the finest grid decides how fine the time can be split.
+        int blockCount = std::max(sumGrid.times.size(), std::max(timbreGrid.times.size(), chromaGrid.times.size()));
+        FusedExtractionJob job(this, blockCount);
+        job.run(blockCount, threadCount);
+        
+        sumVector = sums.cast<kiss_fft_scalar>();
+    }
+    
+    int FusedFeatureExtractor::getFirstTimeSlice(const TimeSliceGrid& grid, int block, int blockCount) const
+    {
+        if (block >= blockCount)
+            return grid.times.size();
+        float time = transformResult->getOriginalDuration() * block / blockCount;
+        return std::lower_bound(grid.times.begin(), grid.times.end(), time) - grid.times.begin();
+    }
+    
+    void FusedFeatureExtractor::extractTimeSlices(int fromBlock, int toBlock, int blockCount)
+    {
+        int binsPerOctave = transformResult->getBinsPerOctave();
+        int octaveCount = transformResult->getOctaveCount();
+        
+        //only the time slices of this range. neighbouring ranges may share columns, but not time slices.
+        TimeSliceGrid rangeGrids[3];
+        for (int g=0; g<3; g++)
+        {
+            int from = getFirstTimeSlice(grids[g], fromBlock, blockCount);
+            int to = getFirstTimeSlice(grids[g], toBlock, blockCount);
+            rangeGrids[g].times.assign(grids[g].times.begin() + from, grids[g].times.begin() + to);
+            rangeGrids[g].preDurations.assign(grids[g].preDurations.begin() + from, grids[g].preDurations.begin() + to);
+            rangeGrids[g].offset = from;
+        }
+        TimeSliceGrid& sumGrid = rangeGrids[0];
+        
+        //the sum only needs the means of one octave at a time.
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> sumMeans(binsPerOctave, sumGrid.times.size());
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>* means[] = {&sumMeans, &timbreMeans, &chromaMeans};
+        //sumMeans only holds the time slices of this range.
+        int firstColumn[] = {0, rangeGrids[1].offset, rangeGrids[2].offset};
+        
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> absValues(binsPerOctave);
+        for (int octave=0; octave<octaveCount; octave++)
+        {
+            const Eigen::Matrix<std::complex<kiss_fft_scalar>, Eigen::Dynamic, Eigen::Dynamic >* octaveMatrix = transformResult->getOctaveMatrix(octave);
+            
+            sumMeans.setZero();
+            int firstRow[] = {0, octave*binsPerOctave, octave*binsPerOctave};
+            //start with the first column one of the time slices needs.
+            int startCol = octaveMatrix->cols();
+            for (int g=0; g<3; g++)
+            {
+                initGrid(rangeGrids[g], octave);
+                if (rangeGrids[g].first < int(rangeGrids[g].times.size()))
+                    startCol = std::min(startCol, rangeGrids[g].prePos[rangeGrids[g].first]);
+            }
+            
+            //matricies are column-major, and the columns are in time order.
+            for (int col=std::max(startCol, 0); col<octaveMatrix->cols(); col++)
+            {
+                bool finished = true;
+                for (int g=0; g<3; g++)
+                    finished = finished && (rangeGrids[g].first == int(rangeGrids[g].times.size()));
+                if (finished)
+                    break;
+                
+                for (int bin=0; bin<binsPerOctave; bin++)
+                    absValues[bin] = std::abs((*octaveMatrix)(bin, col));
+                
+                for (int g=0; g<3; g++)
+                {
+                    TimeSliceGrid& grid = rangeGrids[g];
+                    Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& mean = *means[g];
+                    
+                    //start all time slices beginning in this column
+                    while ((grid.next < int(grid.times.size())) && (grid.prePos[grid.next] <= col))
+                        grid.next++;
+                    
+                    //add this column to all running time slices
+                    for (int i=grid.first; i<grid.next; i++)
+                    {
+                        for (int bin=0; bin<binsPerOctave; bin++)
+                            mean(firstRow[g] + bin, firstColumn[g] + i) += absValues[bin];
+                    }
+                    
+                    //finish all time slices ending in this column.
+                    //same operations as in ConstantQTransformResult::getNoteValueMean(), to get the same results.
+                    while ((grid.first < grid.next) && (grid.pos[grid.first] == col))
+                    {
+                        int i = grid.first;
+                        if (grid.pos[i] != grid.prePos[i])
+                        {
+                            for (int bin=0; bin<binsPerOctave; bin++)
+                                mean(firstRow[g] + bin, firstColumn[g] + i) /= grid.pos[i] - grid.prePos[i] + 1;
+                        }
+                        
+                        //the sum is built in the same order as in PerTimeSliceStatistics::calculateSum().
+                        if (&grid == &sumGrid)
+                        {
+                            for (int bin=0; bin<binsPerOctave; bin++)
+                                sums[sumGrid.offset + i] += mean(bin, i);
+                        }
+                        
+                        grid.first++;
+                    }
+                }
+            }
+        }
+    }
+    
+    bool FusedFeatureExtractor::calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, unsigned int timbreVectorSize) const
+    {
+        DataSet<kiss_fft_scalar> data;
+        bool retVal = calculateTimbreVectors(data, timbreVectorSize);
+        data.toVectors(timbreVectors);
+        return retVal;
+    }
+    
+    bool FusedFeatureExtractor::calculateTimbreVectors(DataSet<kiss_fft_scalar>& timbreVectors, unsigned int timbreVectorSize, unsigned int maxVectorCount) const
+    {
+        assert(timbreVectorSize > 1);
+        
+        TimbreEstimator tEst(transformResult, timbreVectorSize);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> timbreMatrix;
+        std::vector<bool> valid;
+        tEst.estimateTimbre(timbreMeans, timbreMatrix, valid);
+        
+        //only keep the valid ones
+        std::vector<int> validColumns;
+        for (int i=0; i<timbreMatrix.cols(); i++)
+        {
+            if (valid[i])
+                validColumns.push_back(i);
+        }
+        
+        //too many vectors: prefer the time slices where the spectrum changes.
+        std::vector<int> selected;
+        if ((maxVectorCount > 0) && (validColumns.size() > maxVectorCount))
+        {
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> validMeans(timbreMeans.rows(), validColumns.size());
+            for (unsigned int j=0; j<validColumns.size(); j++)
+                validMeans.col(j) = timbreMeans.col(validColumns[j]);
+            Eigen::Matrix<double, Eigen::Dynamic, 1> flux;
+            calculateSpectralFlux(validMeans, flux);
+            selectTimeSlices(flux, maxVectorCount, selected);
+        }
+        else
+        {
+            for (unsigned int j=0; j<validColumns.size(); j++)
+                selected.push_back(j);
+        }
+        
+        timbreVectors.resize(timbreVectorSize, selected.size());
+        for (unsigned int j=0; j<selected.size(); j++)
+            timbreVectors.col(j) = timbreMatrix.col(validColumns[selected[j]]);
+        return selected.size()>0;
+    }
+    
+    bool FusedFeatureExtractor::calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, bool makeTransposeInvariant, unsigned int threadCount) const
+    {
+        ChromaEstimator cEst(transformResult);
+        return cEst.estimateChroma(chromaMeans, chromaVectors, mode, chromaTimeSliceSize, makeTransposeInvariant, threadCount);
+    }
+}
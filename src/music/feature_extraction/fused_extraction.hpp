@@ -0,0 +1,183 @@
+#ifndef FUSED_EXTRACTION_HPP
+#define FUSED_EXTRACTION_HPP
+
+#include "constantq.hpp"
+#include "dataset.hpp"
+#include <Eigen/Dense>
+#include <vector>
+
+namespace music
+{
+    /**
+     * @brief This class calculates the data needed for all features of a
+     *      recording in one pass over a constant Q transform result.
+     * 
+     * Calculating dynamic range, tempo, timbre and chroma on their own
+     * reads the whole constant Q transform result several times, every
+     * time through ConstantQTransformResult::getNoteValueMean(). This class
+     * sweeps every octave matrix only once, in time order, and calculates
+     * the mean values of the time slices of all features at the same time.
+     * Every column of the transform result is read once, while it is in the cache.
+     * 
+     * The results are exactly the same as the ones of PerTimeSliceStatistics::calculateSum(),
+     * TimbreModel::calculateTimbreVectors() and ChromaEstimator::estimateChroma()
+     * with the same time slice sizes.
+     * 
+     * The sweep may be split across several threads by time: every thread
+     * sweeps the columns of a contiguous range of time slices. The results do
+     * not depend on the number of threads.
+     * 
+     * @code
+     * FusedFeatureExtractor extractor(transformResult, 0.01, 0.01, 0.05);
+     * extractor.extract();
+     * 
+     * PerTimeSliceStatistics<kiss_fft_scalar> perTimeSliceStatistics(transformResult, 0.01);
+     * perTimeSliceStatistics.setSumVector(extractor.getSumVector());
+     * 
+     * DataSet<kiss_fft_scalar> timbreVectors;
+     * extractor.calculateTimbreVectors(timbreVectors, 20);
+     * @endcode
+     * 
+     * @ingroup feature_extraction
+     */
+    class FusedFeatureExtractor
+    {
+    private:
+        //time slices of equal length, in time order.
+        struct TimeSliceGrid
+        {
+            //end and length of every time slice, as passed to getNoteValueMean().
+            std::vector<float> times;
+            std::vector<float> preDurations;
+            //columns of the active octave that belong to the time slices.
+            std::vector<int> prePos;
+            std::vector<int> pos;
+            //first slice that has not been finished and first slice that has not been started.
+            int first;
+            int next;
+            //index of the first time slice in the results, if the grid only holds some of the time slices.
+            int offset;
+        };
+        
+        ConstantQTransformResult* transformResult;
+        double sumTimeResolution;
+        double timbreTimeSliceSize;
+        double chromaTimeSliceSize;
+        
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> sumVector;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> timbreMeans;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> chromaMeans;
+        
+        //all time slices, set up by extract(). the sum, timbre and chroma grid, in this order.
+        TimeSliceGrid grids[3];
+        Eigen::Matrix<double, Eigen::Dynamic, 1> sums;
+        
+        void initGrid(TimeSliceGrid& grid, int octave);
+        //the first time slice of the grid that ends in the given block of time.
+        int getFirstTimeSlice(const TimeSliceGrid& grid, int block, int blockCount) const;
+        //sweeps the time slices that end in the blocks fromBlock to toBlock-1.
+        void extractTimeSlices(int fromBlock, int toBlock, int blockCount);
+        
+        friend class FusedExtractionJob;
+    protected:
+    
+    public:
+        /**
+         * @brief Creates a new FusedFeatureExtractor object.
+         * 
+         * @param transformResult A pointer to a ConstantQTransformResult,
+         *      which needs to be calculated first. May not be NULL.
+         * @param sumTimeResolution The time resolution of the sum vector in seconds,
+         *      as used for dynamic range and tempo estimation.
+         * @param timbreTimeSliceSize The time slice size in seconds that will be used to
+         *      create the timbre vectors.
+         * @param chromaTimeSliceSize The time slice size in seconds that will be used to
+         *      create the chroma vectors.
+         */
+        FusedFeatureExtractor(ConstantQTransformResult* transformResult, double sumTimeResolution=0.01, double timbreTimeSliceSize=0.01, double chromaTimeSliceSize=0.05);
+        
+        /**
+         * @brief Sweeps the transform result and calculates the sum vector,
+         *      as well as the mean values for timbre and chroma estimation.
+         * 
+         * You need to call this function before reading any results.
+         * 
+         * @param threadCount The number of threads the time slices will be split across.
+         */
+        void extract(unsigned int threadCount=1);
+        
+        /**
+         * @brief Returns the sum vector with the sums per time slice.
+         * 
+         * @see PerTimeSliceStatistics::setSumVector()
+         * 
+         * @return the sum vector with the sums per time slice.
+         */
+        const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>& getSumVector() const                       {return sumVector;}
+        /**
+         * @brief Returns the mean values of the bins for the timbre time slices.
+         * 
+         * Column <code>i</code> belongs to the time slice ending at
+         * <code>(i+1)*timbreTimeSliceSize</code>. The rows are ordered by octave first and bin second.
+         * 
+         * @see TimbreEstimator::estimateTimbre()
+         * 
+         * @return the mean values of the bins for the timbre time slices.
+         */
+        const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& getTimbreMeans() const       {return timbreMeans;}
+        /**
+         * @brief Returns the mean values of the bins for the chroma time slices.
+         * 
+         * Column <code>i</code> belongs to the time slice ending at
+         * <code>(i+1)*chromaTimeSliceSize</code>. The rows are ordered by octave first and bin second.
+         * 
+         * @see ChromaEstimator::estimateChroma()
+         * 
+         * @return the mean values of the bins for the chroma time slices.
+         */
+        const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& getChromaMeans() const       {return chromaMeans;}
+        
+        /**
+         * @brief Calculates the timbre vectors from the extracted mean values.
+         * 
+         * @param[in,out] timbreVectors A vector which will contain the timbre vectors. The new timbre vectors
+         *      will be appended.
+         * @param timbreVectorSize The dimensionality of the timbre vectors.
+         * 
+         * @return if calculating the timbre vectors was successful, or not.
+         * @see TimbreModel::calculateTimbreVectors()
+         */
+        bool calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, unsigned int timbreVectorSize=12) const;
+        /**
+         * @brief Calculates the timbre vectors from the extracted mean values.
+         * 
+         * @param[out] timbreVectors The timbre vectors, one per column. The old contents will be replaced.
+         * @param timbreVectorSize The dimensionality of the timbre vectors.
+         * @param maxVectorCount The maximum number of timbre vectors. If there
+         *      are more time slices, they will be chosen by their spectral flux,
+         *      such that stationary parts of the recording get less vectors.
+         *      <code>0</code> means that all timbre vectors will be used.
+         * 
+         * @return if calculating the timbre vectors was successful, or not.
+         * @see TimbreModel::calculateTimbreVectors()
+         * @see selectTimeSlices()
+         */
+        bool calculateTimbreVectors(DataSet<kiss_fft_scalar>& timbreVectors, unsigned int timbreVectorSize=12, unsigned int maxVectorCount=0) const;
+        
+        /**
+         * @brief Calculates the chroma vectors from the extracted mean values.
+         * 
+         * @param[out] chromaVectors A vector which will contain the chroma vectors.
+         * @param[out] mode The mode of the recording.
+         * @param makeTransposeInvariant If the chroma vectors should be shifted
+         *      to the mode of the recording.
+         * @param threadCount The number of threads the time slices will be split across.
+         * 
+         * @return if calculating the chroma vectors was successful, or not.
+         * @see ChromaEstimator::estimateChroma()
+         */
+        bool calculateChromaVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, int& mode, bool makeTransposeInvariant=true, unsigned int threadCount=1) const;
+    };
+}
+
+#endif  //FUSED_EXTRACTION_HPP
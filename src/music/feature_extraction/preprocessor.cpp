@@ -1,11 +1,15 @@
 #include "preprocessor.hpp"
 
 #include <musicaccess.hpp>
+#include <musicaccess/pcmcache.hpp>
 #include "feature_extraction_helper.hpp"
 #include "dynamic_range.hpp"
 #include "bpm.hpp"
 #include "chroma.hpp"
 #include "timbre.hpp"
+#include "fused_extraction.hpp"
+#include "adaptive_slicing.hpp"
+#include "feature_vector_store.hpp"
 
 #include "debug.hpp"
 
@@ -18,7 +22,14 @@ namespace music
         timbreTimeSliceSize(timbreTimeSliceSize),
         chromaTimeSliceSize(chromaTimeSliceSize),
         chromaModelSize(chromaModelSize),
-        chromaMakeTransposeInvariant(chromaMakeTransposeInvariant)
+        chromaMakeTransposeInvariant(chromaMakeTransposeInvariant),
+        previewLength(0.0),
+        previewExcerptCount(1),
+        trimSilence(false),
+        maxTimbreVectorCount(0),
+        pcmCache(NULL),
+        featureVectorStore(NULL),
+        threadCount(1)
     {
         assert(conn != NULL);
         
@@ -34,6 +45,40 @@ namespace music
             delete lowpassFilter;
     }
     
+    unsigned int readAnalysisWindow(musicaccess::SoundFile& file, float*& buffer, double previewLength, unsigned int previewExcerptCount, bool& preview)
+    {
+        if (previewExcerptCount == 0)
+            previewExcerptCount = 1;
+        
+        //length of one excerpt, counting the samples of all channels.
+        unsigned int excerptLength = (unsigned int)(previewLength * file.getSampleRate() / previewExcerptCount) * file.getChannelCount();
+        
+        preview = (previewLength > 0.0) && ((unsigned long)excerptLength * previewExcerptCount < file.getSampleCount());
+        if (preview)
+        {
+            DEBUG_OUT("will read " << previewExcerptCount << " excerpts of " << excerptLength << " samples.", 20);
+            buffer = new float[(unsigned long)excerptLength * previewExcerptCount];
+            return file.readExcerpts(buffer, excerptLength, previewExcerptCount);
+        }
+        else
+        {
+            DEBUG_OUT("will read " << file.getSampleCount() << " samples.", 20);
+            buffer = new float[file.getSampleCount()];
+            return file.readSamples(buffer, file.getSampleCount());
+        }
+    }
+    
+    void trimAnalysisWindow(const float* buffer, unsigned int sampleCount, unsigned int& firstSample, unsigned int& nonSilentSampleCount)
+    {
+        if (!findNonSilentRange(buffer, sampleCount, firstSample, nonSilentSampleCount) || (nonSilentSampleCount < 22050 * 10))
+        {
+            //silent or too short after trimming: analyze everything.
+            firstSample = 0;
+            nonSilentSampleCount = sampleCount;
+        }
+        DEBUG_OUT("trimmed " << sampleCount - nonSilentSampleCount << " samples of silence.", 10);
+    }
+    
     bool FilePreprocessor::preprocessFile(std::string filename, databaseentities::id_datatype& recordingID, ProgressCallbackCaller* callback)
     {
         try
@@ -54,11 +99,28 @@ namespace music
             databaseentities::RecordingFeatures* features = new databaseentities::RecordingFeatures();
             recording->setRecordingFeatures(features);
             
+            //the cache only holds whole files, previews are decoded every time.
+            std::string cacheKey;
+            musicaccess::PCMCacheEntry* cacheEntry = NULL;
+            if ((pcmCache != NULL) && !(previewLength > 0.0))
+            {
+                cacheKey = pcmCache->getKey(filename);
+                cacheEntry = pcmCache->load(cacheKey);
+                if ((cacheEntry != NULL) && (cacheEntry->getSampleRate() != 22050))
+                {
+                    delete cacheEntry;
+                    cacheEntry = NULL;
+                }
+            }
+            
             if (callback != NULL)
                 callback->progress(1.0/stepCount, "opening file...");
-            if (!file.open(filename))
+            //if the samples are cached, we only need the metadata.
+            //let the decoder do the downmixing and downsampling, if possible.
+            if (!((cacheEntry != NULL) ? file.readMetadata(filename) : file.open(filename, false, true)))
             {
                 DEBUG_OUT("opening file failed.", 10);
+                delete cacheEntry;
                 delete recording;
                 //delete features;  //will be done by the destructor of recording
                 
@@ -72,6 +134,7 @@ namespace music
             if (file.getSampleCount() < (unsigned int) file.getSampleRate() * 10)
             {
                 DEBUG_OUT("skipping file with less than 10 seconds of audio...", 10);
+                delete cacheEntry;
                 delete recording;
                 //delete features;  //will be done by the destructor of recording
                 
@@ -100,26 +163,57 @@ namespace music
             
             musicaccess::Resampler22kHzMono resampler;
             float* buffer = NULL;
-            DEBUG_OUT("will read " << file.getSampleCount() << " samples.", 10);
-            buffer = new float[file.getSampleCount()];
-            unsigned int sampleCount = file.readSamples(buffer, file.getSampleCount());
-            DEBUG_OUT("read " << sampleCount << " samples.", 10);
-            resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());
+            bool preview = false;
+            unsigned int sampleCount = 0;
+            if (cacheEntry != NULL)
+            {
+                buffer = cacheEntry->getSamples();
+                sampleCount = cacheEntry->getSampleCount();
+                DEBUG_OUT("read " << sampleCount << " samples from cache.", 10);
+            }
+            else
+            {
+                sampleCount = readAnalysisWindow(file, buffer, previewLength, previewExcerptCount, preview);
+                DEBUG_OUT("read " << sampleCount << " samples.", 10);
+                resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());
+                if ((pcmCache != NULL) && !preview)
+                    pcmCache->store(cacheKey, buffer, sampleCount, 22050);
+            }
+            features->setPreview(preview);
+            
+            //leading and trailing silence does not tell anything about the recording.
+            unsigned int firstSample = 0;
+            unsigned int nonSilentSampleCount = sampleCount;
+            if (trimSilence)
+                trimAnalysisWindow(buffer, sampleCount, firstSample, nonSilentSampleCount);
             
             if (callback != NULL)
                 callback->progress(4.0/stepCount, "calculating constant Q transform...");
             
-            music::ConstantQTransformResult* transformResult = cqt->apply(buffer, sampleCount);
-            //save length of file (in seconds)
-            features->setLength(transformResult->getOriginalDuration());
+            music::ConstantQTransformResult* transformResult = cqt->apply(buffer + firstSample, nonSilentSampleCount);
+            //save length of file (in seconds). previews only know the length from the file header.
+            //the trimmed silence is part of the recording.
+            if (preview)
+                features->setLength(double(file.getSampleCount()) / file.getChannelCount() / file.getSampleRate());
+            else
+                features->setLength(transformResult->getOriginalDuration() + double(sampleCount - nonSilentSampleCount) / 22050);
+            
+            if (callback != NULL)
+                callback->progress(5.0/stepCount, "extracting features from constant Q transform...");
+            
+            //read the transform result only once for all features.
+            music::FusedFeatureExtractor fusedExtractor(transformResult, 0.01, timbreTimeSliceSize, chromaTimeSliceSize);
+            fusedExtractor.extract(threadCount);
             
             if (callback != NULL)
-                callback->progress(5.0/stepCount, "calculating dynamic range...");
+                callback->progress(6.0/stepCount, "calculating dynamic range...");
             
             music::PerTimeSliceStatistics<kiss_fft_scalar>* perTimeSliceStatistics = new
                 music::PerTimeSliceStatistics<kiss_fft_scalar>(transformResult, 0.01);
+            perTimeSliceStatistics->setSumVector(fusedExtractor.getSumVector());
             music::DynamicRangeCalculator<kiss_fft_scalar> dynamicRangeCalculator(perTimeSliceStatistics);
-            dynamicRangeCalculator.calculateDynamicRange();
+            //the end of a preview window is not the end of the recording, so count everything.
+            dynamicRangeCalculator.calculateDynamicRange(preview ? 0.0 : 20.0);
             features->setDynamicRange(dynamicRangeCalculator.getLoudnessRMS());
             
             if (callback != NULL)
@@ -148,16 +242,21 @@ namespace music
                 callback->progress(10.0/stepCount, "calculating timbre model...");
             
             //extract timbre
+            music::DataSet<kiss_fft_scalar> timbreVectors;
+            fusedExtractor.calculateTimbreVectors(timbreVectors, timbreDimension, maxTimbreVectorCount);
             music::TimbreModel timbreModel(transformResult);
-            timbreModel.calculateModel(timbreModelSize, timbreTimeSliceSize, timbreDimension);
+            timbreModel.calculateModel(timbreVectors, timbreModelSize);
             features->setTimbreModel(timbreModel.getModel()->toJSONString());
             
             if (callback != NULL)
                 callback->progress(16.0/stepCount, "calculating chroma model...");
             
             //extract chroma
+            std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > chromaVectors;
+            int mode;
+            fusedExtractor.calculateChromaVectors(chromaVectors, mode, chromaMakeTransposeInvariant, threadCount);
             music::ChromaModel chromaModel(transformResult);
-            chromaModel.calculateModel(chromaModelSize, chromaTimeSliceSize, chromaMakeTransposeInvariant);
+            chromaModel.calculateModel(chromaVectors, chromaModelSize);
             features->setChromaModel(chromaModel.getModel()->toJSONString());
             
             if (callback != NULL)
@@ -169,19 +268,29 @@ namespace music
             {
                 delete recording;
                 delete transformResult;
-                delete[] buffer;
+                if (cacheEntry != NULL)
+                    delete cacheEntry;
+                else
+                    delete[] buffer;
                 conn->rollbackTransaction();
                 return false;
             }
             
             recordingID = recording->getID();
             
+            //keep the vectors, such that the models can be recalculated without analyzing the file again.
+            if (featureVectorStore != NULL)
+                featureVectorStore->store(recordingID, timbreVectors, music::DataSet<kiss_fft_scalar>(chromaVectors));
+            
             if (callback != NULL)
                 callback->progress(1.0, "finished.");
             
             delete recording;
             delete transformResult;
-            delete[] buffer;
+            if (cacheEntry != NULL)
+                delete cacheEntry;
+            else
+                delete[] buffer;
             
             conn->endTransaction();
             return true;
@@ -194,6 +303,72 @@ namespace music
         }
     }
     
+    bool FilePreprocessor::remodelRecording(databaseentities::id_datatype recordingID, ProgressCallbackCaller* callback)
+    {
+        if (featureVectorStore == NULL)
+            return false;
+        
+        if (callback != NULL)
+            callback->progress(0.0, "loading feature vectors...");
+        
+        music::DataSet<kiss_fft_scalar> timbreVectors;
+        music::DataSet<kiss_fft_scalar> chromaVectors;
+        if (!featureVectorStore->load(recordingID, timbreVectors, chromaVectors))
+        {
+            DEBUG_OUT("no feature vectors stored for recording " << recordingID, 10);
+            return false;
+        }
+        
+        //the first coefficients of the dct do not depend on how many of them have been calculated.
+        if (timbreVectors.getDimension() < int(timbreDimension))
+        {
+            DEBUG_OUT("stored timbre vectors of recording " << recordingID << " have dimension " << timbreVectors.getDimension() << ", need " << timbreDimension, 10);
+            return false;
+        }
+        else if (timbreVectors.getDimension() > int(timbreDimension))
+        {
+            music::DataSet<kiss_fft_scalar> truncatedVectors(timbreVectors.topRows(timbreDimension));
+            timbreVectors = truncatedVectors;
+        }
+        
+        databaseentities::Recording recording;
+        recording.setID(recordingID);
+        if (!conn->getRecordingByID(recording, true) || (recording.getRecordingFeatures() == NULL))
+            return false;
+        databaseentities::RecordingFeatures* features = recording.getRecordingFeatures();
+        
+        if (callback != NULL)
+            callback->progress(0.1, "calculating timbre model...");
+        
+        music::TimbreModel timbreModel(NULL);
+        if (!timbreModel.calculateModel(timbreVectors, timbreModelSize))
+            return false;
+        features->setTimbreModel(timbreModel.getModel()->toJSONString());
+        
+        if (callback != NULL)
+            callback->progress(0.6, "calculating chroma model...");
+        
+        music::ChromaModel chromaModel;
+        if (!chromaModel.calculateModel(chromaVectors, chromaModelSize))
+            return false;
+        features->setChromaModel(chromaModel.getModel()->toJSONString());
+        
+        if (callback != NULL)
+            callback->progress(0.9, "saving models to db...");
+        
+        conn->beginTransaction();
+        if (!conn->updateRecordingFeaturesByID(*features))
+        {
+            conn->rollbackTransaction();
+            return false;
+        }
+        conn->endTransaction();
+        
+        if (callback != NULL)
+            callback->progress(1.0, "finished.");
+        return true;
+    }
+    
     MultithreadedFilePreprocessor::MultithreadedFilePreprocessor(DatabaseConnection* conn, unsigned int timbreModelSize, unsigned int timbreDimension, double timbreTimeSliceSize, unsigned int chromaModelSize, double chromaTimeSliceSize, bool chromaMakeTransposeInvariant) :
         conn(conn),
         timbreModelSize(timbreModelSize),
@@ -202,6 +377,12 @@ namespace music
         chromaTimeSliceSize(chromaTimeSliceSize),
         chromaModelSize(chromaModelSize),
         chromaMakeTransposeInvariant(chromaMakeTransposeInvariant),
+        previewLength(0.0),
+        previewExcerptCount(1),
+        trimSilence(false),
+        maxTimbreVectorCount(0),
+        pcmCache(NULL),
+        featureVectorStore(NULL),
         _recordingQueue(1000)
     {
         
@@ -228,7 +409,9 @@ namespace music
         {
             FilePreprocessorThread* thread = new FilePreprocessorThread(this, jobQueue,
                 timbreModelSize, timbreDimension, timbreTimeSliceSize,
-                chromaModelSize, chromaTimeSliceSize, chromaMakeTransposeInvariant);
+                chromaModelSize, chromaTimeSliceSize, chromaMakeTransposeInvariant,
+                previewLength, previewExcerptCount, pcmCache,
+                trimSilence, maxTimbreVectorCount, featureVectorStore);
             _threadList.push_back(thread);
             thread->start();
         }
@@ -244,16 +427,12 @@ namespace music
             if (callback)
                 callback->progress(double(i)/double(files.size()+2), std::string("processing file ") + *it);
             
-            databaseentities::Recording* recording = NULL;
+            PreprocessedRecording preprocessedRecording;
             //read recordings from the worker threads and save them to the database
             //perform non-blocking read. as long as there are recordings, save them.
             //this approach is needed as only the creator thread may write to the database.
-            while(_recordingQueue.dequeue(recording, false))
-            {
-                conn->addRecording(*recording);
-                recordingIDQueue->enqueue(recording->getID());
-                delete recording;
-            }
+            while(_recordingQueue.dequeue(preprocessedRecording, false))
+                saveRecording(preprocessedRecording, recordingIDQueue);
         }
         jobQueue.destroyQueue();
         
@@ -268,26 +447,18 @@ namespace music
             //since every thread will produce an output, we need to
             //put every result to the database to not get a deadlock here
             //(the _recordingQueue might get full otherwise)
-            databaseentities::Recording* recording = NULL;
-            while(_recordingQueue.dequeue(recording, false))
-            {
-                conn->addRecording(*recording);
-                recordingIDQueue->enqueue(recording->getID());
-                delete recording;
-            }
+            PreprocessedRecording preprocessedRecording;
+            while(_recordingQueue.dequeue(preprocessedRecording, false))
+                saveRecording(preprocessedRecording, recordingIDQueue);
         }
         _recordingQueue.destroyQueue();
         
         //now empty the queue with blocking reads. there should not be
         //anything in the queue, but this way we are 100% sure.
         //the last read will not block due to the queue being destroyed.
-        databaseentities::Recording* recording = NULL;
-        while(_recordingQueue.dequeue(recording, true))
-        {
-            conn->addRecording(*recording);
-            recordingIDQueue->enqueue(recording->getID());
-            delete recording;
-        }
+        PreprocessedRecording preprocessedRecording;
+        while(_recordingQueue.dequeue(preprocessedRecording, true))
+            saveRecording(preprocessedRecording, recordingIDQueue);
         
         recordingIDQueue->destroyQueue();
         
@@ -297,14 +468,36 @@ namespace music
         return recordingIDQueue;
     }
     
-    void MultithreadedFilePreprocessor::addRecording(databaseentities::Recording* recording)
+    void MultithreadedFilePreprocessor::addRecording(databaseentities::Recording* recording, DataSet<kiss_fft_scalar>* timbreVectors, DataSet<kiss_fft_scalar>* chromaVectors)
     {
+        PreprocessedRecording preprocessedRecording;
+        preprocessedRecording.recording = recording;
+        preprocessedRecording.timbreVectors = timbreVectors;
+        preprocessedRecording.chromaVectors = chromaVectors;
         //mutexes etc are handled by the queue.
-        _recordingQueue.enqueue(recording);
+        _recordingQueue.enqueue(preprocessedRecording);
+    }
+    
+    void MultithreadedFilePreprocessor::saveRecording(PreprocessedRecording& preprocessedRecording, BlockingQueue<databaseentities::id_datatype>* recordingIDQueue)
+    {
+        databaseentities::Recording* recording = preprocessedRecording.recording;
+        if (conn->addRecording(*recording))
+        {
+            //the ID of the recording is known only now.
+            if ((featureVectorStore != NULL) && (preprocessedRecording.timbreVectors != NULL) && (preprocessedRecording.chromaVectors != NULL))
+                featureVectorStore->store(recording->getID(), *preprocessedRecording.timbreVectors, *preprocessedRecording.chromaVectors);
+        }
+        recordingIDQueue->enqueue(recording->getID());
+        
+        delete recording;
+        if (preprocessedRecording.timbreVectors != NULL)
+            delete preprocessedRecording.timbreVectors;
+        if (preprocessedRecording.chromaVectors != NULL)
+            delete preprocessedRecording.chromaVectors;
     }
     
     FilePreprocessorThread::FilePreprocessorThread(MultithreadedFilePreprocessor* processor,
-        BlockingQueue<std::string>& jobQueue, unsigned int timbreModelSize, unsigned int timbreDimension, double timbreTimeSliceSize, unsigned int chromaModelSize, double chromaTimeSliceSize, bool chromaMakeTransposeInvariant) :
+        BlockingQueue<std::string>& jobQueue, unsigned int timbreModelSize, unsigned int timbreDimension, double timbreTimeSliceSize, unsigned int chromaModelSize, double chromaTimeSliceSize, bool chromaMakeTransposeInvariant, double previewLength, unsigned int previewExcerptCount, musicaccess::PCMCache* pcmCache, bool trimSilence, unsigned int maxTimbreVectorCount, FeatureVectorStore* featureVectorStore) :
           _processor(processor),
           _jobQueue(jobQueue),
           lowpassFilter(NULL), cqt(NULL),
@@ -313,7 +506,13 @@ namespace music
           timbreTimeSliceSize(timbreTimeSliceSize),
           chromaTimeSliceSize(chromaTimeSliceSize),
           chromaModelSize(chromaModelSize),
-          chromaMakeTransposeInvariant(chromaMakeTransposeInvariant)
+          chromaMakeTransposeInvariant(chromaMakeTransposeInvariant),
+          previewLength(previewLength),
+          previewExcerptCount(previewExcerptCount),
+          trimSilence(trimSilence),
+          maxTimbreVectorCount(maxTimbreVectorCount),
+          pcmCache(pcmCache),
+          featureVectorStore(featureVectorStore)
     {
         lowpassFilter = musicaccess::IIRFilter::createLowpassFilter(0.25);
         
@@ -333,11 +532,28 @@ namespace music
                 databaseentities::RecordingFeatures* features = new databaseentities::RecordingFeatures();
                 recording->setRecordingFeatures(features);
                 
+                //the cache only holds whole files, previews are decoded every time.
+                std::string cacheKey;
+                musicaccess::PCMCacheEntry* cacheEntry = NULL;
+                if ((pcmCache != NULL) && !(previewLength > 0.0))
+                {
+                    cacheKey = pcmCache->getKey(filename);
+                    cacheEntry = pcmCache->load(cacheKey);
+                    if ((cacheEntry != NULL) && (cacheEntry->getSampleRate() != 22050))
+                    {
+                        delete cacheEntry;
+                        cacheEntry = NULL;
+                    }
+                }
+                
                 DEBUG_OUT("opening file..." << filename, 30);
                 
-                if (!file.open(filename))
+                //if the samples are cached, we only need the metadata.
+                //let the decoder do the downmixing and downsampling, if possible.
+                if (!((cacheEntry != NULL) ? file.readMetadata(filename) : file.open(filename, false, true)))
                 {
                     DEBUG_OUT("opening file failed: " << filename, 10);
+                    delete cacheEntry;
                     delete recording;
                     //delete features;  //will be done by the destructor of recording
                     
@@ -347,6 +563,7 @@ namespace music
                 if (file.getSampleCount() < (unsigned int)file.getSampleRate() * 10)
                 {
                     DEBUG_OUT("skipping file with less than 10 seconds of audio...", 10);
+                    delete cacheEntry;
                     delete recording;
                     //delete features;  //will be done by the destructor of recording
                     
@@ -366,55 +583,84 @@ namespace music
                 
                 musicaccess::Resampler22kHzMono resampler;
                 float* buffer = NULL;
-                DEBUG_OUT("will read " << file.getSampleCount() << " samples.", 20);
-                try{buffer = new float[file.getSampleCount()];}
-                catch (std::bad_alloc& ex)
-                {
-                    std::cerr << "skipping file due to low memory: " << filename << std::endl;
-                    continue;
-                }
+                bool preview = false;
                 unsigned int sampleCount = 0;
-                try{sampleCount = file.readSamples(buffer, file.getSampleCount());}
-                catch (std::bad_alloc& ex)
+                if (cacheEntry != NULL)
                 {
-                    delete[] buffer;
-                    std::cerr << "skipping file due to low memory: " << filename << std::endl;
-                    continue;
+                    buffer = cacheEntry->getSamples();
+                    sampleCount = cacheEntry->getSampleCount();
+                    DEBUG_OUT("read " << sampleCount << " samples from cache.", 20);
                 }
-                DEBUG_OUT("read " << sampleCount << " samples.", 20);
-                try{resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());}
-                catch (std::bad_alloc& ex)
+                else
                 {
-                    delete[] buffer;
-                    std::cerr << "skipping file due to low memory: " << filename << std::endl;
-                    continue;
+                    try{sampleCount = readAnalysisWindow(file, buffer, previewLength, previewExcerptCount, preview);}
+                    catch (std::bad_alloc& ex)
+                    {
+                        delete[] buffer;
+                        std::cerr << "skipping file due to low memory: " << filename << std::endl;
+                        continue;
+                    }
+                    DEBUG_OUT("read " << sampleCount << " samples.", 20);
+                    try{resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());}
+                    catch (std::bad_alloc& ex)
+                    {
+                        delete[] buffer;
+                        std::cerr << "skipping file due to low memory: " << filename << std::endl;
+                        continue;
+                    }
+                    if ((pcmCache != NULL) && !preview)
+                        pcmCache->store(cacheKey, buffer, sampleCount, 22050);
                 }
+                features->setPreview(preview);
+                
+                //leading and trailing silence does not tell anything about the recording.
+                unsigned int firstSample = 0;
+                unsigned int nonSilentSampleCount = sampleCount;
+                if (trimSilence)
+                    trimAnalysisWindow(buffer, sampleCount, firstSample, nonSilentSampleCount);
                 
                 DEBUG_OUT("file resampled, applying CQT...", 30);
                 
                 music::ConstantQTransformResult* transformResult = NULL;
-                try {transformResult = cqt->apply(buffer, sampleCount);}
+                try {transformResult = cqt->apply(buffer + firstSample, nonSilentSampleCount);}
                 catch (std::bad_alloc& ex)
                 {
-                    delete[] buffer;
+                    if (cacheEntry != NULL)
+                        delete cacheEntry;
+                    else
+                        delete[] buffer;
                     std::cerr << "skipping file due to low memory: " << filename << std::endl;
                     continue;
                 }
-                delete[] buffer;
+                if (cacheEntry != NULL)
+                    delete cacheEntry;
+                else
+                    delete[] buffer;
                 if (!transformResult)
                 {
                     std::cerr << "skipping file due to low memory: " << filename << std::endl;
                     continue;
                 }
                 
-                //save length of file (in seconds)
-                features->setLength(transformResult->getOriginalDuration());
+                //save length of file (in seconds). previews only know the length from the file header.
+                //the trimmed silence is part of the recording.
+                if (preview)
+                    features->setLength(double(file.getSampleCount()) / file.getChannelCount() / file.getSampleRate());
+                else
+                    features->setLength(transformResult->getOriginalDuration() + double(sampleCount - nonSilentSampleCount) / 22050);
+                
+                DEBUG_OUT("extract features from constant Q transform...", 30);
+                //read the transform result only once for all features.
+                music::FusedFeatureExtractor fusedExtractor(transformResult, 0.01, timbreTimeSliceSize, chromaTimeSliceSize);
+                fusedExtractor.extract();
                 
                 DEBUG_OUT("calculate dynamic range...", 30);
                 music::PerTimeSliceStatistics<kiss_fft_scalar>* perTimeSliceStatistics = new
                     music::PerTimeSliceStatistics<kiss_fft_scalar>(transformResult, 0.01);
+                perTimeSliceStatistics->setSumVector(fusedExtractor.getSumVector());
                 music::DynamicRangeCalculator<kiss_fft_scalar> dynamicRangeCalculator(perTimeSliceStatistics);
-                dynamicRangeCalculator.calculateDynamicRange();
+                //the end of a preview window is not the end of the recording, so count everything.
+                dynamicRangeCalculator.calculateDynamicRange(preview ? 0.0 : 20.0);
                 features->setDynamicRange(dynamicRangeCalculator.getLoudnessRMS());
                 
                 DEBUG_OUT("calculate tempo...", 30);
@@ -432,20 +678,33 @@ namespace music
                 
                 DEBUG_OUT("extract timbre...", 30);
                 //extract timbre
+                music::DataSet<kiss_fft_scalar> timbreVectors;
+                fusedExtractor.calculateTimbreVectors(timbreVectors, timbreDimension, maxTimbreVectorCount);
                 music::TimbreModel timbreModel(transformResult);
-                timbreModel.calculateModel(timbreModelSize, timbreTimeSliceSize, timbreDimension);
+                timbreModel.calculateModel(timbreVectors, timbreModelSize);
                 features->setTimbreModel(timbreModel.getModel()->toJSONString());
                 
                 DEBUG_OUT("extract chroma...", 30);
                 //extract chroma
+                std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > chromaVectors;
+                int mode;
+                fusedExtractor.calculateChromaVectors(chromaVectors, mode, chromaMakeTransposeInvariant);
                 music::ChromaModel chromaModel(transformResult);
-                chromaModel.calculateModel(chromaModelSize, chromaTimeSliceSize, chromaMakeTransposeInvariant);
+                chromaModel.calculateModel(chromaVectors, chromaModelSize);
                 features->setChromaModel(chromaModel.getModel()->toJSONString());
                 
                 DEBUG_OUT("saving file...", 30);
+                //the vectors can only be stored when the recording has its ID.
+                music::DataSet<kiss_fft_scalar>* storedTimbreVectors = NULL;
+                music::DataSet<kiss_fft_scalar>* storedChromaVectors = NULL;
+                if (featureVectorStore != NULL)
+                {
+                    storedTimbreVectors = new music::DataSet<kiss_fft_scalar>(timbreVectors);
+                    storedChromaVectors = new music::DataSet<kiss_fft_scalar>(chromaVectors);
+                }
                 //this adds the recording, as well as its features, to the database.
-                //the pointer will be deleted by the other thread
-                _processor->addRecording(recording);
+                //the pointers will be deleted by the other thread
+                _processor->addRecording(recording, storedTimbreVectors, storedChromaVectors);
                 
                 delete transformResult;
             }
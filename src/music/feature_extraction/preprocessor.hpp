@@ -5,11 +5,20 @@
 #include "databaseconnection.hpp"
 #include "progress_callback.hpp"
 #include "constantq.hpp"
+#include "dataset.hpp"
 
 #include "pthread.hpp"
 
+namespace musicaccess
+{
+    class SoundFile;
+    class PCMCache;
+}
+
 namespace music
 {
+    class FeatureVectorStore;
+    
     /**
      * @brief This class preprocesses files, extracts their features and
      *      adds them to the database.
@@ -71,6 +80,17 @@ namespace music
         double chromaTimeSliceSize;
         unsigned int chromaModelSize;
         bool chromaMakeTransposeInvariant;
+        
+        double previewLength;
+        unsigned int previewExcerptCount;
+        
+        bool trimSilence;
+        unsigned int maxTimbreVectorCount;
+        
+        musicaccess::PCMCache* pcmCache;
+        FeatureVectorStore* featureVectorStore;
+        
+        unsigned int threadCount;
     public:
         /**
          * @brief Constructs a new FilePreprocessor object.
@@ -104,6 +124,10 @@ namespace music
          * See the documentation of <code>libmusicaccess</code> for a list of
          * supported audio codecs.
          * 
+         * If a preview length has been set via setPreviewLength(), only
+         * some excerpts of the file will be decoded and analyzed. The features
+         * will then be marked as preview-quality in the database.
+         * 
          * @return <code>true</code> if the operation succeeded,
          *      <code>false</code> otherwise
          */
@@ -193,8 +217,206 @@ namespace music
          * @return the model size for the timbre vector model.
          */
         unsigned int getTimbreModelSize()                 {return timbreModelSize;}
+        
+        /**
+         * @brief Sets the length of the analysis window for preview analysis.
+         * 
+         * If this value is greater than zero, only <code>previewLength</code>
+         * seconds of every file will be decoded and analyzed. This is a lot
+         * faster than analyzing the whole file. The features will be marked
+         * as preview-quality in the database, such that they can be
+         * replaced by a full analysis later on.
+         * 
+         * Typical values are in the range of <code>20-60</code>. Set to
+         * <code>0.0</code> to analyze the whole file (the default).
+         * 
+         * @see setPreviewExcerptCount()
+         * @see DatabaseConnection::getPreviewRecordingIDs()
+         */
+        void setPreviewLength(double previewLength)       {this->previewLength = previewLength;}
+        /**
+         * @brief Returns the length of the analysis window for preview analysis.
+         * @return the length of the analysis window for preview analysis,
+         *      or <code>0.0</code> if whole files will be analyzed.
+         */
+        double getPreviewLength()                         {return previewLength;}
+        
+        /**
+         * @brief Sets the number of excerpts the analysis window will be
+         *      divided into.
+         * 
+         * The excerpts are evenly spaced over the file. Choose <code>1</code>
+         * to take the analysis window from the middle of the file.
+         * This value is only used if a preview length has been set.
+         */
+        void setPreviewExcerptCount(unsigned int count)   {this->previewExcerptCount = count;}
+        /**
+         * @brief Returns the number of excerpts the analysis window will be
+         *      divided into.
+         * @return the number of excerpts the analysis window will be divided into.
+         */
+        unsigned int getPreviewExcerptCount()             {return previewExcerptCount;}
+        
+        /**
+         * @brief Sets if leading and trailing silence will be removed before analysis.
+         * 
+         * Silent intros and outros do not tell anything about a recording,
+         * but cost time in every step of the analysis. The length of the
+         * recording saved in the database still includes the silence.
+         * Recordings will only be trimmed if at least 10 seconds remain.
+         * 
+         * The default is <code>false</code>, such that the features of new
+         * recordings can be compared to the ones already in the database.
+         * 
+         * @see findNonSilentRange()
+         */
+        void setTrimSilence(bool trimSilence)             {this->trimSilence = trimSilence;}
+        /**
+         * @brief Returns if leading and trailing silence will be removed before analysis.
+         * @return if leading and trailing silence will be removed before analysis.
+         */
+        bool getTrimSilence()                             {return trimSilence;}
+        
+        /**
+         * @brief Sets the maximum number of timbre vectors per recording
+         *      the timbre model will be trained with.
+         * 
+         * The time needed to train the timbre model grows linearly with the
+         * number of timbre vectors. If a recording has more time slices,
+         * the time slices will be chosen by their spectral flux:
+         * stationary parts of the recording, like long notes or repeated loops,
+         * get less timbre vectors than parts where the sound changes.
+         * 
+         * Set to <code>0</code> to use all timbre vectors (the default).
+         * 
+         * @see FusedFeatureExtractor::calculateTimbreVectors()
+         */
+        void setMaxTimbreVectorCount(unsigned int count)  {this->maxTimbreVectorCount = count;}
+        /**
+         * @brief Returns the maximum number of timbre vectors per recording.
+         * @return the maximum number of timbre vectors per recording,
+         *      or <code>0</code> if all timbre vectors will be used.
+         */
+        unsigned int getMaxTimbreVectorCount()            {return maxTimbreVectorCount;}
+        
+        /**
+         * @brief Sets the cache for decoded and resampled audio data.
+         * 
+         * If a cache is set, files that have already been decoded once
+         * will be read from the cache instead of being decoded and resampled
+         * again. Files that are not in the cache yet will be added after
+         * decoding. Preview analysis does not use the cache.
+         * 
+         * The cache will not be deleted by this object. Set to <code>NULL</code>
+         * to disable caching (the default).
+         * 
+         * @see musicaccess::PCMCache
+         */
+        void setPCMCache(musicaccess::PCMCache* pcmCache) {this->pcmCache = pcmCache;}
+        /**
+         * @brief Returns the cache for decoded and resampled audio data.
+         * @return the cache for decoded and resampled audio data, or <code>NULL</code>
+         *      if no cache is used.
+         */
+        musicaccess::PCMCache* getPCMCache()              {return pcmCache;}
+        
+        /**
+         * @brief Sets the store the timbre and chroma vectors of new recordings will be saved in.
+         * 
+         * If a store is set, the timbre and chroma vectors of every recording
+         * added by preprocessFile() will be saved, such that the models
+         * can be recalculated with remodelRecording() later.
+         * 
+         * The store will not be deleted by this object. Set to <code>NULL</code>
+         * to disable saving the vectors (the default).
+         * 
+         * @see FeatureVectorStore
+         */
+        void setFeatureVectorStore(FeatureVectorStore* store)     {this->featureVectorStore = store;}
+        /**
+         * @brief Returns the store the timbre and chroma vectors of new recordings will be saved in.
+         * @return the store the timbre and chroma vectors of new recordings will be saved in,
+         *      or <code>NULL</code> if the vectors will not be saved.
+         */
+        FeatureVectorStore* getFeatureVectorStore()               {return featureVectorStore;}
+        
+        /**
+         * @brief Sets the number of threads the feature extraction of one file will be split across.
+         * 
+         * This lowers the time needed to process a single file. If you process
+         * a lot of files, MultithreadedFilePreprocessor will use the processor cores better.
+         * The features do not depend on the number of threads. The default is <code>1</code>.
+         * 
+         * @see FusedFeatureExtractor::extract()
+         */
+        void setThreadCount(unsigned int threadCount)     {this->threadCount = threadCount;}
+        /**
+         * @brief Returns the number of threads the feature extraction of one file will be split across.
+         * @return the number of threads the feature extraction of one file will be split across.
+         */
+        unsigned int getThreadCount()                     {return threadCount;}
+        
+        /**
+         * @brief Recalculates the timbre and chroma models of a recording
+         *      from its stored feature vectors.
+         * 
+         * The models will be trained with the current model sizes of this object,
+         * without decoding or transforming the file again. All other features
+         * of the recording stay as they are.
+         * 
+         * The stored timbre vectors may be cut to a smaller timbre dimension, since
+         * the first coefficients of the DCT do not depend on the number of coefficients.
+         * A larger timbre dimension, other time slice sizes or other chroma settings
+         * need a new analysis of the file.
+         * 
+         * @param recordingID The ID of the recording.
+         * @param callback The progress callback. May be <code>NULL</code>.
+         * 
+         * @return <code>true</code> if the operation succeeded, <code>false</code>
+         *      if no store is set, the vectors of the recording are not in the store,
+         *      or the models could not be saved.
+         * @see setFeatureVectorStore()
+         */
+        bool remodelRecording(databaseentities::id_datatype recordingID, ProgressCallbackCaller* callback = NULL);
     };
     
+    /**
+     * @brief Reads the samples of an opened file that should be analyzed.
+     * 
+     * Reads the whole file if <code>previewLength</code> is not greater than zero,
+     * and <code>previewExcerptCount</code> evenly spaced excerpts
+     * with a total length of <code>previewLength</code> seconds otherwise.
+     * 
+     * @param file The opened file.
+     * @param[out] buffer The buffer the samples will be written to. Will be allocated
+     *      by this function, you need to <code>delete[]</code> it yourself.
+     * @param previewLength The length of the analysis window in seconds.
+     * @param previewExcerptCount The number of excerpts the analysis window will be
+     *      divided into.
+     * @param[out] preview Will be set to <code>true</code> if only a part of the file
+     *      has been read.
+     * @return the sample count that actually was read
+     * 
+     * @ingroup feature_extraction
+     */
+    unsigned int readAnalysisWindow(musicaccess::SoundFile& file, float*& buffer, double previewLength, unsigned int previewExcerptCount, bool& preview);
+    
+    /**
+     * @brief Finds the part of the analysis window without leading and trailing silence.
+     * 
+     * Falls back to the whole analysis window if it is completely silent,
+     * or if less than 10 seconds would remain.
+     * 
+     * @param buffer The samples of the analysis window, at 22050Hz.
+     * @param sampleCount The number of samples in <code>buffer</code>.
+     * @param[out] firstSample The first sample that should be analyzed.
+     * @param[out] nonSilentSampleCount The number of samples that should be analyzed.
+     * 
+     * @see findNonSilentRange()
+     * @ingroup feature_extraction
+     */
+    void trimAnalysisWindow(const float* buffer, unsigned int sampleCount, unsigned int& firstSample, unsigned int& nonSilentSampleCount);
+    
     class FilePreprocessorThread;
     
     class MultithreadedFilePreprocessor
@@ -209,11 +431,32 @@ namespace music
         unsigned int chromaModelSize;
         bool chromaMakeTransposeInvariant;
         
-        BlockingQueue<databaseentities::Recording*> _recordingQueue;
+        double previewLength;
+        unsigned int previewExcerptCount;
+        
+        bool trimSilence;
+        unsigned int maxTimbreVectorCount;
+        
+        musicaccess::PCMCache* pcmCache;
+        FeatureVectorStore* featureVectorStore;
+        
+        //a recording, together with the feature vectors its models have been trained with.
+        struct PreprocessedRecording
+        {
+            databaseentities::Recording* recording;
+            DataSet<kiss_fft_scalar>* timbreVectors;
+            DataSet<kiss_fft_scalar>* chromaVectors;
+        };
+        
+        BlockingQueue<PreprocessedRecording> _recordingQueue;
         std::vector<FilePreprocessorThread*> _threadList;
         
         //adds a recording to the database (with features), blocks until done.
-        void addRecording(databaseentities::Recording* recording);
+        //takes ownership of all pointers. the vectors may be NULL.
+        void addRecording(databaseentities::Recording* recording, DataSet<kiss_fft_scalar>* timbreVectors = NULL, DataSet<kiss_fft_scalar>* chromaVectors = NULL);
+        //saves a recording from the queue to the database and the feature vector store,
+        //and deletes it. may only be called by the creator thread.
+        void saveRecording(PreprocessedRecording& preprocessedRecording, BlockingQueue<databaseentities::id_datatype>* recordingIDQueue);
     public:
         /**
          * @brief Constructs a new MultithreadedFilePreprocessor object.
@@ -231,6 +474,55 @@ namespace music
         
         BlockingQueue<databaseentities::id_datatype>* preprocessFiles(const std::vector<std::string>& files, unsigned int threadCount = 2, ProgressCallbackCaller* callback = NULL);
         
+        /**
+         * @copydoc FilePreprocessor::setPreviewLength()
+         */
+        void setPreviewLength(double previewLength)       {this->previewLength = previewLength;}
+        /**
+         * @copydoc FilePreprocessor::getPreviewLength()
+         */
+        double getPreviewLength()                         {return previewLength;}
+        /**
+         * @copydoc FilePreprocessor::setPreviewExcerptCount()
+         */
+        void setPreviewExcerptCount(unsigned int count)   {this->previewExcerptCount = count;}
+        /**
+         * @copydoc FilePreprocessor::getPreviewExcerptCount()
+         */
+        unsigned int getPreviewExcerptCount()             {return previewExcerptCount;}
+        /**
+         * @copydoc FilePreprocessor::setTrimSilence()
+         */
+        void setTrimSilence(bool trimSilence)             {this->trimSilence = trimSilence;}
+        /**
+         * @copydoc FilePreprocessor::getTrimSilence()
+         */
+        bool getTrimSilence()                             {return trimSilence;}
+        /**
+         * @copydoc FilePreprocessor::setMaxTimbreVectorCount()
+         */
+        void setMaxTimbreVectorCount(unsigned int count)  {this->maxTimbreVectorCount = count;}
+        /**
+         * @copydoc FilePreprocessor::getMaxTimbreVectorCount()
+         */
+        unsigned int getMaxTimbreVectorCount()            {return maxTimbreVectorCount;}
+        /**
+         * @copydoc FilePreprocessor::setPCMCache()
+         */
+        void setPCMCache(musicaccess::PCMCache* pcmCache) {this->pcmCache = pcmCache;}
+        /**
+         * @copydoc FilePreprocessor::getPCMCache()
+         */
+        musicaccess::PCMCache* getPCMCache()              {return pcmCache;}
+        /**
+         * @copydoc FilePreprocessor::setFeatureVectorStore()
+         */
+        void setFeatureVectorStore(FeatureVectorStore* store)     {this->featureVectorStore = store;}
+        /**
+         * @copydoc FilePreprocessor::getFeatureVectorStore()
+         */
+        FeatureVectorStore* getFeatureVectorStore()               {return featureVectorStore;}
+        
         friend class FilePreprocessorThread;
     };
     
@@ -249,11 +541,20 @@ namespace music
         double chromaTimeSliceSize;
         unsigned int chromaModelSize;
         bool chromaMakeTransposeInvariant;
+        
+        double previewLength;
+        unsigned int previewExcerptCount;
+        
+        bool trimSilence;
+        unsigned int maxTimbreVectorCount;
+        
+        musicaccess::PCMCache* pcmCache;
+        FeatureVectorStore* featureVectorStore;
     protected:
         
     public:
         FilePreprocessorThread(MultithreadedFilePreprocessor* processor,
-            BlockingQueue<std::string>& jobQueue, unsigned int timbreModelSize = 20, unsigned int timbreDimension = 20, double timbreTimeSliceSize = 0.01, unsigned int chromaModelSize = 8, double chromaTimeSliceSize = 0.05, bool chromaMakeTransposeInvariant = true);
+            BlockingQueue<std::string>& jobQueue, unsigned int timbreModelSize = 20, unsigned int timbreDimension = 20, double timbreTimeSliceSize = 0.01, unsigned int chromaModelSize = 8, double chromaTimeSliceSize = 0.05, bool chromaMakeTransposeInvariant = true, double previewLength = 0.0, unsigned int previewExcerptCount = 1, musicaccess::PCMCache* pcmCache = NULL, bool trimSilence = false, unsigned int maxTimbreVectorCount = 0, FeatureVectorStore* featureVectorStore = NULL);
         void run();
     };
 }
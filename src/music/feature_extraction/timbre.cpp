@@ -1,8 +1,10 @@
 #include "timbre.hpp"
 
+#include "feature_extraction_helper.hpp"
 #include "debug.hpp"
 #include <Eigen/Dense>
 #include <limits>
+#include <algorithm>
 
 namespace music
 {
@@ -10,28 +12,40 @@ namespace music
     {
         assert (fromTime <= toTime);
         
-        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> vec(transformResult->getOctaveCount() * transformResult->getBinsPerOctave());
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> cqtMeans(transformResult->getOctaveCount() * transformResult->getBinsPerOctave());
         
         int i=0;
         double duration = toTime - fromTime;
-        double sum=0.0, sumEl, max=0.0;
         for (int octave=0; octave<transformResult->getOctaveCount(); octave++)
         {
             for (int bin=0; bin<transformResult->getBinsPerOctave(); bin++)
             {
                 //when taking the mean values, absolute values are returned.
-                vec[i] = log(sumEl=transformResult->getNoteValueMean(toTime, octave, bin, duration));
-                sum += sumEl;
-                if (sumEl > max)
-                    max = sumEl;
-                
-                if (vec[i] < -100)
-                    vec[i] = -100;
-                
-                i++;
+                cqtMeans[i++] = transformResult->getNoteValueMean(toTime, octave, bin, duration);
             }
         }
         
+        return estimateTimbre(cqtMeans);
+    }
+    
+    Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> TimbreEstimator::estimateTimbre(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>& cqtMeans)
+    {
+        assert(cqtMeans.size() == cosValues.rows());
+        
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> vec(cqtMeans.size());
+        
+        double sum=0.0, sumEl, max=0.0;
+        for (int i=0; i<cqtMeans.size(); i++)
+        {
+            vec[i] = log(sumEl=cqtMeans[i]);
+            sum += sumEl;
+            if (sumEl > max)
+                max = sumEl;
+            
+            if (vec[i] < -100)
+                vec[i] = -100;
+        }
+        
         //on low values, do not calculate timbre. instead, give back an error value.
         if (sum < minEnergy)
             return Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>::Zero(1);
@@ -50,6 +64,34 @@ namespace music
         return timbre;
     }
     
+    void TimbreEstimator::estimateTimbre(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& timbreVectors, std::vector<bool>& valid)
+    {
+        assert(cqtMeans.rows() == cosValues.rows());
+        
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> logValues(cqtMeans.rows(), cqtMeans.cols());
+        valid.resize(cqtMeans.cols());
+        
+        for (int i=0; i<cqtMeans.cols(); i++)
+        {
+            double sum=0.0;
+            for (int n=0; n<cqtMeans.rows(); n++)
+            {
+                //same values as in the single time slice version
+                kiss_fft_scalar logValue = log(cqtMeans(n, i));
+                sum += cqtMeans(n, i);
+                
+                if (logValue < -100)
+                    logValue = -100;
+                logValues(n, i) = logValue;
+            }
+            //on low values, the timbre vector is not valid.
+            valid[i] = !(sum < minEnergy);
+        }
+        
+        //apply dct to all time slices at once
+        timbreVectors = (cosValues.transpose() * logValues).cast<kiss_fft_scalar>();
+    }
+    
     TimbreEstimator::TimbreEstimator(ConstantQTransformResult* transformResult, unsigned int timbreVectorSize, float minEnergy) :
         transformResult(transformResult), timbreVectorSize(timbreVectorSize), cosValues(transformResult->getOctaveCount() * transformResult->getBinsPerOctave(), timbreVectorSize), minEnergy(minEnergy)
     {
@@ -75,23 +117,76 @@ namespace music
         if (model)
             delete model;
     }
-    bool TimbreModel::calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, double timeSliceSize, unsigned int timbreVectorSize)
+    //calculates the constant Q means of the time slices, column i-1 belongs to the time slice ending at i*timeSliceSize.
+    class TimbreMeanJob : public TimeSliceRangeJob
+    {
+    private:
+        ConstantQTransformResult* transformResult;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans;
+        double timeSliceSize;
+    public:
+        TimbreMeanJob(ConstantQTransformResult* transformResult, Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, double timeSliceSize) :
+            transformResult(transformResult), cqtMeans(cqtMeans), timeSliceSize(timeSliceSize)
+        {
+            
+        }
+        void processTimeSlices(int from, int to)
+        {
+            int binsPerOctave = transformResult->getBinsPerOctave();
+            int octaveCount = transformResult->getOctaveCount();
+            double time;
+            for (int i=from+1; i<=to; i++)
+            {
+                time = i*timeSliceSize;
+                double duration = time - (time - timeSliceSize);
+                for (int octave=0; octave<octaveCount; octave++)
+                {
+                    for (int bin=0; bin<binsPerOctave; bin++)
+                    {
+                        cqtMeans(octave * binsPerOctave + bin, i-1) = transformResult->getNoteValueMean(time, octave, bin, duration);
+                    }
+                }
+            }
+        }
+    };
+    
+    bool TimbreModel::calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, double timeSliceSize, unsigned int timbreVectorSize, unsigned int threadCount)
+    {
+        DataSet<kiss_fft_scalar> data;
+        bool retVal = calculateTimbreVectors(data, timeSliceSize, timbreVectorSize, threadCount);
+        data.toVectors(timbreVectors);
+        return retVal;
+    }
+    bool TimbreModel::calculateTimbreVectors(DataSet<kiss_fft_scalar>& timbreVectors, double timeSliceSize, unsigned int timbreVectorSize, unsigned int threadCount)
     {
         assert(timeSliceSize > 0.0);
         assert(timbreVectorSize > 1);
         
-        unsigned int foundTimbreVectors=0;
-        TimbreEstimator tEst(transformResult, timbreVectorSize);
-        double time;
+        int binsPerOctave = transformResult->getBinsPerOctave();
+        int octaveCount = transformResult->getOctaveCount();
+        
+        //first collect the mean values of all time slices...
+        int sliceCount = 0;
         for (int i=1; i<transformResult->getOriginalDuration()/timeSliceSize; i++)
+            sliceCount++;
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> cqtMeans(binsPerOctave * octaveCount, sliceCount);
+        TimbreMeanJob job(transformResult, cqtMeans, timeSliceSize);
+        job.run(sliceCount, threadCount);
+        
+        //...then calculate all timbre vectors at once.
+        TimbreEstimator tEst(transformResult, timbreVectorSize);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> timbreMatrix;
+        std::vector<bool> valid;
+        tEst.estimateTimbre(cqtMeans, timbreMatrix, valid);
+        
+        //only keep the valid ones
+        int foundTimbreVectors = std::count(valid.begin(), valid.end(), true);
+        timbreVectors.resize(timbreVectorSize, foundTimbreVectors);
+        int j=0;
+        for (int i=0; i<timbreMatrix.cols(); i++)
         {
-            time = i*timeSliceSize;
-            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> tmp = tEst.estimateTimbre(time - timeSliceSize, time);
-            if (tmp.size() > 1)
-            {
-                timbreVectors.push_back(tmp);
-                foundTimbreVectors++;
-            }
+            if (valid[i])
+                timbreVectors.col(j++) = timbreMatrix.col(i);
         }
         return foundTimbreVectors>0;
     }
@@ -107,13 +202,6 @@ namespace music
         assert(timeSliceSize > 0.0);
         assert(timbreVectorSize > 1);
         
-        if (model)
-        {
-            delete model;
-            model = NULL;
-        }
-        model = new GaussianMixtureModelDiagCov<kiss_fft_scalar>();
-        
         if (callback)
             callback->progress(0.0, "initialized");
         
@@ -121,15 +209,7 @@ namespace music
         if (timbreVectors.empty())
         {
             assert(transformResult != NULL);
-            TimbreEstimator tEst(transformResult, timbreVectorSize);
-            double time;
-            for (int i=1; i<transformResult->getOriginalDuration()/timeSliceSize; i++)
-            {
-                time = i*timeSliceSize;
-                Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> tmp = tEst.estimateTimbre(time - timeSliceSize, time);
-                if (tmp.size() > 1)
-                    timbreVectors.push_back(tmp);
-            }
+            calculateTimbreVectors(timbreVectors, timeSliceSize, timbreVectorSize);
             if (callback)
                 callback->progress(0.5, "calculated timbre vectors, training model now");
         }
@@ -139,60 +219,27 @@ namespace music
                 callback->progress(0.5, "used old timbre vectors, training model now");
         }
         
-        if (timbreVectors.size() < timbreVectorSize)
-            return false;
+        return calculateModel(DataSet<kiss_fft_scalar>(timbreVectors), modelSize, callback);
+    }
+    bool TimbreModel::calculateModel(const DataSet<kiss_fft_scalar>& timbreVectors, unsigned int modelSize, ProgressCallbackCaller* callback, unsigned int restartCount, unsigned int threadCount)
+    {
+        assert(modelSize > 0);
         
-        //then train the model (best-of-three).
-        if (callback)
-            callback->progress(0.5,  "calculating model 1");
-        model->trainGMM(timbreVectors, modelSize);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel1 = model->clone();
-        if (callback)
-            callback->progress(0.65, "calculating model 2");
-        model->trainGMM(timbreVectors, modelSize);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel2 = model->clone();
-        if (callback)
-            callback->progress(0.8,  "calculating model 3");
-        model->trainGMM(timbreVectors, modelSize);
-        GaussianMixtureModel<kiss_fft_scalar>* tmpModel3 = model->clone();
+        if (model)
+        {
+            delete model;
+            model = NULL;
+        }
+        model = new GaussianMixtureModelDiagCov<kiss_fft_scalar>();
         
-        delete model;
-        model = NULL;
+        if ((timbreVectors.getSize() == 0) || (timbreVectors.getSize() < timbreVectors.getDimension()))
+            return false;
         
+        //then train the model (best of restartCount models), starting from k-means clusters.
         if (callback)
-            callback->progress(0.95, "choose best model");
-        
-        //choose best-of-three
-        if (tmpModel1->getModelLogLikelihood() > tmpModel2->getModelLogLikelihood())
-        {
-            if (tmpModel1->getModelLogLikelihood() > tmpModel3->getModelLogLikelihood())
-            {
-                model = tmpModel1;
-                delete tmpModel2;
-                delete tmpModel3;
-            }
-            else
-            {
-                model = tmpModel3;
-                delete tmpModel1;
-                delete tmpModel2;
-            }
-        }
-        else
-        {
-            if (tmpModel2->getModelLogLikelihood() > tmpModel3->getModelLogLikelihood())
-            {
-                model = tmpModel2;
-                delete tmpModel1;
-                delete tmpModel3;
-            }
-            else
-            {
-                model = tmpModel3;
-                delete tmpModel1;
-                delete tmpModel2;
-            }
-        }
+            callback->progress(0.5,  "calculating models");
+        model->setInitMethod(GMM_INIT_KMEANS);
+        model->trainGMMBestOf(timbreVectors, modelSize, restartCount, threadCount);
         
         if (callback)
             callback->progress(1.0, "finished");
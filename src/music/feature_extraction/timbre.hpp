@@ -4,6 +4,7 @@
 #include "constantq.hpp"
 #include "gmm.hpp"
 #include "progress_callback.hpp"
+#include <vector>
 
 namespace music
 {
@@ -75,6 +76,38 @@ namespace music
          *      <code>0</code>.
          */
         Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> estimateTimbre(double fromTime, double toTime);
+        /**
+         * @brief Estimates the timbre from the mean Constant Q values of a time slice.
+         * 
+         * Use this function if you already calculated the mean values,
+         * e.g. with a FusedFeatureExtractor.
+         * 
+         * @param cqtMeans The mean absolute values of all Constant Q bins in the time slice,
+         *      ordered by octave first and bin second, as returned by
+         *      ConstantQTransformResult::getNoteValueMean().
+         * 
+         * @return A timbre vector of dimension <code>timbreVectorSize</code> if the
+         *      sum of the constant Q values in the time slice is higher than
+         *      <code>minEnergy</code>, otherwise a vector of dimension 1 with the value
+         *      <code>0</code>.
+         */
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> estimateTimbre(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>& cqtMeans);
+        /**
+         * @brief Estimates the timbre of many time slices at once.
+         * 
+         * Builds the logarithmic Constant Q values of all time slices and
+         * applies the DCT to all of them with one matrix-matrix product.
+         * This is a lot faster than calling estimateTimbre() for every time slice.
+         * 
+         * @param cqtMeans The mean absolute values of all Constant Q bins, one column per time slice.
+         *      The rows are ordered by octave first and bin second.
+         * @param[out] timbreVectors The timbre vectors, one column of dimension
+         *      <code>timbreVectorSize</code> per time slice.
+         * @param[out] valid For every time slice, <code>true</code> if the
+         *      sum of the constant Q values in the time slice is at least <code>minEnergy</code>.
+         *      Timbre vectors of time slices that are not valid should not be used.
+         */
+        void estimateTimbre(const Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& cqtMeans, Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>& timbreVectors, std::vector<bool>& valid);
     };
     
     /**
@@ -120,10 +153,26 @@ namespace music
          * @param timeSliceSize The time slice size in seconds that will be used to
          *      create the timbre vectors.
          * @param timbreVectorSize The dimensionality of the timbre vectors (and the resulting model).
+         * @param threadCount The number of threads the time slices will be split across.
+         *      The result does not depend on the number of threads.
          * 
          * @return if calculating the timbre vectors was successful, or not.
          */
-        bool calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, double timeSliceSize=0.01, unsigned int timbreVectorSize=12);
+        bool calculateTimbreVectors(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, double timeSliceSize=0.01, unsigned int timbreVectorSize=12, unsigned int threadCount=1);
+        /**
+         * @brief Calculates the timbre vectors which are needed to calculate the model
+         * 
+         * Same as the other version, but stores the timbre vectors in one contiguous block of memory.
+         * 
+         * @param[out] timbreVectors The timbre vectors, one per column. The old contents will be replaced.
+         * @param timeSliceSize The time slice size in seconds that will be used to
+         *      create the timbre vectors.
+         * @param timbreVectorSize The dimensionality of the timbre vectors (and the resulting model).
+         * @param threadCount The number of threads the time slices will be split across.
+         * 
+         * @return if calculating the timbre vectors was successful, or not.
+         */
+        bool calculateTimbreVectors(DataSet<kiss_fft_scalar>& timbreVectors, double timeSliceSize=0.01, unsigned int timbreVectorSize=12, unsigned int threadCount=1);
         
         /**
          * @brief Calculates the model.
@@ -160,6 +209,20 @@ namespace music
          */
         bool calculateModel(std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& timbreVectors, unsigned int modelSize=10, double timeSliceSize=0.02, unsigned int timbreVectorSize=12, ProgressCallbackCaller* callback = NULL);
         
+        /**
+         * @brief Calculates the model from timbre vectors that have been calculated before.
+         * 
+         * @param timbreVectors The timbre vectors, one per column.
+         * @param modelSize The size of the model, e.g. the number of normal distribution
+         *      used to model the timbre vectors.
+         * @param restartCount The number of models that will be trained. The best one will be kept.
+         * @param threadCount The number of threads the models will be trained in.
+         * 
+         * @return if calculating the model was successful, or not.
+         * @see GaussianMixtureModel::trainGMMBestOf()
+         */
+        bool calculateModel(const DataSet<kiss_fft_scalar>& timbreVectors, unsigned int modelSize=10, ProgressCallbackCaller* callback = NULL, unsigned int restartCount=3, unsigned int threadCount=1);
+        
         /**
          * @brief Return the model that was calculated beforehand.
          * 
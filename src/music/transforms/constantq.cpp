@@ -519,10 +519,10 @@ namespace music
         
         return (*octaveMatrix[octave])(bin, pos);
     }
-    kiss_fft_scalar ConstantQTransformResult::getNoteValueMean(float time, int octave, int bin, float preDuration) const
+    bool ConstantQTransformResult::getColumnRange(float time, int octave, float preDuration, int& prePos, int& pos) const
     {
         if (time <= 0.0f)
-            return 0.0f;
+            return false;
         
         assert(preDuration > 0);
         
@@ -535,13 +535,12 @@ namespace music
         time += timeBefore;
         double preTime = time - preDuration;
         
-        int pos = octaveMatrix[octaveCount-1]->cols();
+        pos = octaveMatrix[octaveCount-1]->cols();
         pos >>= octaveCount - octave - 1;
         pos *= (time/duration);
         //pos *= (time/originalDuration);
         pos += drop[octave] + 1;
         
-        int prePos;
         if (preTime <= 0.0)
         {
             prePos=0;
@@ -555,11 +554,19 @@ namespace music
             prePos += drop[octave] + 1;
         }
         
-        float mean=0.0f;
-        
         assert(pos < octaveMatrix[octave]->cols());
         assert(prePos <= pos);
         
+        return true;
+    }
+    kiss_fft_scalar ConstantQTransformResult::getNoteValueMean(float time, int octave, int bin, float preDuration) const
+    {
+        int prePos, pos;
+        if (!getColumnRange(time, octave, preDuration, prePos, pos))
+            return 0.0f;
+        
+        float mean=0.0f;
+        
         for (int i=prePos; i<=pos; i++)
         {
             mean += std::abs((*octaveMatrix[octave])(bin, i));
@@ -116,6 +116,25 @@ namespace music
          */
         kiss_fft_scalar getNoteValueMean(float time, int octave, int bin, float preDuration=0.01) const;
         
+        /**
+         * @brief Returns the columns of an octave matrix that belong to the given time slot.
+         * 
+         * These are the columns getNoteValueMean() calculates the mean of.
+         * Use this function if you want to process the octave matrices
+         * directly, without calling getNoteValueMean() for every bin.
+         * 
+         * @param time the time in seconds
+         * @param octave the octave you want to see
+         * @param preDuration The time before the moment given in <code>time</code> that will be taken into account.
+         * @param[out] prePos the first column of the time slot
+         * @param[out] pos the last column of the time slot. The column itself belongs to the slot.
+         * @return <code>false</code> if the time slot is empty (<code>time &lt;= 0</code>),
+         *      <code>true</code> otherwise.
+         * 
+         * @see getOctaveMatrix()
+         */
+        bool getColumnRange(float time, int octave, float preDuration, int& prePos, int& pos) const;
+        
         /**
          * @brief Returns the original duration of the piece of music.
          * @return the original duration
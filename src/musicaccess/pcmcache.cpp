@@ -0,0 +1,282 @@
+#include "pcmcache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#include <pthread.h>
+
+#include "stringhelper.hpp"
+#include "debug.hpp"
+
+#define PCMCACHE_MAGIC      "LMPC"
+#define PCMCACHE_VERSION    1
+#define PCMCACHE_ENDING     ".pcm"
+//the number of bytes at the beginning and at the end of a file that are part of its key.
+#define PCMCACHE_KEY_BYTES  65536
+
+namespace musicaccess
+{
+    //header of a cache entry. 16 bytes, so the samples are aligned.
+    struct PCMCacheHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t sampleRate;
+        uint32_t sampleCount;
+    };
+    
+    //FNV-1a, 64 bit.
+    static uint64_t fnv1a(const unsigned char* data, size_t length, uint64_t hash = 14695981039346656037ull)
+    {
+        for (size_t i=0; i<length; i++)
+        {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+    
+    PCMCacheEntry::PCMCacheEntry(void* mapping, size_t mappingSize, float* samples, uint32_t sampleCount, uint32_t sampleRate) :
+        mapping(mapping), mappingSize(mappingSize),
+        samples(samples), sampleCount(sampleCount), sampleRate(sampleRate)
+    {
+        
+    }
+    PCMCacheEntry::~PCMCacheEntry()
+    {
+        if (mapping != NULL)
+            munmap(mapping, mappingSize);
+    }
+    
+    PCMCache::PCMCache(const std::string& cacheDirectory, uint64_t maxCacheSize, const std::string& settings) :
+        cacheDirectory(cacheDirectory), maxCacheSize(maxCacheSize), settings(settings),
+        entries(), accessCounter(0), cacheSize(0)
+    {
+        if (!endsWith(this->cacheDirectory, "/"))
+            this->cacheDirectory += "/";
+        //fails if it already exists, which is okay.
+        mkdir(this->cacheDirectory.c_str(), 0755);
+        
+        pthread_mutex_init(&mutex, NULL);
+        scanEntries();
+    }
+    PCMCache::~PCMCache()
+    {
+        pthread_mutex_destroy(&mutex);
+    }
+    
+    void PCMCache::scanEntries()
+    {
+        //(last access time, (size, filename))
+        std::vector<std::pair<time_t, std::pair<uint64_t, std::string> > > dirEntries;
+        
+        DIR* dir = opendir(cacheDirectory.c_str());
+        if (dir == NULL)
+            return;
+        struct dirent* ent;
+        struct stat entryStat;
+        while ((ent = readdir(dir)) != NULL)
+        {
+            std::string filename(ent->d_name);
+            if (!endsWith(filename, PCMCACHE_ENDING))
+                continue;
+            filename = cacheDirectory + filename;
+            if (stat(filename.c_str(), &entryStat) != 0)
+                continue;
+            
+            dirEntries.push_back(std::pair<time_t, std::pair<uint64_t, std::string> >(entryStat.st_mtime,
+                std::pair<uint64_t, std::string>(entryStat.st_size, filename)));
+        }
+        closedir(dir);
+        
+        //oldest first, such that they get the smallest access counters.
+        std::sort(dirEntries.begin(), dirEntries.end());
+        for (unsigned int i=0; i<dirEntries.size(); i++)
+            touchEntry(dirEntries[i].second.second, dirEntries[i].second.first);
+        
+        if (cacheSize > maxCacheSize)
+            evict("");
+    }
+    
+    uint64_t PCMCache::getCacheSize() const
+    {
+        pthread_mutex_lock(&mutex);
+        uint64_t size = cacheSize;
+        pthread_mutex_unlock(&mutex);
+        return size;
+    }
+    
+    std::string PCMCache::getEntryFilename(const std::string& key) const
+    {
+        return cacheDirectory + key + PCMCACHE_ENDING;
+    }
+    
+    std::string PCMCache::getKey(const std::string& filename) const
+    {
+        FILE* file = fopen(filename.c_str(), "rb");
+        if (file == NULL)
+            return "";
+        
+        struct stat fileStat;
+        if (fstat(fileno(file), &fileStat) != 0)
+        {
+            fclose(file);
+            return "";
+        }
+        uint64_t fileSize = fileStat.st_size;
+        uint64_t modificationTime = fileStat.st_mtime;
+        
+        uint64_t contentHash = fnv1a(reinterpret_cast<const unsigned char*>(&fileSize), sizeof(fileSize));
+        contentHash = fnv1a(reinterpret_cast<const unsigned char*>(&modificationTime), sizeof(modificationTime), contentHash);
+        
+        //the beginning and the end of the file. small files are read completely.
+        std::vector<unsigned char> buffer(2 * PCMCACHE_KEY_BYTES);
+        size_t bytesRead = fread(&buffer[0], 1, (fileSize <= buffer.size()) ? fileSize : PCMCACHE_KEY_BYTES, file);
+        if (fileSize > buffer.size())
+        {
+            if (fseeko(file, fileSize - PCMCACHE_KEY_BYTES, SEEK_SET) == 0)
+                bytesRead += fread(&buffer[bytesRead], 1, PCMCACHE_KEY_BYTES, file);
+        }
+        bool readError = ferror(file) || ((fileSize <= buffer.size()) ? (bytesRead != fileSize) : (bytesRead != buffer.size()));
+        fclose(file);
+        if (readError)
+            return "";
+        contentHash = fnv1a(&buffer[0], bytesRead, contentHash);
+        
+        uint64_t settingsHash = fnv1a(reinterpret_cast<const unsigned char*>(settings.c_str()), settings.size());
+        
+        std::ostringstream key;
+        key << std::hex << std::setfill('0') << std::setw(16) << contentHash << "-" << std::setw(16) << settingsHash;
+        return key.str();
+    }
+    
+    PCMCacheEntry* PCMCache::load(const std::string& key) const
+    {
+        if (key.empty())
+            return NULL;
+        
+        std::string entryFilename = getEntryFilename(key);
+        int fd = ::open(entryFilename.c_str(), O_RDONLY);
+        if (fd < 0)
+            return NULL;
+        
+        struct stat entryStat;
+        if ((fstat(fd, &entryStat) != 0) || (size_t(entryStat.st_size) < sizeof(PCMCacheHeader)))
+        {
+            ::close(fd);
+            return NULL;
+        }
+        
+        size_t mappingSize = entryStat.st_size;
+        //private mapping: the caller may change the samples without changing the file.
+        void* mapping = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+            return NULL;
+        
+        PCMCacheHeader* header = static_cast<PCMCacheHeader*>(mapping);
+        if ((std::memcmp(header->magic, PCMCACHE_MAGIC, 4) != 0) ||
+            (header->version != PCMCACHE_VERSION) ||
+            (sizeof(PCMCacheHeader) + uint64_t(header->sampleCount) * sizeof(float) != mappingSize))
+        {
+            DEBUG_OUT("ignoring broken cache entry " << entryFilename, 10);
+            munmap(mapping, mappingSize);
+            return NULL;
+        }
+        
+        //remember the access for eviction, also for other processes.
+        utime(entryFilename.c_str(), NULL);
+        pthread_mutex_lock(&mutex);
+        touchEntry(entryFilename, mappingSize);
+        pthread_mutex_unlock(&mutex);
+        
+        return new PCMCacheEntry(mapping, mappingSize,
+            reinterpret_cast<float*>(static_cast<char*>(mapping) + sizeof(PCMCacheHeader)),
+            header->sampleCount, header->sampleRate);
+    }
+    
+    bool PCMCache::store(const std::string& key, const float* samples, uint32_t sampleCount, uint32_t sampleRate) const
+    {
+        if (key.empty())
+            return false;
+        
+        //unique per process and thread, so nobody else writes to this file.
+        std::ostringstream tmpFilename;
+        tmpFilename << getEntryFilename(key) << ".tmp." << getpid() << "." << (unsigned long)pthread_self();
+        
+        FILE* file = fopen(tmpFilename.str().c_str(), "wb");
+        if (file == NULL)
+        {
+            ERROR_OUT("could not create cache entry " << tmpFilename.str(), 10);
+            return false;
+        }
+        
+        PCMCacheHeader header;
+        std::memcpy(header.magic, PCMCACHE_MAGIC, 4);
+        header.version = PCMCACHE_VERSION;
+        header.sampleRate = sampleRate;
+        header.sampleCount = sampleCount;
+        
+        bool success = (fwrite(&header, sizeof(PCMCacheHeader), 1, file) == 1);
+        success = success && (fwrite(samples, sizeof(float), sampleCount, file) == sampleCount);
+        success = (fclose(file) == 0) && success;
+        
+        if (!success || (rename(tmpFilename.str().c_str(), getEntryFilename(key).c_str()) != 0))
+        {
+            ERROR_OUT("could not write cache entry " << getEntryFilename(key), 10);
+            unlink(tmpFilename.str().c_str());
+            return false;
+        }
+        
+        pthread_mutex_lock(&mutex);
+        touchEntry(getEntryFilename(key), sizeof(PCMCacheHeader) + uint64_t(sampleCount) * sizeof(float));
+        if (cacheSize > maxCacheSize)
+            evict(getEntryFilename(key));
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+    
+    void PCMCache::touchEntry(const std::string& entryFilename, uint64_t size) const
+    {
+        std::pair<uint64_t, uint64_t>& entry = entries[entryFilename];
+        //the entry may have been replaced with one of a different size.
+        cacheSize -= entry.second;
+        cacheSize += size;
+        entry.first = ++accessCounter;
+        entry.second = size;
+    }
+    
+    void PCMCache::evict(const std::string& keepEntryFilename) const
+    {
+        //(last access, filename)
+        std::vector<std::pair<uint64_t, std::string> > lruEntries;
+        for (std::map<std::string, std::pair<uint64_t, uint64_t> >::const_iterator it = entries.begin(); it != entries.end(); it++)
+        {
+            if (it->first != keepEntryFilename)
+                lruEntries.push_back(std::pair<uint64_t, std::string>(it->second.first, it->first));
+        }
+        
+        //oldest first
+        std::sort(lruEntries.begin(), lruEntries.end());
+        for (unsigned int i=0; (i<lruEntries.size()) && (cacheSize > maxCacheSize); i++)
+        {
+            DEBUG_OUT("evicting cache entry " << lruEntries[i].second, 20);
+            //if it cannot be deleted, another process probably did it already. forget it anyway.
+            unlink(lruEntries[i].second.c_str());
+            cacheSize -= entries[lruEntries[i].second].second;
+            entries.erase(lruEntries[i].second);
+        }
+    }
+}
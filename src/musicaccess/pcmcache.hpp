@@ -0,0 +1,186 @@
+#ifndef PCMCACHE_HPP
+#define PCMCACHE_HPP
+
+#include <stdint.h>
+#include <string>
+#include <cstddef>
+#include <map>
+#include <pthread.h>
+
+namespace musicaccess
+{
+    /**
+     * @brief A block of cached samples, mapped into memory.
+     * 
+     * Objects of this class are returned by PCMCache::load(). The samples
+     * stay valid until the object is deleted. They are mapped copy-on-write,
+     * so you may change them without changing the cache file.
+     * 
+     * @see PCMCache
+     */
+    class PCMCacheEntry
+    {
+    private:
+        void* mapping;
+        size_t mappingSize;
+        float* samples;
+        uint32_t sampleCount;
+        uint32_t sampleRate;
+        
+        PCMCacheEntry(void* mapping, size_t mappingSize, float* samples, uint32_t sampleCount, uint32_t sampleRate);
+    public:
+        ~PCMCacheEntry();
+        
+        /**
+         * @brief Returns the cached samples.
+         * @return the cached samples.
+         */
+        float* getSamples()             {return samples;}
+        /**
+         * @brief Returns the number of cached samples.
+         * @return the number of cached samples.
+         */
+        uint32_t getSampleCount()       {return sampleCount;}
+        /**
+         * @brief Returns the sample rate of the cached samples, in Hz.
+         * @return the sample rate of the cached samples, in Hz.
+         */
+        uint32_t getSampleRate()        {return sampleRate;}
+        
+        friend class PCMCache;
+    };
+    
+    /**
+     * @brief An on-disk cache for decoded and resampled mono audio data.
+     * 
+     * Decoding and resampling is often the most expensive part of
+     * processing a file. This cache stores the resampled float samples
+     * of a file in a directory, such that processing the same file again
+     * only needs to read the samples from disk.
+     * 
+     * Entries are addressed by a hash of the file (its size, modification
+     * time and the first and last 64kB of its contents) and
+     * a string describing the decoder and resampler settings, so renaming
+     * or moving a file does not invalidate its entry, while changing it does.
+     * Every entry is a flat file: a 16 byte header, followed by the raw
+     * float samples in host byte order. They are loaded via <code>mmap()</code>.
+     * 
+     * The total size of the cache is bounded. If it grows larger than the
+     * bound, the least recently used entries are deleted. The entries are
+     * only read from the directory when the cache is created; afterwards, the
+     * cache keeps track of them itself. Entries stored by other processes
+     * are added as soon as they are loaded.
+     * 
+     * All functions may be called from multiple threads at the same time,
+     * as long as all of them use the same settings.
+     * 
+     * @code
+     * PCMCache cache("./pcmcache/");
+     * std::string key = cache.getKey("file.mp3");
+     * PCMCacheEntry* entry = cache.load(key);
+     * if (entry == NULL)
+     * {
+     *     //decode and resample the file to "buffer" here
+     *     cache.store(key, buffer, sampleCount, 22050);
+     * }
+     * else
+     * {
+     *     //use entry->getSamples() here
+     *     delete entry;
+     * }
+     * @endcode
+     */
+    class PCMCache
+    {
+    private:
+        std::string cacheDirectory;
+        uint64_t maxCacheSize;
+        std::string settings;
+        
+        //entry filename -> (last access, size). the last access is a counter, larger is newer.
+        mutable std::map<std::string, std::pair<uint64_t, uint64_t> > entries;
+        mutable uint64_t accessCounter;
+        mutable uint64_t cacheSize;
+        mutable pthread_mutex_t mutex;
+        
+        PCMCache(const PCMCache& other);
+        PCMCache& operator=(const PCMCache& other);
+        
+        std::string getEntryFilename(const std::string& key) const;
+        //reads the entries of the cache directory.
+        void scanEntries();
+        //remembers an access of an entry. mutex needs to be locked.
+        void touchEntry(const std::string& entryFilename, uint64_t size) const;
+        //deletes the least recently used entries until the cache is small enough,
+        //but never the given entry. mutex needs to be locked.
+        void evict(const std::string& keepEntryFilename) const;
+    public:
+        /**
+         * @brief Creates a new cache in the given directory.
+         * 
+         * The directory will be created if it does not exist.
+         * 
+         * @param cacheDirectory The directory the cache entries will be saved in.
+         * @param maxCacheSize The maximum size of all entries together, in bytes.
+         * @param settings A description of the decoder and resampler settings
+         *      the samples were produced with. Entries will only be found
+         *      with the same settings they have been stored with.
+         */
+        PCMCache(const std::string& cacheDirectory, uint64_t maxCacheSize = 4ull*1024*1024*1024, const std::string& settings = "Resampler22kHzMono/decodeForAnalysis");
+        ~PCMCache();
+        
+        /**
+         * @brief Calculates the key of a file.
+         * 
+         * The key is calculated from the size, the modification time, the
+         * first and last 64kB of the file and the settings of the cache.
+         * It does not read the whole file.
+         * 
+         * @param filename The file the key should be calculated for.
+         * @return the key of the file, or an empty string if the file could not be read.
+         */
+        std::string getKey(const std::string& filename) const;
+        
+        /**
+         * @brief Loads the samples saved for the given key.
+         * 
+         * @param key The key of the entry, as returned by getKey().
+         * @return the samples saved for the key, or <code>NULL</code> if
+         *      there is no entry. You need to delete the object yourself.
+         */
+        PCMCacheEntry* load(const std::string& key) const;
+        
+        /**
+         * @brief Saves samples for the given key.
+         * 
+         * The entry is written to a temporary file first and then renamed,
+         * such that other threads or processes never see half-written entries.
+         * Afterwards, old entries will be deleted if the cache got too large.
+         * 
+         * @param key The key of the entry, as returned by getKey().
+         * @param samples The samples that should be saved.
+         * @param sampleCount The number of samples.
+         * @param sampleRate The sample rate of the samples, in Hz.
+         * @return <code>true</code> if the operation succeeded, <code>false</code> otherwise.
+         */
+        bool store(const std::string& key, const float* samples, uint32_t sampleCount, uint32_t sampleRate) const;
+        
+        /**
+         * @brief Returns the directory the cache entries are saved in.
+         * @return the directory the cache entries are saved in.
+         */
+        std::string getCacheDirectory() const   {return cacheDirectory;}
+        /**
+         * @brief Returns the maximum size of the cache, in bytes.
+         * @return the maximum size of the cache, in bytes.
+         */
+        uint64_t getMaxCacheSize() const        {return maxCacheSize;}
+        /**
+         * @brief Returns the size of all entries together, in bytes.
+         * @return the size of all entries together, in bytes.
+         */
+        uint64_t getCacheSize() const;
+    };
+}
+
+#endif  //PCMCACHE_HPP
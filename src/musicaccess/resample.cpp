@@ -111,6 +111,10 @@ namespace musicaccess
     }
     bool Resampler22kHzMono::resample(uint32_t fromSampleRate, float** samplePtr, unsigned int& sampleCount, unsigned int channelCount) const
     {
+        //decoder already delivered what we need, nothing to do here.
+        if ((channelCount == 1) && (fromSampleRate == 22050))
+            return true;
+        
         //first convert to mono - we do not need stereo or more channels.
         unsigned int frameCount = sampleCount/channelCount;
         float* monoSamples = new float[frameCount];
@@ -119,6 +119,10 @@ namespace musicaccess
          * Then, a low pass filter is applied to the input signal, and
          * up-/downsampling takes place.
          * 
+         * If the input already is 22.05kHz mono (e.g. from
+         * SoundFile::open() with <code>decodeForAnalysis</code> set),
+         * the samples are left untouched.
+         * 
          * @param fromSampleRate the sample rate of the input signal.
          * @param samplePtr this is input and output at the same time. Since
          *      you will much likely not get the same sample count out of the function,
@@ -3,6 +3,8 @@
 #include <iostream>
 #include <algorithm>
 #include <cctype>
+#include <cassert>
+#include <cstdio>
 #include "debug.hpp"
 
 #ifdef HAVE_VORBISFILE
@@ -15,8 +17,10 @@ namespace musicaccess
     SoundFile::SoundFile() :
         channelCount(0), sampleSize(0), sampleCount(0),
         sampleRate(0), position(0), fileOpen(false),
+        decodeToFloat(false), decodeForAnalysis(false),
         dataType(DATATYPE_UNKNOWN),
         mpg123Handle(NULL), sndfileHandle(NULL),
+        vorbisfileHandle(NULL),
         metadata(NULL)
     {
         //will init mpg123 and sndfile if necessary
@@ -35,7 +39,7 @@ namespace musicaccess
         SingletonInitializer::destroy();
     }
 
-    bool SoundFile::open(const std::string& filename, bool decodeToFloat)
+    bool SoundFile::open(const std::string& filename, bool decodeToFloat, bool decodeForAnalysis)
     {
         //first: close open files, if any.
         if (fileOpen)
@@ -45,6 +49,7 @@ namespace musicaccess
         }
         
         this->decodeToFloat = decodeToFloat;
+        this->decodeForAnalysis = decodeForAnalysis;
         
         std::string loweredFilename(filename);
         tolower(loweredFilename);
@@ -56,9 +61,6 @@ namespace musicaccess
         {   //use libmpg123
             dataType = DATATYPE_MPG123;
             int error;
-            mpg123_id3v1* id3v1;
-            mpg123_id3v2* id3v2;
-            int meta;
             mpg123Handle = mpg123_new(NULL, &error);
             mpg123_param(mpg123Handle, MPG123_ADD_FLAGS, MPG123_QUIET, MPG123_QUIET);
             if (error != MPG123_OK)
@@ -72,6 +74,21 @@ namespace musicaccess
             if (decodeToFloat)
                 mpg123_param(mpg123Handle, MPG123_ADD_FLAGS, MPG123_FORCE_FLOAT, 0.0);
             
+            if (decodeForAnalysis)
+            {
+                //only allow mono output at low sample rates. mpg123 will choose
+                //the native rate, half or quarter of it - whichever fits first.
+                //44.1kHz gets 22.05kHz, 48kHz gets 24kHz, 32kHz and lower rates
+                //are decoded natively. no rate is below 22.05kHz unless the file is,
+                //so the resampler still gets the full band the analysis needs.
+                const long analysisRates[] = {8000, 11025, 12000, 16000, 22050, 24000, 32000};
+                int analysisEncoding = decodeToFloat ? MPG123_ENC_FLOAT_32 : MPG123_ENC_SIGNED_16;
+                mpg123_param(mpg123Handle, MPG123_ADD_FLAGS, MPG123_MONO_MIX, 0.0);
+                mpg123_format_none(mpg123Handle);
+                for (unsigned int i=0; i<sizeof(analysisRates)/sizeof(long); i++)
+                    mpg123_format(mpg123Handle, analysisRates[i], MPG123_MONO, analysisEncoding);
+            }
+            
             //open file
             error = mpg123_open(mpg123Handle, filename.c_str());
             if (error != MPG123_OK)
@@ -84,31 +101,7 @@ namespace musicaccess
             //need this to find id3 tags
             mpg123_scan(mpg123Handle);
             
-            meta = mpg123_meta_check(mpg123Handle);
-            if ((meta & MPG123_ID3) && (mpg123_id3(mpg123Handle, &id3v1, &id3v2) == MPG123_OK))
-            {
-                metadata = new SoundFileMetadata();
-                metadata->setFilename(filename);
-                if (id3v2 != NULL)
-                {
-                    metadata->setTitle(mpg123_stringToStdString(id3v2->title));
-                    metadata->setArtist(mpg123_stringToStdString(id3v2->artist));
-                    metadata->setAlbum(mpg123_stringToStdString(id3v2->album));
-                    metadata->setYear(mpg123_stringToStdString(id3v2->year));
-                    metadata->setGenre(mpg123_stringToStdString(id3v2->genre));
-                }
-                else
-                {
-                    if (id3v1 != NULL)
-                    {
-                        metadata->setTitle(std::string(id3v1->title));
-                        metadata->setArtist(std::string(id3v1->artist));
-                        metadata->setAlbum(std::string(id3v1->album));
-                        metadata->setYear(std::string(id3v1->year));
-                        metadata->setGenre("-not yet implemented-");    //TODO: Convert genre.
-                    }
-                }
-            }
+            readID3Metadata(filename);
             
             int encoding;
             error = mpg123_getformat(mpg123Handle, &sampleRate, &channelCount, &encoding);
@@ -164,65 +157,40 @@ namespace musicaccess
             return true;
         }
         else
-        {   //use libsndfile
-            dataType = DATATYPE_SNDFILE;
-            
+        {
             #ifdef HAVE_VORBISFILE
             if (endsWith(loweredFilename, ".ogg"))
-            {
-                metadata = new SoundFileMetadata();
-                metadata->setFilename(filename);
-                
-                OggVorbis_File vf;
-                if (ov_fopen(filename.c_str(), &vf) != 0)
-                    return false;
-                
-                vorbis_comment* comment = NULL;
-                comment = ov_comment(&vf, -1);
-                
-                for (int i=0; i<comment->comments; i++)
+            {   //use libvorbisfile. one handle for metadata and decoding.
+                if (!openVorbisfile(filename))
                 {
-                    std::string actComment(comment->user_comments[i]);
-                    DEBUG_OUT("vorbis_comment: " << actComment, 15);
-                    
-                    std::string loweredComment = actComment;
-                    tolower(loweredComment);
-                    
-                    if (loweredComment.substr(0, 6) == "title=")
-                    {
-                        metadata->setTitle(actComment.substr(6, std::string::npos));
-                        DEBUG_OUT("  title:  " << metadata->getTitle(), 15);
-                    }
-                    else if (loweredComment.substr(0, 7) == "artist=")
-                    {
-                        metadata->setArtist(actComment.substr(7, std::string::npos));
-                        DEBUG_OUT("  artist: " << metadata->getArtist(), 15);
-                    }
-                    else if (loweredComment.substr(0, 6) == "album=")
-                    {
-                        metadata->setAlbum(actComment.substr(6, std::string::npos));
-                        DEBUG_OUT("  album:  " << metadata->getAlbum(), 15);
-                    }
-                    else if (loweredComment.substr(0, 6) == "genre=")
-                    {
-                        metadata->setGenre(actComment.substr(6, std::string::npos));
-                        DEBUG_OUT("  genre:  " << metadata->getGenre(), 15);
-                    }
-                    else if (loweredComment.substr(0, 6) == "track=")
-                    {
-                        metadata->setTrack(actComment.substr(6, std::string::npos));
-                        DEBUG_OUT("  track: " << metadata->getTrack(), 15);
-                    }
+                    fileOpen = false;
+                    return false;
                 }
                 
-                vorbis_comment_clear(comment);
-                ov_clear(&vf);
+                position = 0;
+                if (decodeToFloat)
+                    sampleSize = 4;
+                else
+                    sampleSize = 2;
+                
+                fileOpen = true;
+                return true;
             }
             #endif  //HAVE_VORBISFILE
             
+            //use libsndfile
+            dataType = DATATYPE_SNDFILE;
+            
             SF_INFO sfinfo;
             sfinfo.format = 0;  //documentation says I need to do so
             sndfileHandle = sf_open(filename.c_str(), SFM_READ, &sfinfo);
+            if (sndfileHandle == NULL)
+            {
+                std::cerr << "sndfile: open failed, " << sf_strerror(NULL) << std::endl;
+                dataType = DATATYPE_UNKNOWN;
+                fileOpen = false;
+                return false;
+            }
             
             position = 0;
             sampleRate = sfinfo.samplerate;
@@ -244,6 +212,236 @@ namespace musicaccess
         return false;
     }
 
+    bool SoundFile::readMetadata(const std::string& filename)
+    {
+        //first: close open files, if any.
+        if (fileOpen)
+        {
+            if (!close())
+                return false;
+        }
+        if (metadata != NULL)
+        {
+            delete metadata;
+            metadata = NULL;
+        }
+        
+        std::string loweredFilename(filename);
+        tolower(loweredFilename);
+        
+        position = 0;
+        
+        if (endsWith(loweredFilename, ".mp3"))
+        {   //use libmpg123, but do not set up decoding.
+            int error;
+            mpg123Handle = mpg123_new(NULL, &error);
+            if (error != MPG123_OK)
+            {
+                std::cerr << "mpg123: setup failed, " << mpg123_plain_strerror(error) << std::endl;
+                return false;
+            }
+            mpg123_param(mpg123Handle, MPG123_ADD_FLAGS, MPG123_QUIET, MPG123_QUIET);
+            
+            error = mpg123_open(mpg123Handle, filename.c_str());
+            if (error != MPG123_OK)
+            {
+                std::cerr << "mpg123: open failed, " << mpg123_plain_strerror(error) << std::endl;
+                mpg123_delete(mpg123Handle);
+                mpg123Handle = NULL;
+                return false;
+            }
+            
+            //need this to find id3v1 tags at the end of the file, same as in open().
+            //only the frame headers are read, nothing is decoded.
+            mpg123_scan(mpg123Handle);
+            
+            int encoding;
+            error = mpg123_getformat(mpg123Handle, &sampleRate, &channelCount, &encoding);
+            if (error == MPG123_OK)
+            {
+                readID3Metadata(filename);
+                
+                sampleCount = mpg123_length(mpg123Handle);
+                if (sampleCount == MPG123_ERR)
+                    sampleCount = 0;
+                sampleCount *= channelCount;
+                sampleSize = mpg123_encsize(encoding);
+            }
+            else
+                std::cerr << "mpg123: getting file info failed, " << mpg123_plain_strerror(error) << std::endl;
+            
+            mpg123_close(mpg123Handle);
+            mpg123_delete(mpg123Handle);
+            mpg123Handle = NULL;
+            return error == MPG123_OK;
+        }
+        #ifdef HAVE_VORBISFILE
+        else if (endsWith(loweredFilename, ".ogg"))
+        {
+            if (!openVorbisfile(filename))
+                return false;
+            sampleSize = 2;
+            
+            ov_clear(vorbisfileHandle);
+            delete vorbisfileHandle;
+            vorbisfileHandle = NULL;
+            dataType = DATATYPE_UNKNOWN;
+            return true;
+        }
+        #endif  //HAVE_VORBISFILE
+        else
+        {   //libsndfile only reads the header when opening a file.
+            SF_INFO sfinfo;
+            sfinfo.format = 0;  //documentation says I need to do so
+            SNDFILE* handle = sf_open(filename.c_str(), SFM_READ, &sfinfo);
+            if (handle == NULL)
+            {
+                std::cerr << "sndfile: open failed, " << sf_strerror(NULL) << std::endl;
+                return false;
+            }
+            
+            sampleRate = sfinfo.samplerate;
+            channelCount = sfinfo.channels;
+            sampleCount = sfinfo.frames * channelCount;
+            sampleSize = 2;
+            
+            sf_close(handle);
+            return true;
+        }
+    }
+    
+    void SoundFile::readID3Metadata(const std::string& filename)
+    {
+        mpg123_id3v1* id3v1;
+        mpg123_id3v2* id3v2;
+        int meta;
+        
+        meta = mpg123_meta_check(mpg123Handle);
+        if ((meta & MPG123_ID3) && (mpg123_id3(mpg123Handle, &id3v1, &id3v2) == MPG123_OK))
+        {
+            metadata = new SoundFileMetadata();
+            metadata->setFilename(filename);
+            if (id3v2 != NULL)
+            {
+                metadata->setTitle(mpg123_stringToStdString(id3v2->title));
+                metadata->setArtist(mpg123_stringToStdString(id3v2->artist));
+                metadata->setAlbum(mpg123_stringToStdString(id3v2->album));
+                metadata->setYear(mpg123_stringToStdString(id3v2->year));
+                metadata->setGenre(mpg123_stringToStdString(id3v2->genre));
+            }
+            else
+            {
+                if (id3v1 != NULL)
+                {
+                    metadata->setTitle(std::string(id3v1->title));
+                    metadata->setArtist(std::string(id3v1->artist));
+                    metadata->setAlbum(std::string(id3v1->album));
+                    metadata->setYear(std::string(id3v1->year));
+                    metadata->setGenre("-not yet implemented-");    //TODO: Convert genre.
+                }
+            }
+        }
+    }
+    
+    bool SoundFile::openVorbisfile(const std::string& filename)
+    {
+        #ifdef HAVE_VORBISFILE
+        vorbisfileHandle = new OggVorbis_File;
+        if (ov_fopen(filename.c_str(), vorbisfileHandle) != 0)
+        {
+            std::cerr << "vorbisfile: open failed: " << filename << std::endl;
+            delete vorbisfileHandle;
+            vorbisfileHandle = NULL;
+            return false;
+        }
+        dataType = DATATYPE_VORBISFILE;
+        
+        vorbis_info* info = ov_info(vorbisfileHandle, -1);
+        sampleRate = info->rate;
+        channelCount = info->channels;
+        sampleCount = ov_pcm_total(vorbisfileHandle, -1);
+        if (sampleCount < 0)
+            sampleCount = 0;
+        sampleCount *= channelCount;
+        
+        metadata = new SoundFileMetadata();
+        metadata->setFilename(filename);
+        
+        vorbis_comment* comment = NULL;
+        comment = ov_comment(vorbisfileHandle, -1);
+        
+        for (int i=0; i<comment->comments; i++)
+        {
+            std::string actComment(comment->user_comments[i]);
+            DEBUG_OUT("vorbis_comment: " << actComment, 15);
+            
+            std::string loweredComment = actComment;
+            tolower(loweredComment);
+            
+            if (loweredComment.substr(0, 6) == "title=")
+            {
+                metadata->setTitle(actComment.substr(6, std::string::npos));
+                DEBUG_OUT("  title:  " << metadata->getTitle(), 15);
+            }
+            else if (loweredComment.substr(0, 7) == "artist=")
+            {
+                metadata->setArtist(actComment.substr(7, std::string::npos));
+                DEBUG_OUT("  artist: " << metadata->getArtist(), 15);
+            }
+            else if (loweredComment.substr(0, 6) == "album=")
+            {
+                metadata->setAlbum(actComment.substr(6, std::string::npos));
+                DEBUG_OUT("  album:  " << metadata->getAlbum(), 15);
+            }
+            else if (loweredComment.substr(0, 6) == "genre=")
+            {
+                metadata->setGenre(actComment.substr(6, std::string::npos));
+                DEBUG_OUT("  genre:  " << metadata->getGenre(), 15);
+            }
+            else if (loweredComment.substr(0, 6) == "track=")
+            {
+                metadata->setTrack(actComment.substr(6, std::string::npos));
+                DEBUG_OUT("  track: " << metadata->getTrack(), 15);
+            }
+        }
+        //the comments belong to vorbisfileHandle and will be freed by ov_clear().
+        return true;
+        #else
+        return false;
+        #endif  //HAVE_VORBISFILE
+    }
+    
+    size_t SoundFile::readVorbisfile(float* buffer, unsigned int count)
+    {
+        #ifdef HAVE_VORBISFILE
+        float** pcm;
+        int bitstream;
+        long framesRead;
+        size_t samplesRead = 0;
+        
+        //vorbisfile gives back one array per channel, we need interleaved samples.
+        while (samplesRead + channelCount <= count)
+        {
+            framesRead = ov_read_float(vorbisfileHandle, &pcm, (count - samplesRead) / channelCount, &bitstream);
+            if (framesRead == OV_HOLE)
+                continue;   //interruption in the data, but we can go on.
+            else if (framesRead <= 0)
+                break;      //end of file or error
+            
+            for (long i=0; i<framesRead; i++)
+            {
+                for (int j=0; j<channelCount; j++)
+                    buffer[samplesRead++] = pcm[j][i];
+            }
+        }
+        
+        position += samplesRead;
+        return samplesRead;
+        #else
+        return 0;
+        #endif  //HAVE_VORBISFILE
+    }
+    
     bool SoundFile::close()
     {
         if (metadata != NULL)
@@ -277,6 +475,21 @@ namespace musicaccess
                 
                 return true;
             }
+            #ifdef HAVE_VORBISFILE
+            else if (dataType == DATATYPE_VORBISFILE)
+            {
+                ov_clear(vorbisfileHandle);
+                delete vorbisfileHandle;
+                
+                vorbisfileHandle = NULL;
+                mpg123Handle = NULL;
+                sndfileHandle = NULL;
+                dataType = DATATYPE_UNKNOWN;
+                fileOpen = false;
+                
+                return true;
+            }
+            #endif  //HAVE_VORBISFILE
             else
             {
                 //do nothing.
@@ -353,6 +566,17 @@ namespace musicaccess
             position += itemsRead;
             return itemsRead;
         }
+        else if (dataType == DATATYPE_VORBISFILE)
+        {   //return data from libvorbisfile, read as float and reformat to int16_t
+            float* floatBuffer = new float[count];
+            size_t itemsRead = readVorbisfile(floatBuffer, count);
+            for (unsigned int i=0; i<itemsRead; i++)
+            {
+                buffer[i] = 32767.0 * std::max(-1.0f, std::min(1.0f, floatBuffer[i]));
+            }
+            delete[] floatBuffer;
+            return itemsRead;
+        }
         else
         {
             std::cerr << "trying to read unknown datatype!" << std::endl;
@@ -426,6 +650,10 @@ namespace musicaccess
             position += itemsRead;
             return itemsRead;
         }
+        else if (dataType == DATATYPE_VORBISFILE)
+        {   //return data from libvorbisfile
+            return readVorbisfile(buffer, count);
+        }
         else
         {
             std::cerr << "trying to read unknown datatype!" << std::endl;
@@ -435,6 +663,100 @@ namespace musicaccess
 
 
 
+    bool SoundFile::seek(uint32_t position)
+    {
+        if (!fileOpen)
+        {
+            std::cerr << "trying to seek without opening a file!" << std::endl;
+            return false;
+        }
+        
+        //the libraries count in frames, not in samples.
+        off_t frame = position / channelCount;
+        
+        if (dataType == DATATYPE_MPG123)
+        {
+            off_t newFrame = mpg123_seek(mpg123Handle, frame, SEEK_SET);
+            if (newFrame < 0)
+            {
+                std::cerr << "mpg123: seeking to position " << position << " failed, " << mpg123_plain_strerror(newFrame) << std::endl;
+                return false;
+            }
+            this->position = newFrame * channelCount;
+            return true;
+        }
+        else if (dataType == DATATYPE_SNDFILE)
+        {
+            sf_count_t newFrame = sf_seek(sndfileHandle, frame, SEEK_SET);
+            if (newFrame < 0)
+            {
+                std::cerr << "sndfile: seeking to position " << position << " failed." << std::endl;
+                return false;
+            }
+            this->position = newFrame * channelCount;
+            return true;
+        }
+        #ifdef HAVE_VORBISFILE
+        else if (dataType == DATATYPE_VORBISFILE)
+        {
+            if (ov_pcm_seek(vorbisfileHandle, frame) != 0)
+            {
+                std::cerr << "vorbisfile: seeking to position " << position << " failed." << std::endl;
+                return false;
+            }
+            this->position = frame * channelCount;
+            return true;
+        }
+        #endif  //HAVE_VORBISFILE
+        else
+        {
+            std::cerr << "trying to seek in unknown datatype!" << std::endl;
+            return false;
+        }
+    }
+    
+    size_t SoundFile::readExcerpts(float* buffer, unsigned int excerptLength, unsigned int excerptCount)
+    {
+        if (!fileOpen)
+        {
+            std::cerr << "trying to read without opening a file!" << std::endl;
+            return 0;
+        }
+        assert(excerptCount > 0);
+        
+        //excerpts need to start at the beginning of a frame
+        excerptLength -= excerptLength % channelCount;
+        
+        //excerpts do not fit into the file: read everything.
+        if ((unsigned long)excerptLength * excerptCount >= (unsigned long)sampleCount)
+        {
+            if (!seek(0))
+                return 0;
+            return readSamples(buffer, sampleCount);
+        }
+        
+        size_t samplesRead = 0;
+        size_t actSamplesRead;
+        uint32_t excerptStart;
+        for (unsigned int i=0; i<excerptCount; i++)
+        {
+            //take the excerpt from the middle of the i-th part of the file
+            excerptStart = (uint32_t)(double(sampleCount) * (2*i+1) / (2.0*excerptCount) - excerptLength/2.0);
+            if (excerptStart + excerptLength > (unsigned long)sampleCount)
+                excerptStart = sampleCount - excerptLength;
+            
+            if (!seek(excerptStart))
+                return samplesRead;
+            actSamplesRead = readSamples(buffer + samplesRead, excerptLength);
+            samplesRead += actSamplesRead;
+            
+            //file ended early. don't go on.
+            if (actSamplesRead < excerptLength)
+                break;
+        }
+        return samplesRead;
+    }
+
     SoundFile::SingletonInitializer* SoundFile::SingletonInitializer::instance = NULL;
 
     SoundFile::SingletonInitializer::SingletonInitializer() :
@@ -6,6 +6,9 @@
 #include <mpg123.h>
 #include <sndfile.h>
 
+//defined by libvorbisfile, only used as pointer here.
+struct OggVorbis_File;
+
 namespace musicaccess
 {
     /**
@@ -48,6 +51,7 @@ namespace musicaccess
     {
         DATATYPE_MPG123,
         DATATYPE_SNDFILE,
+        DATATYPE_VORBISFILE,
         DATATYPE_UNKNOWN
     };
 
@@ -90,11 +94,13 @@ namespace musicaccess
         bool fileOpen;
         
         bool decodeToFloat;
+        bool decodeForAnalysis;
         
         SOUNDFILE_DATATYPE dataType;
         
         mpg123_handle* mpg123Handle;
         SNDFILE*       sndfileHandle;
+        OggVorbis_File* vorbisfileHandle;
         
         SoundFileMetadata* metadata;
         
@@ -121,6 +127,13 @@ namespace musicaccess
             ~SingletonInitializer();
         };
         std::string mpg123_stringToStdString(mpg123_string* str);
+        
+        //reads the id3 tags from mpg123Handle into metadata.
+        void readID3Metadata(const std::string& filename);
+        //opens vorbisfileHandle and reads format and vorbis comments.
+        bool openVorbisfile(const std::string& filename);
+        //reads interleaved samples from vorbisfileHandle.
+        size_t readVorbisfile(float* buffer, unsigned int count);
     public:
         SoundFile();
         ~SoundFile();
@@ -130,14 +143,43 @@ namespace musicaccess
          * 
          * This function first tries to determine which underlying library it should
          * use to open the file dependend on the extension of the file.
-         * if the extension is <code>.mp3</code>, it uses libmpg123, otherwise it
+         * if the extension is <code>.mp3</code>, it uses libmpg123, if it is
+         * <code>.ogg</code>, it uses libvorbisfile (if available), otherwise it
          * uses libsndfile.
          * 
+         * If <code>decodeForAnalysis</code> is set, the decoder will be asked
+         * to output mono data at a sample rate near 22.05kHz, which is what
+         * the feature extraction needs. libmpg123 is able to do so while
+         * decoding (it mixes the channels down and decodes at half rate, as
+         * long as this does not drop below 22.05kHz), which saves a lot of
+         * decoding time. Other formats are decoded
+         * as usual. In any case, the effective format can be read via
+         * getSampleRate() and getChannelCount() afterwards.
+         * 
          * @param filename The filename you want to open.
          * @param decodeToFloat Determines, wether you want to decode to float or to integer numbers.
+         * @param decodeForAnalysis Determines, wether the decoder should
+         *      output 22.05kHz mono data, if possible.
          * @return <code>true</code>, if opening the file was successful, <code>false</code> otherwise.
          */
-        bool open(const std::string&, bool decodeToFloat=false);
+        bool open(const std::string&, bool decodeToFloat=false, bool decodeForAnalysis=false);
+        
+        /**
+         * @brief Reads only the metadata and the format of a music file.
+         * 
+         * This is a lot faster than open(), since nothing will be set up
+         * for decoding: Only the tags and the file header are read. For mp3 files,
+         * the frame headers are scanned like in open(), such that the tags
+         * and the sample count are the same as the ones open() reads.
+         * 
+         * Afterwards, getMetadata(), getChannelCount(), getSampleRate() and
+         * getSampleCount() return the values of the file. The file will not
+         * be open, so you cannot read samples from it.
+         * 
+         * @param filename The filename you want to read the metadata of.
+         * @return <code>true</code>, if reading the metadata was successful, <code>false</code> otherwise.
+         */
+        bool readMetadata(const std::string& filename);
         
         /**
          * @brief Closes an opened music file.
@@ -209,6 +251,19 @@ namespace musicaccess
          */
         uint32_t getPosition() {return position;}
         
+        /**
+         * @brief Sets the sample reader position within the file.
+         * 
+         * The position is an absolute position, just like the one returned
+         * by getPosition(). It will be rounded down to the beginning of the
+         * frame it points into, such that reading continues with the first channel.
+         * 
+         * @param position The new position within the file.
+         * @remarks If no file has been opened, the return value is undefined.
+         * @return <code>true</code>, if seeking was successful, <code>false</code> otherwise.
+         */
+        bool seek(uint32_t position);
+        
         /**
          * @brief Returns the next samples, formatted as int16_t.
          * 
@@ -245,9 +300,33 @@ namespace musicaccess
          */
         size_t readSamples(float* buffer, unsigned int count);
         
+        /**
+         * @brief Reads some evenly spaced excerpts of the file, formatted as float.
+         * 
+         * The file is divided into <code>excerptCount</code> parts of equal length,
+         * and <code>excerptLength</code> samples are read from the middle of every part.
+         * The excerpts are written to the buffer one after another. Only the
+         * excerpts will be decoded, the rest of the file is skipped via seek().
+         * If the excerpts together are longer than the file, the whole
+         * file will be read.
+         * 
+         * Choosing <code>excerptCount=1</code> reads one excerpt from the middle
+         * of the file.
+         * 
+         * @param buffer The buffer where to save the data. You have to make
+         *      sure that there is enough memory to write
+         *      <code>excerptLength*excerptCount</code> samples to.
+         * @param excerptLength The sample count of one excerpt. Like all other
+         *      sample counts, this counts the samples of all channels.
+         * @param excerptCount The number of excerpts that should be read.
+         * @remarks If no file has been opened, the return value is undefined.
+         * @return the sample count that actually was read
+         */
+        size_t readExcerpts(float* buffer, unsigned int excerptLength, unsigned int excerptCount=1);
+        
         /**
          * @brief Returns the metadata of the opened sound file (if any)
-         * @remarks For now, metadata is only supported for mp3 files. id3v2
+         * @remarks For now, metadata is only supported for mp3 and ogg files. id3v2
          *      is preferred if both id3v1 and id3v2 tags are available.
          * @return The metadata of the sound file, or NULL if there is no metadata.
          */
@@ -40,6 +40,10 @@ int main(int argc, char *argv[])
         return tests::testStringHelper();
     else if (testname == "libmusicaccess")
         return tests::testLibMusicAccess();
+    else if (testname == "pcmcache")
+        return tests::testPCMCache();
+    else if (testname == "featurevectorstore")
+        return tests::testFeatureVectorStore();
     else if (testname == "eigen")
         return tests::testEigen();
     else if (testname == "constantq")
@@ -50,10 +54,14 @@ int main(int argc, char *argv[])
         return tests::testDCT();
     else if (testname == "sqlitedatabaseconnection")
         return tests::testSQLiteDatabaseConnection();
+    else if (testname == "remodelrecording")
+        return tests::testRemodelRecording();
     else if (testname == "estimatebpm")
         return tests::testEstimateBPM();
     else if (testname == "estimatechroma")
         return tests::testEstimateChroma();
+    else if (testname == "chromareference")
+        return tests::testChromaReference();
     else if (testname == "estimatetimbre")
         return tests::testEstimateTimbre();
     else if (testname == "calculatedynamicrange")
@@ -62,12 +70,20 @@ int main(int argc, char *argv[])
         return tests::testPerBinStatistics();
     else if (testname == "pertimeslicestatistics")
         return tests::testPerTimeSliceStatistics();
+    else if (testname == "fusedfeatureextraction")
+        return tests::testFusedFeatureExtraction();
+    else if (testname == "adaptiveslicing")
+        return tests::testAdaptiveSlicing();
     else if (testname == "fisherlda")
         return tests::testFisherLDA();
     else if (testname == "gmm")
         return tests::testGMM();
     else if (testname == "gmmrand")
         return performance_tests::testGMMRand();
+    else if (testname == "emacceleration")
+        return performance_tests::testEMAcceleration();
+    else if (testname == "gmmdivergence")
+        return performance_tests::testGMMDivergence();
     else if (testname == "gaussian")
         return tests::testGaussian();
     else if (testname == "kmeans")
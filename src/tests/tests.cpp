@@ -3,6 +3,7 @@
 #include <cstdlib>
 
 #include <musicaccess.hpp>
+#include <musicaccess/pcmcache.hpp>
 #include <Eigen/Dense>
 #define EIGEN_YES_I_KNOW_SPARSE_MODULE_IS_NOT_STABLE_YET
 #include <Eigen/Sparse>
@@ -16,6 +17,7 @@
 #include "chroma.hpp"
 #include "dct.hpp"
 #include "gmm.hpp"
+#include "feature_vector_store.hpp"
 
 #include <list>
 #include <limits>
@@ -23,6 +25,9 @@
 #include <sstream>
 #include <vector>
 #include <queue>
+#include <cmath>
+#include <cstdio>
+#include <sys/stat.h>
 
 #include "stringhelper.hpp"
 #include "console_colors.hpp"
@@ -68,6 +73,186 @@ namespace tests
         resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());
         
         CHECK_OP(sampleCount, <=, file.getSampleCount());
+        delete[] buffer;
+        
+        std::cerr << "checking metadata-only access..." << std::endl;
+        //the tags need to be the same as the ones open() reads.
+        CHECK(file.open("./testdata/test.mp3"));
+        bool hasMetadata = (file.getMetadata() != NULL);
+        std::string title = hasMetadata ? file.getMetadata()->getTitle() : "";
+        std::string artist = hasMetadata ? file.getMetadata()->getArtist() : "";
+        CHECK(file.close());
+        
+        CHECK(!file.readMetadata("./testdata/test-lalalala.mp3"));
+        CHECK(file.readMetadata("./testdata/test.mp3"));
+        CHECK(!file.isFileOpen());
+        CHECK_EQ(file.getChannelCount(), 2);
+        CHECK_EQ(file.getSampleRate(), 44100);
+        //same length as the one open() scans
+        CHECK_EQ(file.getSampleCount(), 1424384u);
+        CHECK_EQ(file.getMetadata() != NULL, hasMetadata);
+        if (hasMetadata)
+        {
+            CHECK_EQ(file.getMetadata()->getTitle(), title);
+            CHECK_EQ(file.getMetadata()->getArtist(), artist);
+        }
+        
+        std::cerr << "checking decoder-side downsampling..." << std::endl;
+        CHECK(file.open("./testdata/test.mp3", true, true));
+        CHECK(file.isFileOpen());
+        CHECK_EQ(file.getChannelCount(), 1);
+        CHECK_EQ(file.getSampleRate(), 22050);
+        CHECK_EQ(file.getSampleSize(), 4);
+        CHECK_OP(file.getSampleCount(), <=, 1424384u/4u + 1152u);
+        CHECK_OP(file.getSampleCount(), >=, 1424384u/4u - 1152u);
+        
+        float* floatBuffer = new float[file.getSampleCount()];
+        sampleCount = file.readSamples(floatBuffer, file.getSampleCount());
+        CHECK_EQ(sampleCount, file.getSampleCount());
+        //already 22.05kHz mono, resampler should not touch the data
+        float* oldFloatBuffer = floatBuffer;
+        CHECK(resampler.resample(file.getSampleRate(), &floatBuffer, sampleCount, file.getChannelCount()));
+        CHECK(floatBuffer == oldFloatBuffer);
+        CHECK_EQ(sampleCount, file.getSampleCount());
+        delete[] floatBuffer;
+        CHECK(file.close());
+        
+        return EXIT_SUCCESS;
+    }
+    
+    int testPCMCache()
+    {
+        std::cerr << "creating cache..." << std::endl;
+        //room for one entry with 1000 samples plus header, but not for two.
+        musicaccess::PCMCache cache("./pcmcache_test", 6000);
+        CHECK_EQ(cache.getCacheDirectory(), "./pcmcache_test/");
+        
+        std::cerr << "calculating keys..." << std::endl;
+        std::string key = cache.getKey("./testdata/test.mp3");
+        CHECK(!key.empty());
+        CHECK_EQ(key, cache.getKey("./testdata/test.mp3"));
+        std::string key2 = cache.getKey("./testdata/dead_rocks.mp3");
+        CHECK(!key2.empty());
+        CHECK(key != key2);
+        CHECK(cache.getKey("./testdata/does-not-exist.mp3").empty());
+        musicaccess::PCMCache otherSettingsCache("./pcmcache_test", 6000, "other settings");
+        CHECK(key != otherSettingsCache.getKey("./testdata/test.mp3"));
+        //changing a file changes its key, also when the change is not at the beginning.
+        std::string changingFilename = "./pcmcache_test/changing.dat";
+        std::string contents(200000, 'a');
+        std::ofstream changingFile(changingFilename.c_str(), std::ios::binary);
+        changingFile << contents;
+        changingFile.close();
+        std::string changingKey = cache.getKey(changingFilename);
+        CHECK(!changingKey.empty());
+        changingFile.open(changingFilename.c_str(), std::ios::binary | std::ios::app);
+        changingFile << "b";
+        changingFile.close();
+        CHECK(changingKey != cache.getKey(changingFilename));
+        std::remove(changingFilename.c_str());
+        
+        float* buffer = new float[1000];
+        for (int i=0; i<1000; i++)
+            buffer[i] = std::sin(i * 0.1);
+        
+        std::cerr << "storing and loading entries..." << std::endl;
+        CHECK(cache.store(key, buffer, 1000, 22050));
+        musicaccess::PCMCacheEntry* entry = cache.load(key);
+        CHECK(entry != NULL);
+        CHECK_EQ(entry->getSampleCount(), 1000u);
+        CHECK_EQ(entry->getSampleRate(), 22050u);
+        for (int i=0; i<1000; i++)
+            CHECK_EQ(entry->getSamples()[i], buffer[i]);
+        delete entry;
+        CHECK(cache.load(key2) == NULL);
+        CHECK(otherSettingsCache.load(otherSettingsCache.getKey("./testdata/test.mp3")) == NULL);
+        
+        std::cerr << "checking eviction..." << std::endl;
+        //16 bytes header
+        CHECK_EQ(cache.getCacheSize(), 16u + 4000u);
+        //the first entry is the least recently used one, so it will be evicted first.
+        CHECK(cache.store(key2, buffer, 1000, 22050));
+        CHECK_EQ(cache.getCacheSize(), 16u + 4000u);
+        CHECK(cache.load(key) == NULL);
+        entry = cache.load(key2);
+        CHECK(entry != NULL);
+        CHECK_EQ(entry->getSamples()[999], buffer[999]);
+        delete entry;
+        
+        //a new cache finds the entries in the directory.
+        musicaccess::PCMCache reopenedCache("./pcmcache_test", 6000);
+        CHECK_EQ(reopenedCache.getCacheSize(), 16u + 4000u);
+        entry = reopenedCache.load(key2);
+        CHECK(entry != NULL);
+        delete entry;
+        
+        delete[] buffer;
+        std::remove(("./pcmcache_test/" + key2 + ".pcm").c_str());
+        std::remove("./pcmcache_test");
+        
+        return EXIT_SUCCESS;
+    }
+    
+    int testFeatureVectorStore()
+    {
+        std::cerr << "creating stores..." << std::endl;
+        music::FeatureVectorStore store("./featurevectorstore_test");
+        CHECK_EQ(store.getStoreDirectory(), "./featurevectorstore_test/");
+        CHECK(!store.isHalfPrecision());
+        music::FeatureVectorStore halfStore("./featurevectorstore_test/", true);
+        CHECK(halfStore.isHalfPrecision());
+        
+        music::DataSet<kiss_fft_scalar> timbreVectors(20, 500);
+        for (int i=0; i<timbreVectors.size(); i++)
+            timbreVectors.data()[i] = 100.0 * std::sin(i * 0.1);
+        music::DataSet<kiss_fft_scalar> chromaVectors(12, 100);
+        for (int i=0; i<chromaVectors.size(); i++)
+            chromaVectors.data()[i] = std::cos(i * 0.3) * std::cos(i * 0.3);
+        
+        std::cerr << "storing and loading entries..." << std::endl;
+        music::DataSet<kiss_fft_scalar> loadedTimbreVectors;
+        music::DataSet<kiss_fft_scalar> loadedChromaVectors;
+        CHECK(!store.load(1, loadedTimbreVectors, loadedChromaVectors));
+        CHECK(store.store(1, timbreVectors, chromaVectors));
+        CHECK(store.load(1, loadedTimbreVectors, loadedChromaVectors));
+        CHECK_EQ(loadedTimbreVectors.getDimension(), 20);
+        CHECK_EQ(loadedTimbreVectors.getSize(), 500);
+        CHECK_EQ(loadedChromaVectors.getDimension(), 12);
+        CHECK_EQ(loadedChromaVectors.getSize(), 100);
+        CHECK(loadedTimbreVectors == timbreVectors);
+        CHECK(loadedChromaVectors == chromaVectors);
+        
+        std::cerr << "checking half precision..." << std::endl;
+        CHECK(halfStore.store(2, timbreVectors, chromaVectors));
+        //entries of both kinds can be read by both stores.
+        CHECK(store.load(2, loadedTimbreVectors, loadedChromaVectors));
+        CHECK_EQ(loadedTimbreVectors.getSize(), 500);
+        CHECK_EQ(loadedChromaVectors.getSize(), 100);
+        //11 significant bits
+        for (int i=0; i<timbreVectors.size(); i++)
+            CHECK_OP(std::fabs(loadedTimbreVectors.data()[i] - timbreVectors.data()[i]), <=, std::fabs(timbreVectors.data()[i]) / 2048.0 + 1e-7);
+        for (int i=0; i<chromaVectors.size(); i++)
+            CHECK_OP(std::fabs(loadedChromaVectors.data()[i] - chromaVectors.data()[i]), <=, std::fabs(chromaVectors.data()[i]) / 2048.0 + 1e-7);
+        //the half file is smaller.
+        struct stat singleStat;
+        struct stat halfStat;
+        CHECK_EQ(stat("./featurevectorstore_test/1.vec", &singleStat), 0);
+        CHECK_EQ(stat("./featurevectorstore_test/2.vec", &halfStat), 0);
+        CHECK_EQ(singleStat.st_size - 32, 2 * (halfStat.st_size - 32));
+        
+        std::cerr << "checking broken and deleted entries..." << std::endl;
+        FILE* file = fopen("./featurevectorstore_test/3.vec", "wb");
+        CHECK(file != NULL);
+        fwrite("LMFV", 1, 4, file);
+        fclose(file);
+        CHECK(!store.load(3, loadedTimbreVectors, loadedChromaVectors));
+        CHECK(store.remove(1));
+        CHECK(!store.load(1, loadedTimbreVectors, loadedChromaVectors));
+        CHECK(!store.remove(1));
+        
+        CHECK(store.remove(2));
+        CHECK(store.remove(3));
+        std::remove("./featurevectorstore_test");
         
         return EXIT_SUCCESS;
     }
@@ -702,6 +887,88 @@ namespace tests
         CHECK_EQ(gdc2.calculateValue( 1.0*Eigen::VectorXd::Identity(2, 1)), 0.096532352630054);
         CHECK_EQ(gdc2.calculateValue(-1.0*Eigen::VectorXd::Identity(2, 1)), 0.096532352630054);
         
+        DEBUG_OUT("testing log-densities...", 10);
+        music::GaussianFullCov<double> gfc2(2);
+        Eigen::MatrixXd cov(2, 2);
+        cov << 2.0, 0.5,
+               0.5, 1.0;
+        gfc2.setMean(Eigen::VectorXd::Ones(2));
+        gfc2.setCovarianceMatrix(cov);
+        gfc2.setWeight(0.5);
+        gdc2.setCovarianceMatrix(cov);
+        gdc2.setWeight(0.5);
+        music::Gaussian<double>* gaussians[] = {&gdc2, &gfc2};
+        Eigen::MatrixXd positions(2, 3);
+        positions << 0.0, 1.0, -2.0,
+                     0.0, 3.0,  0.5;
+        for (int g=0; g<2; g++)
+        {
+            Eigen::VectorXd logDensities;
+            gaussians[g]->logDensityBatch(positions, logDensities);
+            CHECK_EQ(logDensities.size(), 3);
+            for (int i=0; i<3; i++)
+            {
+                CHECK_EQ(gaussians[g]->logDensity(positions.col(i)), log(gaussians[g]->calculateValue(positions.col(i))));
+                CHECK_EQ(logDensities[i], gaussians[g]->logDensity(positions.col(i)));
+            }
+            //far away: the value underflows, the log-density does not.
+            Eigen::VectorXd farAway = Eigen::VectorXd::Constant(2, 100.0);
+            CHECK_EQ(gaussians[g]->calculateValue(farAway), 0.0);
+            CHECK_OP(gaussians[g]->logDensity(farAway), >, -1e5);
+        }
+        CHECK_EQ(gdc2.logDensity(Eigen::VectorXd::Zero(2)), log(0.5) - log(2*M_PI) - 0.5*log(2.0));
+        
+        DEBUG_OUT("testing diagonal gaussian against full gaussian with the same covariance matrix...", 10);
+        music::GaussianDiagCov<double> gdc3(3);
+        music::GaussianFullCov<double> gfc3(3);
+        Eigen::VectorXd mean3(3);
+        mean3 << 1.0, -2.0, 0.5;
+        Eigen::MatrixXd cov3 = Eigen::Vector3d(0.25, 4.0, 1.5).asDiagonal();
+        gdc3.setMean(mean3);
+        gdc3.setCovarianceMatrix(cov3);
+        gdc3.setWeight(0.3);
+        gfc3.setMean(mean3);
+        gfc3.setCovarianceMatrix(cov3);
+        gfc3.setWeight(0.3);
+        Eigen::VectorXd pos3(3);
+        pos3 << 0.0, 1.0, 2.0;
+        CHECK_EQ(gdc3.calculateValue(pos3), gfc3.calculateValue(pos3));
+        CHECK_EQ(gdc3.calculateValueWithoutWeights(pos3), gfc3.calculateValueWithoutWeights(pos3));
+        CHECK_EQ(gdc3.calculateNoMeanValue(pos3), gfc3.calculateNoMeanValue(pos3));
+        CHECK_EQ(gdc3.calculateDistance(pos3), gfc3.calculateDistance(pos3));
+        CHECK_EQ(gdc3.calculateDistance(pos3), sqrt(1.0/0.25 + 9.0/4.0 + 2.25/1.5));
+        
+        //samples need to have the variances of the diagonal.
+        Eigen::MatrixXd samples(3, 20000);
+        for (int i=0; i<samples.cols(); i++)
+            samples.col(i) = gdc3.rand();
+        Eigen::VectorXd sampleMean = samples.rowwise().sum() / samples.cols();
+        Eigen::VectorXd sampleVariance = (samples.colwise() - sampleMean).cwiseAbs2().rowwise().sum() / (samples.cols() - 1);
+        for (int i=0; i<3; i++)
+        {
+            CHECK_OP(fabs(sampleMean[i] - mean3[i]), <, 0.05);
+            CHECK_OP(fabs(sampleVariance[i] / cov3(i,i) - 1.0), <, 0.05);
+        }
+        
+        DEBUG_OUT("testing nearly singular diagonal gaussian...", 10);
+        //the determinant is below machine epsilon, the small variances are below dimension*epsilon.
+        music::GaussianDiagCov<float> gdc4(3);
+        gdc4.setMean(Eigen::VectorXf::Zero(3));
+        gdc4.setCovarianceMatrix(Eigen::Vector3f(1e-7f, 1e-7f, 1.0f).asDiagonal());
+        Eigen::VectorXf pos4 = Eigen::VectorXf::Zero(3);
+        pos4[0] = 3e-4f;
+        //the densities still divide by the small variances, like a LDLT solve does.
+        CHECK_EQ(gdc4.logDensity(pos4) - gdc4.logDensity(Eigen::VectorXf::Zero(3)), -0.45);
+        CHECK_EQ(gdc4.calculateValue(pos4) / gdc4.calculateValue(Eigen::VectorXf::Zero(3)), exp(-0.45));
+        Eigen::MatrixXf positions4(3, 1);
+        positions4.col(0) = pos4;
+        Eigen::VectorXd logDensities4;
+        gdc4.logDensityBatch(positions4, logDensities4);
+        CHECK_EQ(logDensities4[0], gdc4.logDensity(pos4));
+        //distances use the pseudoinverse, which ignores them.
+        CHECK_EQ(gdc4.calculateDistance(pos4), 0.0);
+        pos4[2] = 2.0f;
+        CHECK_EQ(gdc4.calculateDistance(pos4), 2.0);
         
         return EXIT_SUCCESS;
     }
@@ -6,6 +6,8 @@
 namespace tests
 {
     int testLibMusicAccess();
+    int testPCMCache();
+    int testFeatureVectorStore();
     int testEigen();
     int testFFT();
     int testDCT();
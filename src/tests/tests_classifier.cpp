@@ -205,6 +205,51 @@ namespace tests
         return EXIT_SUCCESS;
     }
     
+    /**
+     * @brief Draws the data vectors from randomly chosen gaussians.
+     */
+    class GaussianDataVectorGenerator : public music::DataVectorGenerator<kiss_fft_scalar>
+    {
+    private:
+        std::vector<music::GaussianDiagCov<kiss_fft_scalar>*> gaussians;
+    public:
+        GaussianDataVectorGenerator(const std::vector<music::GaussianDiagCov<kiss_fft_scalar>*>& gaussians) :
+            gaussians(gaussians)
+        {
+            
+        }
+        void generateDataVectors(music::DataSet<kiss_fft_scalar>& data, unsigned int count)
+        {
+            data.resize(gaussians[0]->getMean().size(), count);
+            for (unsigned int i=0; i<count; i++)
+                data.col(i) = gaussians[std::rand() % gaussians.size()]->rand();
+        }
+    };
+    
+    /**
+     * @brief Gives the tests access to the EM algorithm with chosen initial gaussians,
+     *      and to the steps of the online EM algorithm.
+     */
+    template <typename GMMType>
+    class InitializedGMM : public GMMType
+    {
+    public:
+        void trainGMM(const std::vector<music::Gaussian<kiss_fft_scalar>*>& init, const music::DataSet<kiss_fft_scalar>& data)
+        {
+            this->gaussians = this->emAlg(init, data, init.size(), this->getMaxIterations());
+        }
+        //the first step of trainGMMOnline() after the initial model.
+        void onlineStep(const music::DataSet<kiss_fft_scalar>& data, double minVariance = 0.1)
+        {
+            Eigen::Matrix<double, Eigen::Dynamic, 1> center = data.cast<double>().rowwise().mean();
+            std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> > statistics;
+            double loglike = this->calculateOnlineStatistics(data, center, minVariance, statistics);
+            for (unsigned int i=0; i<statistics.size(); i++)
+                statistics[i] /= data.cols();
+            this->setOnlineParameters(center, statistics, minVariance, loglike, data.cols());
+        }
+    };
+    
     int testGMM()
     {
         DEBUG_OUT("testing GMMs...", 0);
@@ -328,6 +373,439 @@ namespace tests
         CHECK(gmmptr != NULL);
         delete gmmptr;
         gmmptr = NULL;
+        
+        DEBUG_OUT("training best-of-four GMMs...", 10);
+        {
+            music::DataSet<kiss_fft_scalar> dataSet(data);
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> gmmBest;
+            gmmBest.trainGMMBestOf(dataSet, 3, 4, 2);
+            gaussians = gmmBest.getGaussians();
+            CHECK_EQ(gaussians.size(), 3u);
+            double weightSum = 0.0;
+            for (unsigned int g=0; g<gaussians.size(); g++)
+                weightSum += gaussians[g]->getWeight();
+            CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+            CHECK(gmmBest.getModelLogLikelihood() == gmmBest.getModelLogLikelihood());
+            CHECK_OP(gmmBest.calculateValue(gmmBest.rand()), >, 0);
+            
+            //with one thread, the result only depends on the seed. the first
+            //restart is never abandoned, and it is the same as a single restart.
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> gmmA;
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> gmmB;
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> gmmSingle;
+            srand(42);
+            gmmA.trainGMMBestOf(dataSet, 3, 4, 1);
+            srand(42);
+            gmmB.trainGMMBestOf(dataSet, 3, 4, 1);
+            srand(42);
+            gmmSingle.trainGMMBestOf(dataSet, 3, 1, 1);
+            CHECK_EQ(gmmA.getModelLogLikelihood(), gmmB.getModelLogLikelihood());
+            CHECK_OP(gmmA.getModelLogLikelihood(), >=, gmmSingle.getModelLogLikelihood());
+        }
+        
+        DEBUG_OUT("training diagonal GMMs far away from the origin...", 10);
+        {
+            //EM does not depend on where the data is, so moving the data
+            //should move the means and keep everything else.
+            music::DataSet<kiss_fft_scalar> nearData(data);
+            music::DataSet<kiss_fft_scalar> farData((nearData.array() + 10000.0).matrix());
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> nearGMM;
+            music::GaussianMixtureModelDiagCov<kiss_fft_scalar> farGMM;
+            srand(23);
+            nearGMM.trainGMM(nearData, 3);
+            srand(23);
+            farGMM.trainGMM(farData, 3);
+            CHECK_OP(fabs(nearGMM.getModelLogLikelihood() - farGMM.getModelLogLikelihood()), <, 1e-4 * fabs(nearGMM.getModelLogLikelihood()));
+            std::vector<music::Gaussian<kiss_fft_scalar>*> nearGaussians = nearGMM.getGaussians();
+            std::vector<music::Gaussian<kiss_fft_scalar>*> farGaussians = farGMM.getGaussians();
+            CHECK_EQ(nearGaussians.size(), farGaussians.size());
+            for (unsigned int g=0; g<nearGaussians.size(); g++)
+            {
+                CHECK_OP(fabs(nearGaussians[g]->getWeight() - farGaussians[g]->getWeight()), <, 1e-4);
+                for (unsigned int i=0; i<dimension; i++)
+                {
+                    CHECK_OP(fabs(farGaussians[g]->getMean()[i] - nearGaussians[g]->getMean()[i] - 10000.0), <, 0.1);
+                    CHECK_OP(fabs(farGaussians[g]->getCovarianceMatrix()(i, i) / nearGaussians[g]->getCovarianceMatrix()(i, i) - 1.0), <, 1e-3);
+                }
+            }
+        }
+        DEBUG_OUT("training GMMs with a gaussian no data vector is close to...", 10);
+        {
+            music::DataSet<kiss_fft_scalar> dataSet(data);
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> farMean = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>::Constant(dimension, 1e5);
+            std::vector<music::Gaussian<kiss_fft_scalar>*> init;
+            init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, mu1));
+            init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, mu2));
+            init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, mu3));
+            init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, farMean));
+            init[0]->setCovarianceMatrix(cov1.asDiagonal());
+            init[1]->setCovarianceMatrix(cov2.asDiagonal());
+            init[2]->setCovarianceMatrix(cov3.asDiagonal());
+            
+            InitializedGMM<music::GaussianMixtureModelDiagCov<kiss_fft_scalar> > diagGMM;
+            InitializedGMM<music::GaussianMixtureModelFullCov<kiss_fft_scalar> > fullGMM;
+            InitializedGMM<music::GaussianMixtureModelDiagCov<kiss_fft_scalar> > acceleratedDiagGMM;
+            InitializedGMM<music::GaussianMixtureModelFullCov<kiss_fft_scalar> > acceleratedFullGMM;
+            acceleratedDiagGMM.setEMAcceleration(true);
+            acceleratedFullGMM.setEMAcceleration(true);
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {&diagGMM, &fullGMM, &acceleratedDiagGMM, &acceleratedFullGMM};
+            diagGMM.trainGMM(init, dataSet);
+            fullGMM.trainGMM(init, dataSet);
+            acceleratedDiagGMM.trainGMM(init, dataSet);
+            acceleratedFullGMM.trainGMM(init, dataSet);
+            for (int m=0; m<4; m++)
+            {
+                //the far gaussian keeps its parameters and a small weight, the others are not affected.
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = models[m]->getGaussians();
+                CHECK_EQ(gaussians.size(), 4u);
+                CHECK(gaussians[3]->getMean() == farMean);
+                CHECK(gaussians[3]->getCovarianceMatrix() == init[3]->getCovarianceMatrix());
+                CHECK_OP(gaussians[3]->getWeight(), >, 0.0);
+                CHECK_OP(gaussians[3]->getWeight(), <, 1e-6);
+                double weightSum = 0.0;
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    weightSum += gaussians[g]->getWeight();
+                CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+                CHECK(models[m]->getModelLogLikelihood() == models[m]->getModelLogLikelihood());
+                for (int g=0; g<3; g++)
+                {
+                    CHECK(gaussians[g]->getMean() == gaussians[g]->getMean());
+                    CHECK_OP((gaussians[g]->getMean() - init[g]->getMean()).norm() / init[g]->getMean().norm(), <, 0.25);
+                }
+                for (unsigned int i=0; i<data.size(); i++)
+                    CHECK_OP(models[m]->logDensity(data[i]), >, -1e5);
+            }
+            for (unsigned int g=0; g<init.size(); g++)
+                delete init[g];
+        }
+        DEBUG_OUT("training GMMs with several threads...", 10);
+        {
+            //the data is split into blocks that do not depend on the number of threads,
+            //so the models need to be exactly the same.
+            music::DataSet<kiss_fft_scalar> bigData(dimension, 6000);
+            for (int i=0; i<bigData.cols(); i+=3)
+            {
+                bigData.col(i) = gdc1.rand();
+                bigData.col(i+1) = gdc2.rand();
+                bigData.col(i+2) = gdc3.rand();
+            }
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(),
+                new music::GaussianMixtureModelFullCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<4; m+=2)
+            {
+                models[m+1]->setThreadCount(3);
+                CHECK_EQ(models[m+1]->getThreadCount(), 3u);
+                srand(7);
+                models[m]->trainGMM(bigData, 3);
+                srand(7);
+                models[m+1]->trainGMM(bigData, 3);
+                CHECK_EQ(models[m]->getModelLogLikelihood(), models[m+1]->getModelLogLikelihood());
+                std::vector<music::Gaussian<kiss_fft_scalar>*> singleGaussians = models[m]->getGaussians();
+                std::vector<music::Gaussian<kiss_fft_scalar>*> multiGaussians = models[m+1]->getGaussians();
+                CHECK_EQ(singleGaussians.size(), multiGaussians.size());
+                for (unsigned int g=0; g<singleGaussians.size(); g++)
+                {
+                    CHECK_EQ(singleGaussians[g]->getWeight(), multiGaussians[g]->getWeight());
+                    CHECK(singleGaussians[g]->getMean() == multiGaussians[g]->getMean());
+                    CHECK(singleGaussians[g]->getCovarianceMatrix() == multiGaussians[g]->getCovarianceMatrix());
+                }
+                delete models[m];
+                delete models[m+1];
+            }
+        }
+        DEBUG_OUT("training GMMs starting from k-means clusters, with plain and accelerated EM...", 10);
+        {
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>(),
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<4; m++)
+            {
+                CHECK_EQ(models[m]->getInitMethod(), music::GMM_INIT_RANDOM);
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                CHECK_EQ(models[m]->getInitMethod(), music::GMM_INIT_KMEANS);
+                CHECK(!models[m]->getEMAcceleration());
+                CHECK_EQ(models[m]->getMaxIterations(), 10u);
+                CHECK_EQ(models[m]->getIterationCount(), 0u);
+                if (m >= 2)
+                {
+                    models[m]->setEMAcceleration(true);
+                    CHECK(models[m]->getEMAcceleration());
+                    models[m]->setMaxIterations(100);
+                }
+                models[m]->trainGMM(data, 3);
+                CHECK_OP(models[m]->getIterationCount(), >, 0u);
+                CHECK_OP(models[m]->getIterationCount(), <=, models[m]->getMaxIterations());
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = models[m]->getGaussians();
+                CHECK_EQ(gaussians.size(), 3u);
+                
+                //every true mean needs to be found by one of the gaussians. there are only
+                //a few vectors per cluster, so the estimated means are not that exact.
+                Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>* trueMeans[] = {&mu1, &mu2, &mu3};
+                double weightSum = 0.0;
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    weightSum += gaussians[g]->getWeight();
+                CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+                for (int i=0; i<3; i++)
+                {
+                    bool found = false;
+                    for (unsigned int g=0; g<gaussians.size(); g++)
+                        found = found || ((gaussians[g]->getMean() - *trueMeans[i]).norm() / trueMeans[i]->norm() < 0.25);
+                    CHECK(found);
+                }
+                delete models[m];
+            }
+        }
+        DEBUG_OUT("training GMMs with the online EM algorithm...", 10);
+        {
+            std::vector<music::GaussianDiagCov<kiss_fft_scalar>*> trueGaussians;
+            trueGaussians.push_back(&gdc1);
+            trueGaussians.push_back(&gdc2);
+            trueGaussians.push_back(&gdc3);
+            GaussianDataVectorGenerator generator(trueGaussians);
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>* trueMeans[] = {&mu1, &mu2, &mu3};
+            
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<2; m++)
+            {
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                //20 batches, the last one is smaller.
+                models[m]->trainGMMOnline(generator, 3, 9500, 500);
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = models[m]->getGaussians();
+                CHECK_EQ(gaussians.size(), 3u);
+                
+                double weightSum = 0.0;
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    weightSum += gaussians[g]->getWeight();
+                CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+                CHECK(models[m]->getModelLogLikelihood() == models[m]->getModelLogLikelihood());
+                for (int i=0; i<3; i++)
+                {
+                    bool found = false;
+                    for (unsigned int g=0; g<gaussians.size(); g++)
+                        found = found || ((gaussians[g]->getMean() - *trueMeans[i]).norm() / trueMeans[i]->norm() < 0.05);
+                    CHECK(found);
+                }
+                delete models[m];
+            }
+            
+            //a gaussian no data vector is close to gets no responsibility in the first online step.
+            music::DataSet<kiss_fft_scalar> batch;
+            generator.generateDataVectors(batch, 500);
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> farMean = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>::Constant(dimension, 1e5);
+            std::vector<music::Gaussian<kiss_fft_scalar>*> init;
+            for (int i=0; i<3; i++)
+                init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, *trueMeans[i]));
+            init.push_back(new music::GaussianDiagCov<kiss_fft_scalar>(0.25, farMean));
+            InitializedGMM<music::GaussianMixtureModelDiagCov<kiss_fft_scalar> > diagGMM;
+            InitializedGMM<music::GaussianMixtureModelFullCov<kiss_fft_scalar> > fullGMM;
+            diagGMM.trainGMM(init, batch);
+            fullGMM.trainGMM(init, batch);
+            generator.generateDataVectors(batch, 500);
+            diagGMM.onlineStep(batch);
+            fullGMM.onlineStep(batch);
+            music::GaussianMixtureModel<kiss_fft_scalar>* onlineModels[] = {&diagGMM, &fullGMM};
+            for (int m=0; m<2; m++)
+            {
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = onlineModels[m]->getGaussians();
+                CHECK_EQ(gaussians.size(), 4u);
+                CHECK(gaussians[3]->getMean() == farMean);
+                CHECK_OP(gaussians[3]->getWeight(), >, 0.0);
+                CHECK_OP(gaussians[3]->getWeight(), <, 1e-6);
+                double weightSum = 0.0;
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    weightSum += gaussians[g]->getWeight();
+                CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+                CHECK(onlineModels[m]->getModelLogLikelihood() == onlineModels[m]->getModelLogLikelihood());
+                for (int i=0; i<batch.cols(); i++)
+                    CHECK_OP(onlineModels[m]->logDensity(batch.col(i)), >, -1e5);
+            }
+            for (unsigned int g=0; g<init.size(); g++)
+                delete init[g];
+        }
+        DEBUG_OUT("building GMMs by merging the gaussians of other GMMs...", 10);
+        {
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>* trueMeans[] = {&mu1, &mu2, &mu3};
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            music::GaussianMixtureModel<kiss_fft_scalar>* reducedModels[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<2; m++)
+            {
+                CHECK_EQ(models[m]->isFullCov(), (m == 1));
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                models[m]->trainGMM(data, 3);
+                
+                //two copies of the same model: the pairs of equal gaussians need to be merged first.
+                std::vector<music::GaussianMixtureModel<kiss_fft_scalar>*> components;
+                components.push_back(models[m]);
+                components.push_back(models[m]);
+                reducedModels[m]->trainGMMFromModels(components, 3);
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = reducedModels[m]->getGaussians();
+                CHECK_EQ(gaussians.size(), 3u);
+                double weightSum = 0.0;
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    weightSum += gaussians[g]->getWeight();
+                CHECK_OP(fabs(weightSum - 1.0), <, 1e-3);
+                for (int i=0; i<3; i++)
+                {
+                    bool found = false;
+                    for (unsigned int g=0; g<gaussians.size(); g++)
+                        found = found || ((gaussians[g]->getMean() - *trueMeans[i]).norm() / trueMeans[i]->norm() < 0.25);
+                    CHECK(found);
+                }
+                CHECK_OP(reducedModels[m]->calculateValue(mu2), >, 0);
+                
+                //one gaussian is left: it has the mean and covariance of the whole mixture.
+                reducedModels[m]->trainGMMFromModels(components, 1);
+                CHECK_EQ(reducedModels[m]->getGaussians().size(), 1u);
+                gaussians = models[m]->getGaussians();
+                Eigen::VectorXd mean = Eigen::VectorXd::Zero(dimension);
+                Eigen::MatrixXd cov = Eigen::MatrixXd::Zero(dimension, dimension);
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    mean += gaussians[g]->getWeight() * gaussians[g]->getMean().cast<double>();
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                {
+                    Eigen::VectorXd diff = gaussians[g]->getMean().cast<double>() - mean;
+                    cov += gaussians[g]->getWeight() * (gaussians[g]->getCovarianceMatrix().cast<double>() + diff * diff.transpose());
+                }
+                if (m == 0)
+                    cov = Eigen::MatrixXd(cov.diagonal().asDiagonal());
+                music::Gaussian<kiss_fft_scalar>* merged = reducedModels[m]->getGaussians()[0];
+                CHECK_OP((merged->getMean().cast<double>() - mean).norm() / mean.norm(), <, 1e-3);
+                CHECK_OP((merged->getCovarianceMatrix().cast<double>() - cov).norm() / cov.norm(), <, 1e-3);
+                CHECK_OP(fabs(merged->getWeight() - 1.0), <, 1e-3);
+                
+                delete models[m];
+                delete reducedModels[m];
+            }
+        }
+        DEBUG_OUT("comparing GMMs with the closed-form approximations of the divergence...", 10);
+        {
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<2; m++)
+            {
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                models[m]->trainGMM(data, 3);
+                music::GaussianMixtureModel<kiss_fft_scalar>* shifted = models[m]->clone();
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = shifted->getGaussians();
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    gaussians[g]->setMean(gaussians[g]->getMean() * 1.05);
+                
+                //equal models have no divergence.
+                CHECK_OP(fabs(models[m]->compareTo(*models[m], music::GMM_DIVERGENCE_VARIATIONAL)), <, 1e-6);
+                CHECK_OP(fabs(models[m]->compareTo(*models[m], music::GMM_DIVERGENCE_MATCHED_PAIR)), <, 1e-6);
+                CHECK_OP(fabs(models[m]->compareTo(*models[m], music::GMM_DIVERGENCE_SYMMETRIC_VARIATIONAL)), <, 1e-6);
+                
+                //the clusters are far apart, so the approximations are close to the sampled divergence.
+                double sampled = models[m]->compareTo(*shifted, 20000);
+                double variational = models[m]->compareTo(*shifted, music::GMM_DIVERGENCE_VARIATIONAL);
+                double matchedPair = models[m]->compareTo(*shifted, music::GMM_DIVERGENCE_MATCHED_PAIR);
+                DEBUG_VAR_OUT(sampled, 0);
+                DEBUG_VAR_OUT(variational, 0);
+                DEBUG_VAR_OUT(matchedPair, 0);
+                CHECK_OP(sampled, >, 0.0);
+                CHECK_OP(fabs(variational - sampled) / sampled, <, 0.1);
+                CHECK_OP(fabs(matchedPair - sampled) / sampled, <, 0.1);
+                CHECK_OP(fabs(models[m]->compareTo(*shifted, music::GMM_DIVERGENCE_SYMMETRIC_VARIATIONAL)
+                    - variational - shifted->compareTo(*models[m], music::GMM_DIVERGENCE_VARIATIONAL)), <, 1e-3 * variational);
+                //deterministic
+                CHECK_EQ(models[m]->compareTo(*shifted, music::GMM_DIVERGENCE_VARIATIONAL), variational);
+                
+                delete shifted;
+                delete models[m];
+            }
+        }
+        DEBUG_OUT("calculating log-densities of GMMs...", 10);
+        {
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            music::DataSet<kiss_fft_scalar> positions(data);
+            for (int m=0; m<2; m++)
+            {
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                models[m]->trainGMM(data, 3);
+                Eigen::Matrix<double, Eigen::Dynamic, 1> logDensities;
+                models[m]->logDensityBatch(positions, logDensities);
+                CHECK_EQ(logDensities.size(), positions.getSize());
+                for (int i=0; i<positions.getSize(); i++)
+                {
+                    CHECK_OP(fabs(logDensities[i] - models[m]->logDensity(positions.col(i))), <, 1e-3);
+                    CHECK_OP(fabs(logDensities[i] - log(models[m]->calculateValue(positions.col(i)))), <, 1e-3);
+                }
+                //the log-likelihood of the EM algorithm belongs to the model before its last step,
+                //which does not make it worse. it includes the weights of the gaussians.
+                double logDensitySum = logDensities.sum();
+                CHECK_OP(models[m]->getModelLogLikelihood(), <=, logDensitySum + 1e-4 * fabs(logDensitySum));
+                
+                //far away from all gaussians
+                Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> farAway = 100.0 * mu3;
+                CHECK_EQ(models[m]->calculateValue(farAway), 0.0);
+                CHECK_OP(models[m]->logDensity(farAway), >, -std::numeric_limits<double>::infinity());
+                CHECK_OP(models[m]->logDensity(farAway), <, -100.0);
+                delete models[m];
+            }
+        }
+        DEBUG_OUT("comparing GMMs with shared sample sets...", 10);
+        {
+            music::GaussianMixtureModel<kiss_fft_scalar>* models[] = {
+                new music::GaussianMixtureModelDiagCov<kiss_fft_scalar>(), new music::GaussianMixtureModelFullCov<kiss_fft_scalar>()};
+            for (int m=0; m<2; m++)
+            {
+                models[m]->setInitMethod(music::GMM_INIT_KMEANS);
+                models[m]->trainGMM(data, 3);
+                music::GaussianMixtureModel<kiss_fft_scalar>* shifted = models[m]->clone();
+                std::vector<music::Gaussian<kiss_fft_scalar>*> gaussians = shifted->getGaussians();
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    gaussians[g]->setMean(gaussians[g]->getMean() * 1.05);
+                std::vector<music::GaussianMixtureModel<kiss_fft_scalar>*> others;
+                others.push_back(shifted);
+                others.push_back(models[m]);
+                double sampled = models[m]->compareTo(*shifted, 20000);
+                
+                music::GMM_SAMPLING_METHOD methods[] = {music::GMM_SAMPLING_RANDOM, music::GMM_SAMPLING_STRATIFIED, music::GMM_SAMPLING_QUASIRANDOM};
+                for (int i=0; i<3; i++)
+                {
+                    music::GMMSampleSet<kiss_fft_scalar> samples(*models[m], 5000, methods[i]);
+                    CHECK_EQ(samples.getSampleCount(), 5000u);
+                    CHECK_EQ(samples.getSamples().getDimension(), int(dimension));
+                    
+                    std::vector<kiss_fft_scalar> divergences;
+                    samples.compareTo(others, divergences);
+                    CHECK_EQ(divergences.size(), 2u);
+                    CHECK_EQ(divergences[0], samples.compareTo(*shifted));
+                    CHECK_OP(fabs(divergences[1]), <, 1e-6);
+                    DEBUG_VAR_OUT(divergences[0], 0);
+                    //the random estimates have a standard deviation of about 3%.
+                    double threshold = (methods[i] == music::GMM_SAMPLING_QUASIRANDOM) ? 0.05 : 0.15;
+                    CHECK_OP(fabs(divergences[0] - sampled) / sampled, <, threshold);
+                }
+                
+                //the quasi-random samples are always the same.
+                music::GMMSampleSet<kiss_fft_scalar> samples1(*models[m], 100, music::GMM_SAMPLING_QUASIRANDOM);
+                music::GMMSampleSet<kiss_fft_scalar> samples2(*models[m], 100, music::GMM_SAMPLING_QUASIRANDOM);
+                CHECK_EQ(samples1.compareTo(*shifted), samples2.compareTo(*shifted));
+                
+                //far away from all samples, the log-densities are clamped at -100.
+                music::GaussianMixtureModel<kiss_fft_scalar>* farAway = models[m]->clone();
+                gaussians = farAway->getGaussians();
+                for (unsigned int g=0; g<gaussians.size(); g++)
+                    gaussians[g]->setMean(gaussians[g]->getMean().array() + 1000.0);
+                Eigen::Matrix<double, Eigen::Dynamic, 1> logDensities;
+                models[m]->logDensityBatch(samples1.getSamples(), logDensities);
+                double clampedSum = 0.0;
+                for (int i=0; i<logDensities.size(); i++)
+                    clampedSum += std::max(logDensities[i], -100.0);
+                CHECK_OP(fabs(samples1.compareTo(*farAway) - (clampedSum / logDensities.size() + 100.0)), <, 1e-3);
+                CHECK_OP(models[m]->compareTo(*farAway, 1000), <, 1000.0);
+                delete farAway;
+                
+                delete shifted;
+                delete models[m];
+            }
+        }
         gmmptr = gmm2.clone();
         CHECK(gmmptr != NULL);
         delete gmmptr;
@@ -553,10 +1031,30 @@ namespace tests
         CHECK( ((means1[0] - mu1).norm() / mu1.norm() < 10e-1) || ((means1[0] - mu2).norm() / mu2.norm() < 10e-1));
         CHECK( ((means1[1] - mu1).norm() / mu1.norm() < 10e-1) || ((means1[1] - mu2).norm() / mu2.norm() < 10e-1));
         
+        DEBUG_OUT("running k-means on the same data in a contiguous data set...", 0);
+        music::DataSet<double> dataSet(data);
+        CHECK_EQ(dataSet.getSize(), dataCount);
+        CHECK_EQ(dataSet.getDimension(), dimension);
+        std::vector<Eigen::VectorXd> dataCopy;
+        dataSet.toVectors(dataCopy);
+        CHECK_EQ(dataCopy.size(), data.size());
+        for (unsigned int i=0; i<data.size(); i++)
+            CHECK(dataCopy[i] == data[i]);
+        //same random numbers, so the results need to be equal.
+        std::srand(42);
+        CHECK(kmeans.trainKMeans(data, 2, 100));
+        std::vector<Eigen::VectorXd> meansVector = kmeans.getMeans();
+        std::srand(42);
+        CHECK(kmeans.trainKMeans(dataSet, 2, 100));
+        std::vector<Eigen::VectorXd> meansDataSet = kmeans.getMeans();
+        CHECK_EQ(meansVector.size(), meansDataSet.size());
+        for (unsigned int i=0; i<meansVector.size(); i++)
+            CHECK(meansVector[i] == meansDataSet[i]);
+        
         DEBUG_OUT("running k-means with generated data and 2 means, better initial guesses...", 0);
         std::vector<Eigen::VectorXd> init;
         kmeans.calculateInitGuess(data, init, 2);
-        CHECK(kmeans.trainKMeans(data, 2, 100));
+        CHECK(kmeans.trainKMeans(data, 2, 100, false, init));
         std::vector<Eigen::VectorXd> means1x = kmeans.getMeans();
         DEBUG_VAR_OUT(means1x[0], 0);
         DEBUG_VAR_OUT(means1x[1], 0);
@@ -2,6 +2,7 @@
 #include "testframework.hpp"
 
 #include "sqlitedatabaseconnection.hpp"
+#include <sqlite3.h>
 #include <dirent.h>
 
 #include <iostream>
@@ -10,6 +11,10 @@
 #include <unistd.h>
 
 #include "preprocessor.hpp"
+#include "feature_vector_store.hpp"
+#include "gmm.hpp"
+#include <cmath>
+#include <cstdio>
 
 namespace tests
 {
@@ -126,11 +131,22 @@ namespace tests
                 CHECK_EQ(recording->getRecordingFeatures()->getLength(), 25.0);
                 recording->getRecordingFeatures()->setTempo(80.0);
                 CHECK_EQ(recording->getRecordingFeatures()->getTempo(), 80.0);
+                CHECK(!recording->getRecordingFeatures()->isPreview());
+                recording->getRecordingFeatures()->setPreview(true);
                 CHECK(conn->updateRecordingByID(*recording, true));
                 recording->setAlbum("lalalala");
+                recording->getRecordingFeatures()->setPreview(false);
                 
                 CHECK(conn->getRecordingByID(*recording, true));
                 CHECK_OP(recording->getAlbum(), ==, std::string("unknownAlbum"));
+                CHECK(recording->getRecordingFeatures()->isPreview());
+                
+                std::vector<music::databaseentities::id_datatype> previewRecordingIDs;
+                CHECK(conn->getPreviewRecordingIDs(previewRecordingIDs, recording->getID(), 1));
+                CHECK_EQ(previewRecordingIDs.size(), 1u);
+                
+                recording->getRecordingFeatures()->setPreview(false);
+                CHECK(conn->updateRecordingByID(*recording, true));
                 
                 music::databaseentities::id_datatype recordingID = -1;
                 CHECK(conn->getRecordingIDByFilename(recordingID, recording->getFilename()));
@@ -376,6 +392,37 @@ namespace tests
         CHECK_EQ(recordingIDs.size(), 21u);
         
         CHECK(conn->close());
+        
+        DEBUG_OUT("testing database created before the preview flag was added...", 10);
+        unlink("test_old.db");
+        CHECK(conn->open("test_old.db"));
+        CHECK(conn->close());
+        sqlite3* oldDB = NULL;
+        CHECK_EQ(sqlite3_open("test_old.db", &oldDB), SQLITE_OK);
+        CHECK_EQ(sqlite3_exec(oldDB, "DROP TABLE features;", NULL, NULL, NULL), SQLITE_OK);
+        CHECK_EQ(sqlite3_exec(oldDB, "CREATE TABLE features(featuresID INTEGER PRIMARY KEY, length REAL, "
+            "tempo REAL, dynamicrange REAL, timbreModel TEXT, chromaModel TEXT);", NULL, NULL, NULL), SQLITE_OK);
+        CHECK_EQ(sqlite3_exec(oldDB, "INSERT INTO features VALUES(1, 20.0, 120.0, 0.5, '', '');", NULL, NULL, NULL), SQLITE_OK);
+        sqlite3_close(oldDB);
+        
+        CHECK(conn->open("test_old.db"));
+        music::databaseentities::RecordingFeatures oldFeatures;
+        oldFeatures.setID(1);
+        CHECK(conn->getRecordingFeaturesByID(oldFeatures));
+        CHECK_EQ(oldFeatures.getID(), 1);
+        CHECK(!oldFeatures.isPreview());
+        
+        music::databaseentities::Recording newRecording("new.mp3");
+        CHECK(conn->addRecording(newRecording));
+        CHECK_OP(newRecording.getID(), !=, -1);
+        newRecording.getRecordingFeatures()->setPreview(true);
+        CHECK(conn->updateRecordingByID(newRecording, true));
+        newRecording.getRecordingFeatures()->setPreview(false);
+        CHECK(conn->getRecordingByID(newRecording, true));
+        CHECK(newRecording.getRecordingFeatures() != NULL);
+        CHECK(newRecording.getRecordingFeatures()->isPreview());
+        CHECK(conn->close());
+        
         return EXIT_SUCCESS;
     }
     
@@ -439,4 +486,69 @@ namespace tests
         
         return EXIT_FAILURE;    //TEST NOT FINISHED YET
     }
+    
+    int testRemodelRecording()
+    {
+        music::SQLiteDatabaseConnection* conn = new music::SQLiteDatabaseConnection();
+        
+        DEBUG_OUT("removing file \"remodel.db\"...", 10);
+        unlink("remodel.db");  //POSIX standard call
+        CHECK(conn->open("remodel.db"));
+        
+        music::databaseentities::Recording recording("remodel.mp3");
+        CHECK(conn->addRecording(recording));
+        CHECK_OP(recording.getID(), !=, -1);
+        CHECK(recording.getRecordingFeatures() != NULL);
+        recording.getRecordingFeatures()->setLength(30.0);
+        CHECK(conn->updateRecordingByID(recording, true));
+        
+        //timbre vectors with more dimensions than needed, chroma vectors in three groups.
+        music::DataSet<kiss_fft_scalar> timbreVectors(24, 600);
+        for (int i=0; i<timbreVectors.size(); i++)
+            timbreVectors.data()[i] = 100.0 * std::sin(i * 0.1) + (i % 7);
+        music::DataSet<kiss_fft_scalar> chromaVectors(12, 300);
+        for (int i=0; i<chromaVectors.size(); i++)
+            chromaVectors.data()[i] = ((i / 12) % 3 == (i % 12) % 3 ? 1.0 : 0.1) + 0.05 * std::cos(i * 0.7);
+        
+        music::FilePreprocessor preprop(conn, 4, 20, 0.01, 3);
+        CHECK(!preprop.remodelRecording(recording.getID()));
+        
+        music::FeatureVectorStore store("./remodel_test");
+        preprop.setFeatureVectorStore(&store);
+        CHECK(preprop.getFeatureVectorStore() == &store);
+        CHECK(!preprop.remodelRecording(recording.getID()));
+        CHECK(store.store(recording.getID(), timbreVectors, chromaVectors));
+        
+        DEBUG_OUT("recalculating the models from the stored vectors...", 10);
+        CHECK(preprop.remodelRecording(recording.getID()));
+        
+        CHECK(conn->getRecordingByID(recording, true));
+        CHECK(recording.getRecordingFeatures() != NULL);
+        CHECK_EQ(recording.getRecordingFeatures()->getLength(), 30.0);
+        CHECK(!recording.getRecordingFeatures()->getTimbreModel().empty());
+        CHECK(!recording.getRecordingFeatures()->getChromaModel().empty());
+        
+        music::GaussianMixtureModel<kiss_fft_scalar>* timbreModel = music::GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(recording.getRecordingFeatures()->getTimbreModel());
+        CHECK(timbreModel != NULL);
+        CHECK_EQ(timbreModel->getGaussians().size(), 4u);
+        CHECK_EQ(timbreModel->getGaussians()[0]->getMean().size(), 20);
+        music::GaussianMixtureModel<kiss_fft_scalar>* chromaModel = music::GaussianMixtureModel<kiss_fft_scalar>::loadFromJSONString(recording.getRecordingFeatures()->getChromaModel());
+        CHECK(chromaModel != NULL);
+        CHECK_EQ(chromaModel->getGaussians().size(), 3u);
+        CHECK_EQ(chromaModel->getGaussians()[0]->getMean().size(), 12);
+        delete timbreModel;
+        delete chromaModel;
+        
+        DEBUG_OUT("checking timbre vectors with too few dimensions...", 10);
+        music::DataSet<kiss_fft_scalar> shortTimbreVectors(timbreVectors.topRows(10));
+        CHECK(store.store(recording.getID(), shortTimbreVectors, chromaVectors));
+        CHECK(!preprop.remodelRecording(recording.getID()));
+        
+        CHECK(store.remove(recording.getID()));
+        std::remove("./remodel_test");
+        CHECK(conn->close());
+        delete conn;
+        
+        return EXIT_SUCCESS;
+    }
 }
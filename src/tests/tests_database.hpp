@@ -11,6 +11,9 @@ namespace tests
     /** @ingroup tests
      */
     int testPreprocessFiles(const std::string& path);
+    /** @ingroup tests
+     */
+    int testRemodelRecording();
     
 }
 
@@ -2,6 +2,7 @@
 
 #include "testframework.hpp"
 #include <cstdlib>
+#include <cmath>
 
 #include <musicaccess.hpp>
 #include <Eigen/Dense>
@@ -16,6 +17,8 @@
 #include "bpm.hpp"
 #include "chroma.hpp"
 #include "timbre.hpp"
+#include "fused_extraction.hpp"
+#include "adaptive_slicing.hpp"
 #include "gmm.hpp"
 #include "kmeans.hpp"
 
@@ -43,6 +46,49 @@ namespace tests
     
     int testEstimateBPM()
     {
+        DEBUG_OUT("comparing autocorrelation with direct calculation...", 10);
+        {
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> signal(1000);
+            for (int i=0; i<signal.size(); i++)
+                signal[i] = sin(i * 0.3) + 0.5 * (double(std::rand() % 1000) / 1000.0 - 0.5);
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> autoCorr;
+            music::BPMEstimator<kiss_fft_scalar>::calculateAutoCorrelation(signal, 600, autoCorr);
+            CHECK_EQ(autoCorr.size(), 600);
+            for (int shift=0; shift<autoCorr.size(); shift++)
+            {
+                double corr=0.0;
+                for (int i=0; i+shift<signal.size(); i++)
+                    corr += signal[i] * signal[i+shift];
+                CHECK_OP(fabs(autoCorr[shift] - corr), <, 1e-4 * autoCorr[0]);
+            }
+        }
+        
+        DEBUG_OUT("estimating tempo of a stream with a tempo change...", 10);
+        {
+            music::StreamingBPMEstimator<kiss_fft_scalar> bpmEst(0.01, 20.0, 6.0);
+            CHECK(!bpmEst.estimateBPM());
+            
+            //60 seconds with 120bpm (one beat every 50 values)...
+            for (int i=0; i<6000; i++)
+                bpmEst.addValue(((i % 50) < 3 ? 1.0 : 0.0) + 0.1 * (double(std::rand() % 1000) / 1000.0 - 0.5));
+            CHECK(bpmEst.estimateBPM());
+            DEBUG_OUT("bpm mean: " << bpmEst.getBPMMean(), 10);
+            CHECK_OP(bpmEst.getBPMMean(), >, 115);
+            CHECK_OP(bpmEst.getBPMMean(), <, 125);
+            
+            //...followed by 30 seconds with 90bpm (one beat every 67 values).
+            for (int i=0; i<3000; i++)
+                bpmEst.addValue(((i % 67) < 3 ? 1.0 : 0.0) + 0.1 * (double(std::rand() % 1000) / 1000.0 - 0.5));
+            CHECK(bpmEst.estimateBPM());
+            DEBUG_OUT("bpm mean: " << bpmEst.getBPMMean(), 10);
+            CHECK_OP(bpmEst.getBPMMean(), >, 85);
+            CHECK_OP(bpmEst.getBPMMean(), <, 95);
+            CHECK_EQ(bpmEst.getValueCount(), 9000);
+            
+            bpmEst.reset();
+            CHECK(!bpmEst.estimateBPM());
+        }
+        
         music::ConstantQTransform* cqt = NULL;
         musicaccess::IIRFilter* lowpassFilter = NULL;
         
@@ -331,6 +377,231 @@ namespace tests
         return EXIT_SUCCESS;
     }
     
+    int testFusedFeatureExtraction()
+    {
+        DEBUG_OUT("testing fused feature extraction.", 10);
+        
+        music::ConstantQTransform* cqt = NULL;
+        musicaccess::IIRFilter* lowpassFilter = NULL;
+        
+        lowpassFilter = musicaccess::IIRFilter::createLowpassFilter(0.25);
+        CHECK_OP(lowpassFilter, !=, NULL);
+        
+        DEBUG_OUT("creating constant q transform kernel...", 15);
+        cqt = music::ConstantQTransform::createTransform(lowpassFilter, 12, 25, 11025, 22050, 2.0, 0.0, 0.0005, 0.25);
+        
+        musicaccess::SoundFile file;
+        CHECK(file.open("./testdata/test.mp3", true));
+        
+        float* buffer = new float[file.getSampleCount()];
+        unsigned int sampleCount = file.readSamples(buffer, file.getSampleCount());
+        musicaccess::Resampler22kHzMono resampler;
+        DEBUG_OUT("resampling input file...", 15);
+        resampler.resample(file.getSampleRate(), &buffer, sampleCount, file.getChannelCount());
+        
+        DEBUG_OUT("applying constant q transform...", 15);
+        music::ConstantQTransformResult* transformResult = cqt->apply(buffer, sampleCount);
+        CHECK(transformResult != NULL);
+        
+        DEBUG_OUT("extracting features in one pass...", 15);
+        music::FusedFeatureExtractor fusedExtractor(transformResult, 0.01, 0.01, 0.05);
+        fusedExtractor.extract();
+        
+        //the results need to be exactly the same as the ones of the single passes.
+        DEBUG_OUT("comparing sum vectors...", 15);
+        music::PerTimeSliceStatistics<kiss_fft_scalar> perTimeSliceStatistics(transformResult, 0.01);
+        perTimeSliceStatistics.calculateSum();
+        CHECK_EQ(fusedExtractor.getSumVector().size(), perTimeSliceStatistics.getSumVector()->size());
+        CHECK_OP(fusedExtractor.getSumVector().size(), >, 100);
+        int differences = 0;
+        for (int i=0; i<fusedExtractor.getSumVector().size(); i++)
+        {
+            if (fusedExtractor.getSumVector()[i] != (*perTimeSliceStatistics.getSumVector())[i])
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        DEBUG_OUT("comparing timbre vectors...", 15);
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > fusedTimbreVectors;
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > timbreVectors;
+        CHECK(fusedExtractor.calculateTimbreVectors(fusedTimbreVectors, 20));
+        music::TimbreModel timbreModel(transformResult);
+        CHECK(timbreModel.calculateTimbreVectors(timbreVectors, 0.01, 20));
+        CHECK_EQ(fusedTimbreVectors.size(), timbreVectors.size());
+        differences = 0;
+        for (unsigned int i=0; i<timbreVectors.size(); i++)
+        {
+            if (fusedTimbreVectors[i] != timbreVectors[i])
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        DEBUG_OUT("comparing batch and single timbre estimation...", 15);
+        music::TimbreEstimator timbreEstimator(transformResult, 20);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> timbreMatrix;
+        std::vector<bool> valid;
+        timbreEstimator.estimateTimbre(fusedExtractor.getTimbreMeans(), timbreMatrix, valid);
+        CHECK_EQ(timbreMatrix.rows(), 20);
+        CHECK_EQ(timbreMatrix.cols(), fusedExtractor.getTimbreMeans().cols());
+        CHECK_EQ(valid.size(), (unsigned int)timbreMatrix.cols());
+        differences = 0;
+        for (int i=0; i<timbreMatrix.cols(); i++)
+        {
+            Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> timbre = timbreEstimator.estimateTimbre(Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>(fusedExtractor.getTimbreMeans().col(i)));
+            //the matrix product sums up in a different order, so allow for rounding errors.
+            if ((timbre.size() > 1) != valid[i])
+                differences++;
+            else if (valid[i] && ((timbre - timbreMatrix.col(i)).norm() > 1e-4 * timbre.norm()))
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        DEBUG_OUT("comparing chroma vectors...", 15);
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > fusedChromaVectors;
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > chromaVectors;
+        int fusedMode, mode;
+        CHECK(fusedExtractor.calculateChromaVectors(fusedChromaVectors, fusedMode, true));
+        music::ChromaEstimator chromaEstimator(transformResult);
+        CHECK(chromaEstimator.estimateChroma(chromaVectors, mode, 0.05, true));
+        CHECK_EQ(fusedMode, mode);
+        CHECK_EQ(fusedChromaVectors.size(), chromaVectors.size());
+        differences = 0;
+        for (unsigned int i=0; i<chromaVectors.size(); i++)
+        {
+            if (fusedChromaVectors[i] != chromaVectors[i])
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        DEBUG_OUT("comparing single- and multithreaded feature extraction...", 15);
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > parallelTimbreVectors;
+        CHECK(timbreModel.calculateTimbreVectors(parallelTimbreVectors, 0.01, 20, 4));
+        CHECK_EQ(parallelTimbreVectors.size(), timbreVectors.size());
+        differences = 0;
+        for (unsigned int i=0; i<timbreVectors.size(); i++)
+        {
+            if (parallelTimbreVectors[i] != timbreVectors[i])
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > parallelChromaVectors;
+        int parallelMode;
+        CHECK(chromaEstimator.estimateChroma(parallelChromaVectors, parallelMode, 0.05, true, 4));
+        CHECK_EQ(parallelMode, mode);
+        CHECK_EQ(parallelChromaVectors.size(), chromaVectors.size());
+        differences = 0;
+        for (unsigned int i=0; i<chromaVectors.size(); i++)
+        {
+            if (parallelChromaVectors[i] != chromaVectors[i])
+                differences++;
+        }
+        CHECK_EQ(differences, 0);
+        
+        DEBUG_OUT("comparing single- and multithreaded fused feature extraction...", 15);
+        for (unsigned int threadCount=2; threadCount<=5; threadCount+=3)
+        {
+            music::FusedFeatureExtractor parallelFusedExtractor(transformResult, 0.01, 0.01, 0.05);
+            parallelFusedExtractor.extract(threadCount);
+            CHECK(parallelFusedExtractor.getSumVector() == fusedExtractor.getSumVector());
+            CHECK(parallelFusedExtractor.getTimbreMeans() == fusedExtractor.getTimbreMeans());
+            CHECK(parallelFusedExtractor.getChromaMeans() == fusedExtractor.getChromaMeans());
+            
+            std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > parallelFusedTimbreVectors;
+            CHECK(parallelFusedExtractor.calculateTimbreVectors(parallelFusedTimbreVectors, 20));
+            CHECK_EQ(parallelFusedTimbreVectors.size(), fusedTimbreVectors.size());
+            differences = 0;
+            for (unsigned int i=0; i<fusedTimbreVectors.size(); i++)
+            {
+                if (parallelFusedTimbreVectors[i] != fusedTimbreVectors[i])
+                    differences++;
+            }
+            CHECK_EQ(differences, 0);
+        }
+        
+        delete transformResult;
+        delete[] buffer;
+        delete cqt;
+        delete lowpassFilter;
+        
+        return EXIT_SUCCESS;
+    }
+    
+    int testAdaptiveSlicing()
+    {
+        DEBUG_OUT("testing silence detection...", 10);
+        //one second of silence, two seconds of a sine, one second of silence.
+        unsigned int sampleCount = 4 * 22050;
+        float* buffer = new float[sampleCount];
+        for (unsigned int i=0; i<sampleCount; i++)
+        {
+            if ((i >= 22050) && (i < 3 * 22050))
+                buffer[i] = 0.5 * std::sin(2 * M_PI * 440.0 * i / 22050);
+            else
+                buffer[i] = 0.0;
+        }
+        unsigned int firstSample = 0;
+        unsigned int nonSilentSampleCount = 0;
+        CHECK(music::findNonSilentRange(buffer, sampleCount, firstSample, nonSilentSampleCount));
+        //the range may only be off by one block.
+        CHECK_OP(firstSample, <=, 22050);
+        CHECK_OP(firstSample, >=, 22050 - 1102);
+        CHECK_OP(firstSample + nonSilentSampleCount, >=, 3 * 22050);
+        CHECK_OP(firstSample + nonSilentSampleCount, <=, 3 * 22050 + 1102);
+        
+        for (unsigned int i=0; i<sampleCount; i++)
+            buffer[i] = 0.0;
+        CHECK(!music::findNonSilentRange(buffer, sampleCount, firstSample, nonSilentSampleCount));
+        CHECK_EQ(nonSilentSampleCount, 0u);
+        delete[] buffer;
+        
+        DEBUG_OUT("testing spectral flux...", 10);
+        //a stationary part, followed by a part changing every time slice.
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic> means = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, Eigen::Dynamic>::Ones(12, 1000);
+        for (int i=500; i<1000; i++)
+        {
+            means.col(i).setZero();
+            means(i % 12, i) = 1.0;
+        }
+        Eigen::Matrix<double, Eigen::Dynamic, 1> flux;
+        music::calculateSpectralFlux(means, flux);
+        CHECK_EQ(flux.size(), 1000);
+        CHECK_EQ(flux[0], 0.0);
+        CHECK_EQ(flux[100], 0.0);
+        CHECK_EQ(flux[600], 1.0);
+        CHECK_OP(flux.minCoeff(), >=, 0.0);
+        CHECK_OP(flux.maxCoeff(), <=, 1.0);
+        
+        DEBUG_OUT("testing time slice selection...", 10);
+        std::vector<int> selected;
+        music::selectTimeSlices(flux, 2000, selected);
+        CHECK_EQ(selected.size(), 1000u);
+        
+        music::selectTimeSlices(flux, 200, selected);
+        CHECK_OP(selected.size(), <=, 200u);
+        CHECK_OP(selected.size(), >, 150u);
+        int stationaryCount = 0;
+        for (unsigned int i=0; i<selected.size(); i++)
+        {
+            if (i > 0)
+                CHECK_OP(selected[i], >, selected[i-1]);
+            if (selected[i] < 500)
+                stationaryCount++;
+        }
+        DEBUG_OUT("time slices from the stationary part: " << stationaryCount << " of " << selected.size(), 15);
+        //the stationary part still gets samples, but less than the changing part.
+        CHECK_OP(stationaryCount, >, 25);
+        CHECK_OP(stationaryCount, <, int(selected.size()) / 2);
+        
+        //without the novelty, this is uniform subsampling.
+        music::selectTimeSlices(flux, 200, selected, 0.0);
+        CHECK_EQ(selected.size(), 200u);
+        CHECK_EQ(selected[0], 2);
+        CHECK_EQ(selected[199], 997);
+        
+        return EXIT_SUCCESS;
+    }
+    
     /**
      * @todo Test ist unvollständig: Erweitern um gemischte Instrumente, und mehr Instrumente
      */
@@ -784,6 +1055,181 @@ namespace tests
         return EXIT_SUCCESS;
     }
     
+    //the chroma estimation as it was before it worked on blocks of time slices:
+    //one time slice after another, chord likelihoods as the float mean of the three notes.
+    static void estimateChromaPerTimeSlice(music::ConstantQTransformResult* transformResult, double timeSliceLength,
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> >& chromaVectors, std::vector<int>& chords, int& mode)
+    {
+        int binsPerOctave = transformResult->getBinsPerOctave();
+        int octaveCount = transformResult->getOctaveCount();
+        
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> chroma = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>::Zero(binsPerOctave);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> actChordLikelihood(2*binsPerOctave);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> overallChordLikelihood = Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1>::Zero(2*binsPerOctave);
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> actCQTmean(binsPerOctave * octaveCount);
+        
+        int maxElement = transformResult->getOriginalDuration() / timeSliceLength;
+        for (int i = 1; i < maxElement; i++)
+        {
+            double time = i * timeSliceLength;
+            for (int bin=0; bin < binsPerOctave; bin++)
+            {
+                for (int octave=0; octave<octaveCount; octave++)
+                    actCQTmean[octave * binsPerOctave + bin] = std::abs(transformResult->getNoteValueMean(time, octave, bin, timeSliceLength));
+            }
+            
+            double maxValue = fabs(actCQTmean.maxCoeff());
+            if (maxValue <= 1e-14)
+                continue;
+            actCQTmean /= maxValue;
+            actCQTmean = actCQTmean.array().pow(1.2);
+            actCQTmean *= maxValue;
+            
+            chroma *= 1.0-(timeSliceLength/0.125);
+            for (int bin=0; bin < binsPerOctave; bin++)
+            {
+                double binSum = 0.0;
+                for (int octave=0; octave<octaveCount; octave++)
+                    binSum += actCQTmean[octave * binsPerOctave + bin];
+                chroma[bin] += binSum*(timeSliceLength/0.125);
+            }
+            chroma.normalize();
+            chromaVectors.push_back(chroma);
+            
+            for (int j=0; j<binsPerOctave; j++)
+            {
+                actChordLikelihood[j]               = (chroma[j] + chroma[(j+4)%binsPerOctave] + chroma[(j+7)%binsPerOctave])/3.0;
+                actChordLikelihood[j+binsPerOctave] = (chroma[j] + chroma[(j+3)%binsPerOctave] + chroma[(j+7)%binsPerOctave])/3.0;
+            }
+            int maxLikelihoodChord = -1;
+            double maxLikelihoodValue = -std::numeric_limits<double>::max();
+            for (int k = 0; k < 2*binsPerOctave; k++)
+            {
+                if (actChordLikelihood[k] > maxLikelihoodValue)
+                {
+                    maxLikelihoodChord = k;
+                    maxLikelihoodValue = actChordLikelihood[k];
+                }
+            }
+            chords.push_back(maxLikelihoodChord);
+            overallChordLikelihood[maxLikelihoodChord] += 1.0;
+        }
+        
+        Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> chordModeLikelihood(3*binsPerOctave);
+        for (int j=0; j<binsPerOctave; j++)
+        {
+            chordModeLikelihood[j] = overallChordLikelihood[ j ]               * 3.0
+                              + overallChordLikelihood[(j + 5)%binsPerOctave]
+                              + overallChordLikelihood[(j + 7)%binsPerOctave]  * 1.5
+                              + overallChordLikelihood[(j +14)%binsPerOctave+12]
+                              + overallChordLikelihood[(j +16)%binsPerOctave+12]
+                              + overallChordLikelihood[(j +21)%binsPerOctave+12];
+        }
+        for (int j=binsPerOctave; j<2*binsPerOctave; j++)
+        {
+            chordModeLikelihood[j] = overallChordLikelihood[ j%binsPerOctave + 12 ]         * 3.0
+                              + overallChordLikelihood[(j + 3)%binsPerOctave]
+                              + overallChordLikelihood[(j + 8)%binsPerOctave]
+                              + overallChordLikelihood[(j +10)%binsPerOctave]
+                              + overallChordLikelihood[(j +17)%binsPerOctave+12]
+                              + overallChordLikelihood[(j +19)%binsPerOctave+12] * 1.5;
+        }
+        for (int j=2*binsPerOctave; j<3*binsPerOctave; j++)
+        {
+            chordModeLikelihood[j] = overallChordLikelihood[ j%binsPerOctave + 12 ]      * 3.0
+                              + overallChordLikelihood[(j-12 + 3)%binsPerOctave]
+                              + overallChordLikelihood[(j-12 + 8)%binsPerOctave]
+                              + overallChordLikelihood[(j-12 +10)%binsPerOctave]
+                              + overallChordLikelihood[(j-12 +17)%binsPerOctave+12]
+                              + overallChordLikelihood[(j-12 + 7)%binsPerOctave] * 1.5;
+        }
+        mode = -1;
+        double maxChordLikelihoodValue = -std::numeric_limits<double>::max();
+        for (int i = 0; i < 3*binsPerOctave; i++)
+        {
+            if (chordModeLikelihood[i] > maxChordLikelihoodValue)
+            {
+                mode = i;
+                maxChordLikelihoodValue = chordModeLikelihood[i];
+            }
+        }
+    }
+    
+    int testChromaReference()
+    {
+        DEBUG_OUT("comparing chroma estimation with the time slice by time slice computation.", 10);
+        
+        musicaccess::IIRFilter* lowpassFilter = musicaccess::IIRFilter::createLowpassFilter(0.25);
+        CHECK_OP(lowpassFilter, !=, NULL);
+        music::ConstantQTransform* cqt = music::ConstantQTransform::createTransform(lowpassFilter, 12, 25, 11025, 22050, 2.0, 0.0, 0.0005, 0.25);
+        
+        //a fixed signal: c major, then a minor. the chords get louder and quieter.
+        DEBUG_OUT("creating signal...", 15);
+        unsigned int sampleCount = 22050 * 12;
+        float* buffer = new float[sampleCount];
+        double cMajor[] = {261.63, 329.63, 392.00};
+        double aMinor[] = {220.00, 261.63, 329.63};
+        for (unsigned int i=0; i<sampleCount; i++)
+        {
+            double time = i / 22050.0;
+            double* chord = (time < 6.0) ? cMajor : aMinor;
+            double envelope = 0.5 + 0.4 * sin(2*M_PI*0.5*time);
+            buffer[i] = 0.0;
+            for (int note=0; note<3; note++)
+                buffer[i] += 0.2 * envelope * sin(2*M_PI*chord[note]*time);
+        }
+        
+        DEBUG_OUT("applying constant q transform...", 15);
+        music::ConstantQTransformResult* transformResult = cqt->apply(buffer, sampleCount);
+        CHECK(transformResult != NULL);
+        
+        std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > referenceChromaVectors;
+        std::vector<int> referenceChords;
+        int referenceMode;
+        estimateChromaPerTimeSlice(transformResult, 0.05, referenceChromaVectors, referenceChords, referenceMode);
+        CHECK_OP(referenceChromaVectors.size(), >, 200u);
+        
+        Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> chordTemplates = music::ChromaEstimator::createChordTemplates(12);
+        CHECK_EQ(chordTemplates.rows(), 24);
+        CHECK_EQ(chordTemplates.cols(), 12);
+        
+        music::ChromaEstimator chromaEstimator(transformResult);
+        for (unsigned int threadCount=1; threadCount<=3; threadCount+=2)
+        {
+            DEBUG_OUT("estimating chroma in " << threadCount << " thread(s)...", 15);
+            std::vector<Eigen::Matrix<kiss_fft_scalar, Eigen::Dynamic, 1> > chromaVectors;
+            int mode;
+            CHECK(chromaEstimator.estimateChroma(chromaVectors, mode, 0.05, false, threadCount));
+            CHECK_EQ(mode, referenceMode);
+            CHECK_EQ(chromaVectors.size(), referenceChromaVectors.size());
+            
+            int differences = 0;
+            int chordDifferences = 0;
+            for (unsigned int i=0; i<chromaVectors.size(); i++)
+            {
+                if (chromaVectors[i] != referenceChromaVectors[i])
+                    differences++;
+                int chord;
+                (chordTemplates * chromaVectors[i].cast<double>()).maxCoeff(&chord);
+                if (chord != referenceChords[i])
+                    chordDifferences++;
+            }
+            CHECK_EQ(differences, 0);
+            CHECK_EQ(chordDifferences, 0);
+        }
+        
+        //c major while it plays, a minor afterwards.
+        CHECK_EQ(referenceChords[20], 7);
+        CHECK_EQ(referenceChords[referenceChords.size() - 20], 4 + 12);
+        
+        delete transformResult;
+        delete[] buffer;
+        delete cqt;
+        delete lowpassFilter;
+        
+        return EXIT_SUCCESS;
+    }
+    
     /**
      * @todo Test ist unvollständig
      */
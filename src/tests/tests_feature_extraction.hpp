@@ -11,6 +11,9 @@ namespace tests
     /** @ingroup tests
      */
     int testEstimateChroma();
+    /** @ingroup tests
+     */
+    int testChromaReference();
     /** @ingroup tests
      */
     int applyTimbreEstimation(std::string filename);
@@ -26,6 +29,12 @@ namespace tests
     /** @ingroup tests
      */
     int testPerTimeSliceStatistics();
+    /** @ingroup tests
+     */
+    int testFusedFeatureExtraction();
+    /** @ingroup tests
+     */
+    int testAdaptiveSlicing();
 }
 
 #endif  //TESTS_FEATURE_EXTRACTION_HPP
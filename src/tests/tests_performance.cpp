@@ -18,6 +18,7 @@
 
 #include <dirent.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <fstream>
@@ -443,4 +444,123 @@ namespace performance_tests
         
         return EXIT_SUCCESS;
     }
+    
+    int testEMAcceleration()
+    {
+        //overlapping clusters, like the samples of the classification category models.
+        int dimension = 16;
+        int dataCount = 10000;
+        int clusterCount = 60;
+        srand(3);
+        std::vector<Eigen::VectorXf> centers;
+        for (int c=0; c<clusterCount; c++)
+            centers.push_back(10.0f * (Eigen::VectorXf::Random(dimension).array() + 1.0f) / 2.0f);
+        music::NormalRNG<float> normalRNG;
+        music::DataSet<float> data(dimension, dataCount);
+        for (int i=0; i<dataCount; i++)
+        {
+            int c = rand() % clusterCount;
+            for (int j=0; j<dimension; j++)
+                data(j, i) = centers[c][j] + 1.5f * normalRNG.rand();
+        }
+        
+        std::cout << "model\tgaussians\tEM\titerations\ttime (s)\tlog-likelihood" << std::endl;
+        for (int full=0; full<2; full++)
+        {
+            //full covariance matricies are a lot more expensive.
+            int gaussianCount = full ? 20 : 50;
+            for (int accelerated=0; accelerated<2; accelerated++)
+            {
+                music::GaussianMixtureModel<float>* gmm;
+                if (full)
+                    gmm = new music::GaussianMixtureModelFullCov<float>();
+                else
+                    gmm = new music::GaussianMixtureModelDiagCov<float>();
+                gmm->setMaxIterations(500);
+                gmm->setInitMethod(music::GMM_INIT_KMEANSPP);
+                gmm->setEMAcceleration(accelerated);
+                
+                //same seed, such that both start from the same gaussians.
+                srand(42);
+                timeval start, end;
+                gettimeofday(&start, NULL);
+                gmm->trainGMM(data, gaussianCount, 10.0, 0.01);
+                gettimeofday(&end, NULL);
+                double time = (end.tv_sec - start.tv_sec) + 1e-6 * (end.tv_usec - start.tv_usec);
+                
+                std::cout << (full ? "full" : "diagonal") << "\t" << gaussianCount << "\t"
+                    << (accelerated ? "accelerated" : "plain") << "\t" << gmm->getIterationCount() << "\t"
+                    << time << "\t" << std::fixed << gmm->getModelLogLikelihood() << std::endl;
+                std::cout.unsetf(std::ios_base::fixed);
+                delete gmm;
+            }
+        }
+        
+        return EXIT_SUCCESS;
+    }
+    
+    int testGMMDivergence()
+    {
+        //models of recordings: every one uses some of the clusters.
+        int dimension = 16;
+        int dataCount = 5000;
+        int clusterCount = 30;
+        int modelCount = 8;
+        int gaussianCount = 20;
+        srand(3);
+        std::vector<Eigen::VectorXf> centers;
+        for (int c=0; c<clusterCount; c++)
+            centers.push_back(10.0f * (Eigen::VectorXf::Random(dimension).array() + 1.0f) / 2.0f);
+        music::NormalRNG<float> normalRNG;
+        std::vector<music::GaussianMixtureModel<float>*> gmms;
+        for (int m=0; m<modelCount; m++)
+        {
+            music::DataSet<float> data(dimension, dataCount);
+            for (int i=0; i<dataCount; i++)
+            {
+                int c = (m * 3 + rand() % 10) % clusterCount;
+                for (int j=0; j<dimension; j++)
+                    data(j, i) = centers[c][j] + 1.5f * normalRNG.rand();
+            }
+            gmms.push_back(new music::GaussianMixtureModelDiagCov<float>());
+            gmms.back()->setInitMethod(music::GMM_INIT_KMEANS);
+            gmms.back()->trainGMM(data, gaussianCount, 10.0, 0.01);
+        }
+        
+        //reference: Monte-Carlo estimate with a lot of samples.
+        Eigen::MatrixXd reference(modelCount, modelCount);
+        for (int i=0; i<modelCount; i++)
+        {
+            for (int j=0; j<modelCount; j++)
+                reference(i, j) = gmms[i]->compareTo(*gmms[j], 20000);
+        }
+        
+        music::GMM_DIVERGENCE_METHOD methods[] = {music::GMM_DIVERGENCE_MONTECARLO, music::GMM_DIVERGENCE_VARIATIONAL,
+            music::GMM_DIVERGENCE_MATCHED_PAIR, music::GMM_DIVERGENCE_SYMMETRIC_VARIATIONAL};
+        const char* methodNames[] = {"monte-carlo (200 samples)", "variational", "matched pair", "symmetric variational"};
+        std::cout << "method	time per comparison (ms)	mean absolute error	mean reference value" << std::endl;
+        for (int m=0; m<4; m++)
+        {
+            Eigen::MatrixXd divergence(modelCount, modelCount);
+            timeval start, end;
+            gettimeofday(&start, NULL);
+            for (int i=0; i<modelCount; i++)
+            {
+                for (int j=0; j<modelCount; j++)
+                    divergence(i, j) = gmms[i]->compareTo(*gmms[j], methods[m]);
+            }
+            gettimeofday(&end, NULL);
+            double time = (end.tv_sec - start.tv_sec) + 1e-6 * (end.tv_usec - start.tv_usec);
+            
+            Eigen::MatrixXd expected = reference;
+            if (methods[m] == music::GMM_DIVERGENCE_SYMMETRIC_VARIATIONAL)
+                expected = reference + reference.transpose();
+            std::cout << methodNames[m] << "\t" << 1000.0 * time / (modelCount * modelCount) << "\t"
+                << (divergence - expected).cwiseAbs().mean() << "\t" << expected.mean() << std::endl;
+        }
+        
+        for (int m=0; m<modelCount; m++)
+            delete gmms[m];
+        return EXIT_SUCCESS;
+    }
 }
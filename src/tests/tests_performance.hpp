@@ -45,6 +45,31 @@ namespace performance_tests
         const std::string& folder = std::string("./testdata/instrument/singlenotes/"));
     
     int testGMMRand();
+    
+    /**
+     * @brief Compares the plain and the accelerated EM algorithm.
+     * 
+     * Trains diagonal and full covariance models on overlapping clusters, once
+     * with the plain EM algorithm and once with over-relaxed steps (see
+     * music::GaussianMixtureModel::setEMAcceleration()), starting from the same
+     * gaussians. Displays the iterations, the wall time and the log-likelihood
+     * of every run.
+     * 
+     * @return <code>EXIT_SUCCESS</code> if no error occured, otherwise <code>EXIT_FAILURE</code>.
+     */
+    int testEMAcceleration();
+    
+    /**
+     * @brief Compares the approximations of the divergence of two gaussian mixture models.
+     * 
+     * Trains diagonal models on different subsets of overlapping clusters and
+     * compares all pairs of them with every music::GMM_DIVERGENCE_METHOD.
+     * Displays the time per comparison and the mean absolute error
+     * to a Monte-Carlo estimate with 20000 samples.
+     * 
+     * @return <code>EXIT_SUCCESS</code> if no error occured, otherwise <code>EXIT_FAILURE</code>.
+     */
+    int testGMMDivergence();
 }
 
 #endif  //TESTS_PERFORMANCE_HPP